@@ -43,6 +43,12 @@
 
 using namespace ssd;
 
+// Sets of a block in index_state
+#define AMT_INDEX_EMT 1
+#define AMT_INDEX_ZERO 2
+#define AMT_INDEX_OPEN 4
+#define AMT_INDEX_FREE 8
+
 FtlImpl_AMT::FtlImpl_AMT(Controller &controller):
 FtlImpl_DftlParent(controller)
 {
@@ -57,6 +63,11 @@ FtlImpl_DftlParent(controller)
 	trim_map = new bool[ssdSize];
 	freePage = ssdSize;
 	prev_start_time = 0;
+	emt_decay = 0;
+	index_key.assign(NUMBER_OF_ADDRESSABLE_BLOCKS, 0);
+	index_state.assign(NUMBER_OF_ADDRESSABLE_BLOCKS, 0);
+	for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++)
+		reindex(i);
 	printf("Total size to map: %uKB\n", ssdSize * PAGE_SIZE / 1024);
 	printf("Using AMT-FTL.\n");
 	return;
@@ -83,10 +94,10 @@ enum status FtlImpl_AMT::read(Event &event)
 	uint dlpn = event.get_logical_address();
 	resolve_mapping(event, false);
 
-	MPage current = trans_map[dlpn];
+	long ppn = trans_map[dlpn];
 
-	if (current.ppn != -1)
-		event.set_address(Address(current.ppn, PAGE));
+	if (ppn != -1)
+		event.set_address(Address(ppn, PAGE));
 	else
 	{
 		event.set_address(Address(0, PAGE));
@@ -103,23 +114,107 @@ enum status FtlImpl_AMT::read(Event &event)
 
 uint FtlImpl_AMT::get_similar_data_block(uint lpn, double timeGap, Event &event) // block들 중 지금 page가 들어가기 가장 적절한 곳을 고르는 함수
 {	// page의 AMT와 가장 비슷한 평균 AMT 값을 가진 block을 고르자.
-	double min = 99999999999;
+	// The lookup is charged as the scan of the blocks with free pages it models.
+	uint candidates = emt_index.size() + emt_zero.size();
+	event.incr_time_taken(RAM_READ_DELAY * candidates);
+	controller.stats.numMemoryRead += candidates;
+
+	double min = 0;
 	int min_idx = -1;
-	double dist = 0;
 	double emt = AMT_table[lpn].amt - timeGap;
-	for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++) {
-		if(EMT_table[i].pageCount >= BLOCK_SIZE) continue;
-		event.incr_time_taken(RAM_READ_DELAY);
-		controller.stats.numMemoryRead += 1;
-		dist = fabs(emt - EMT_table[i].emt);
-		if(dist < min) {
+
+	// Blocks at zero are equally near, take the first one like the scan did
+	if (!emt_zero.empty()) {
+		min = fabs(emt);
+		min_idx = *emt_zero.begin();
+	}
+
+	// The nearest EMT above and below, the first block of equal ones
+	std::set<std::pair<double, uint> >::const_iterator above = emt_index.lower_bound(std::make_pair(emt + emt_decay, 0u));
+	std::set<std::pair<double, uint> >::const_iterator nearest[2] = {above, emt_index.end()};
+	if (above != emt_index.begin()) {
+		std::set<std::pair<double, uint> >::const_iterator below = above;
+		--below;
+		nearest[1] = emt_index.lower_bound(std::make_pair(below->first, 0u));
+	}
+	for(uint i = 0; i < 2; i++) {
+		if (nearest[i] == emt_index.end()) continue;
+		double dist = fabs(emt - (nearest[i]->first - emt_decay));
+		if (min_idx == -1 || dist < min || (dist == min && (int) nearest[i]->second < min_idx)) {
 			min = dist;
-			min_idx = i;
+			min_idx = nearest[i]->second;
 		}
 	}
 	return min_idx;
 }
 
+double FtlImpl_AMT::get_emt(uint dlbn) const
+{
+	double emt = EMT_table[dlbn].emt - emt_decay;
+	return emt > 0 ? emt : 0;
+}
+
+// The caller reindexes the block
+void FtlImpl_AMT::set_emt(uint dlbn, double emt)
+{
+	EMT_table[dlbn].emt = emt + emt_decay;
+}
+
+void FtlImpl_AMT::decay_emt(double timeGap)
+{
+	if (timeGap < 0) {
+		// Time went back, EMTs grow again including those at zero
+		for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++)
+			if (EMT_table[i].emt < emt_decay) EMT_table[i].emt = emt_decay;
+		for(std::set<uint>::const_iterator i = emt_zero.begin(); i != emt_zero.end(); ++i) {
+			index_key[*i] = emt_decay;
+			emt_index.insert(std::make_pair(emt_decay, *i));
+			index_state[*i] = (index_state[*i] & ~AMT_INDEX_ZERO) | AMT_INDEX_EMT;
+		}
+		emt_zero.clear();
+		emt_decay += timeGap;
+		return;
+	}
+
+	emt_decay += timeGap;
+	while (!emt_index.empty() && emt_index.begin()->first <= emt_decay) {
+		uint dlbn = emt_index.begin()->second;
+		emt_index.erase(emt_index.begin());
+		emt_zero.insert(dlbn);
+		index_state[dlbn] = (index_state[dlbn] & ~AMT_INDEX_EMT) | AMT_INDEX_ZERO;
+	}
+}
+
+// Call after any change to the entry of a block
+void FtlImpl_AMT::reindex(uint dlbn)
+{
+	if (index_state[dlbn] & AMT_INDEX_EMT) emt_index.erase(std::make_pair(index_key[dlbn], dlbn));
+	if (index_state[dlbn] & AMT_INDEX_ZERO) emt_zero.erase(dlbn);
+	if (index_state[dlbn] & AMT_INDEX_OPEN) open_blocks.erase(dlbn);
+	if (index_state[dlbn] & AMT_INDEX_FREE) free_blocks.erase(dlbn);
+	index_state[dlbn] = 0;
+
+	BPage &block = EMT_table[dlbn];
+	if (block.pageCount < BLOCK_SIZE) {
+		if (block.emt <= emt_decay) {
+			emt_zero.insert(dlbn);
+			index_state[dlbn] |= AMT_INDEX_ZERO;
+		} else {
+			index_key[dlbn] = block.emt;
+			emt_index.insert(std::make_pair(block.emt, dlbn));
+			index_state[dlbn] |= AMT_INDEX_EMT;
+		}
+		if (block.pbn != -1u) {
+			open_blocks.insert(dlbn);
+			index_state[dlbn] |= AMT_INDEX_OPEN;
+		}
+	}
+	if (block.pbn == -1u && !block.allocating) {
+		free_blocks.insert(dlbn);
+		index_state[dlbn] |= AMT_INDEX_FREE;
+	}
+}
+
 void FtlImpl_AMT::AMT_table_update(uint lpn, double start_time, Event &event) // page 개개인에 대한 AMT 정보 업데이트
 {
 	event.incr_time_taken(RAM_READ_DELAY);
@@ -145,9 +240,10 @@ void FtlImpl_AMT::EMT_table_delete(uint pbn, Event &event)
 	// printf("EMT_table_delete(dlbn): %d\n", dlbn);
 	EMT_table[dlbn].pbn = -1;
 	EMT_table[dlbn].nextPage = 0;
-	EMT_table[dlbn].emt = 0;
+	set_emt(dlbn, 0);
 	EMT_table[dlbn].pageCount = 0;
 	EMT_table[dlbn].validCount = 0;
+	reindex(dlbn);
 	freePage += BLOCK_SIZE;
 }
 
@@ -159,11 +255,11 @@ void FtlImpl_AMT::EMT_table_update(uint lpn, uint pdlbn, uint dlbn, Event &event
 	controller.stats.numMemoryWrite += 2;
 	if (AMT_table[lpn].count > 2) { // time taken 값이 존재하고, EMT_table 값에 관여되어 있다. 없애줘야 함.
 		if(EMT_table[pdlbn].validCount == 1)
-			EMT_table[pdlbn].emt = 0;
+			set_emt(pdlbn, 0);
 		else {
-			EMT_table[pdlbn].emt = (EMT_table[pdlbn].emt * EMT_table[pdlbn].validCount - AMT_table[lpn].amt) / (EMT_table[pdlbn].validCount - 1);
-			if (EMT_table[pdlbn].emt < 0) EMT_table[pdlbn].emt = 0;
-
+			double emt = (get_emt(pdlbn) * EMT_table[pdlbn].validCount - AMT_table[lpn].amt) / (EMT_table[pdlbn].validCount - 1);
+			if (emt < 0) emt = 0;
+			set_emt(pdlbn, emt);
 		}
 	}
 	if (AMT_table[lpn].count > 1) {
@@ -172,7 +268,7 @@ void FtlImpl_AMT::EMT_table_update(uint lpn, uint pdlbn, uint dlbn, Event &event
 			EMT_table[pdlbn].validCount--;
 		}
 		// printf("%f, %d, %f\n", EMT_table[dlbn].emt, EMT_table[dlbn].validCount, AMT_table[lpn].amt);
-		EMT_table[dlbn].emt = (EMT_table[dlbn].emt * EMT_table[dlbn].validCount + AMT_table[lpn].amt) / (EMT_table[dlbn].validCount + 1);
+		set_emt(dlbn, (get_emt(dlbn) * EMT_table[dlbn].validCount + AMT_table[lpn].amt) / (EMT_table[dlbn].validCount + 1));
 	}
 	EMT_table[dlbn].validCount++;
 }
@@ -180,16 +276,10 @@ void FtlImpl_AMT::EMT_table_update(uint lpn, uint pdlbn, uint dlbn, Event &event
 enum status FtlImpl_AMT::write(Event &event)
 {
 	uint dlpn = event.get_logical_address();
-	MPage current = trans_map[dlpn];
 	// 1. time flow. AMT_block에는 block 내의 page들의 평균 '수정까지 남은 시간'이 들어 있다.
 	// 시간의 흐른 만큼 이 값들을 깎아줘야 새로운 page가 들어가기 적절한 위치를 찾을 수 있다.
-	if (event.get_start_time() != prev_start_time) {
-		double time_gap = event.get_start_time() - prev_start_time;
-		for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++) {			
-			if(EMT_table[i].emt < time_gap) EMT_table[i].emt = 0;
-			else EMT_table[i].emt -= time_gap;
-		}
-	}
+	if (event.get_start_time() != prev_start_time)
+		decay_emt(event.get_start_time() - prev_start_time);
 
 	// 2. AMT_table update
 	uint prev_blockidx = AMT_table[dlpn].blockidx;
@@ -215,11 +305,13 @@ enum status FtlImpl_AMT::write(Event &event)
 	// Get new block if necessary
 	if (EMT_table[dlbn].pbn == -1u)
 	{
-		Block_manager::instance()->insert_events_AMT(event, freePage);
-		// Block_manager::instance()->insert_events(event);
+		manager.insert_events_AMT(event, freePage);
+		// manager.insert_events(event);
 		EMT_table[dlbn].allocating = true;
-		EMT_table[dlbn].pbn = Block_manager::instance()->get_free_block(DATA, event).get_linear_address();
+		reindex(dlbn);
+		EMT_table[dlbn].pbn = manager.get_free_block(DATA, event).get_linear_address();
 		EMT_table[dlbn].allocating = false;
+		reindex(dlbn);
 		pbn_to_lbn[EMT_table[dlbn].pbn / BLOCK_SIZE] = dlbn;
 		// printf("new block: %d, pbn: %d\n", dlbn, EMT_table[dlbn].pbn);
 	}
@@ -244,10 +336,11 @@ enum status FtlImpl_AMT::write(Event &event)
 	event.incr_time_taken(RAM_READ_DELAY*3);
 	controller.stats.numFTLWrite++; // Page writes
 	// 4. EMT_table update
-	current = trans_map[dlpn];
-
 	EMT_table_update(dlpn, prev_blockidx, dlbn, event);
 	EMT_table[dlbn].pageCount++;
+	if (AMT_table[dlpn].count > 1)
+		reindex(prev_blockidx);
+	reindex(dlbn);
 	freePage--;
 	prev_start_time = event.get_start_time();
 	// print_block_status();
@@ -263,18 +356,17 @@ enum status FtlImpl_AMT::trim(Event &event)
 	// Update trim map
 	trim_map[dlpn] = true;
 
-	MPage current = trans_map[dlpn];
-	if (current.ppn != -1)
+	long ppn = trans_map[dlpn];
+	if (ppn != -1)
 	{
-		Address address = Address(current.ppn, PAGE);
+		Address address = Address(ppn, PAGE);
 		Block *block = controller.get_block_pointer(address);
 		block->invalidate_page(address.page);
 
 		evict_specific_page_from_cache(event, dlpn);
 
 		// Update translation map to default values.
-		update_translation_map(current, -1);
-		trans_map.replace(trans_map.begin()+dlpn, current);
+		update_translation_map(dlpn, -1);
 
 		event.incr_time_taken(RAM_READ_DELAY);
 		event.incr_time_taken(RAM_WRITE_DELAY);
@@ -297,6 +389,7 @@ enum status FtlImpl_AMT::trim(Event &event)
 	{
 		EMT_table[dlbn].pbn = -1;
 		EMT_table[dlbn].nextPage = 0;
+		reindex(dlbn);
 		controller.stats.numMemoryWrite++; // Update block_map.
 	}
 	
@@ -324,7 +417,7 @@ void FtlImpl_AMT::cleanup_block(Event &event, Block *block)
 	{
 		assert(block->get_state(i) != EMPTY);
 		// When valid, two events are create, one for read and one for write. They are chained and the controller are
-		// called to execute them. The execution time is then added to the real event.
+		// called to execute them. The real event then waits for the write to finish.
 		if (block->get_state(i) == VALID)
 		{
 			int dlpn = event.get_logical_address();
@@ -339,30 +432,22 @@ void FtlImpl_AMT::cleanup_block(Event &event, Block *block)
 			// Get new address to write to and invalidate previous
 			Event writeEvent = Event(WRITE, dlpn, 1, event.get_start_time()+readEvent.get_time_taken());
 			// 빈 공간 찾아서 저장하기, 없다면 할당하기
-			int found = 0;
-			for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++) {
-				if(EMT_table[i].pbn != -1u && EMT_table[i].pageCount < BLOCK_SIZE) {
-					currentDataPage = EMT_table[i].pbn + EMT_table[i].nextPage;
-					found = 1;
-					break;
-				}
+			if(!open_blocks.empty()) {
+				uint i = *open_blocks.begin();
+				currentDataPage = EMT_table[i].pbn + EMT_table[i].nextPage;
 			}
-			if(found == 0) {
-				for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++)
-				{
-					if(EMT_table[i].pbn == -1u && EMT_table[i].allocating == false) {
-						// printf("-----new block allocating: %d\n", i);
-						EMT_table[i].allocating = true;
-						EMT_table[i].pbn = Block_manager::instance()->get_free_block(DATA, event).get_linear_address();
-						EMT_table[i].allocating = false;
-						// printf("-----allocated: %d\n", EMT_table[i].pbn);
-						pbn_to_lbn[EMT_table[i].pbn / BLOCK_SIZE] = i;
-						freePage--;
-						currentDataPage = EMT_table[i].pbn + EMT_table[i].nextPage;
-						found = 1;
-						break;
-					}
-				}
+			else if(!free_blocks.empty()) {
+				uint i = *free_blocks.begin();
+				// printf("-----new block allocating: %d\n", i);
+				EMT_table[i].allocating = true;
+				reindex(i);
+				EMT_table[i].pbn = manager.get_free_block(DATA, event).get_linear_address();
+				EMT_table[i].allocating = false;
+				// printf("-----allocated: %d\n", EMT_table[i].pbn);
+				pbn_to_lbn[EMT_table[i].pbn / BLOCK_SIZE] = i;
+				reindex(i);
+				freePage--;
+				currentDataPage = EMT_table[i].pbn + EMT_table[i].nextPage;
 			}
 			// printf("currentDataPage: %d\n", currentDataPage);
 			Address dataBlockAddress = Address(currentDataPage, PAGE);
@@ -372,12 +457,12 @@ void FtlImpl_AMT::cleanup_block(Event &event, Block *block)
 			writeEvent.set_address(dataBlockAddress);
 			writeEvent.set_replace_address(Address(block->get_physical_address()+i, PAGE));
 			// Setup the write event to read from the right place.
-			writeEvent.set_payload((char*)page_data + (block->get_physical_address()+i) * PAGE_SIZE);
+			writeEvent.set_payload(controller.get_page_data(block->get_physical_address()+i));
 
 			if (controller.issue(writeEvent) == FAILURE)
 				printf("Data block copy failed.");
 
-			event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+			event.join(writeEvent);
 
 			// Update GTD
 			long dataPpn = dataBlockAddress.get_linear_address();
@@ -388,11 +473,13 @@ void FtlImpl_AMT::cleanup_block(Event &event, Block *block)
 			EMT_table[AMT_table[dlpn].blockidx].nextPage++;
 			EMT_table[AMT_table[dlpn].blockidx].pageCount++;
 			EMT_table[AMT_table[dlpn].blockidx].validCount++;
+			reindex(AMT_table[dlpn].blockidx);
 
 			// printf("copy to %d %d\n", AMT_table[dlpn].blockidx, AMT_table[dlpn].pageidx);
 			// vpn -> Old ppn to new ppn
 			//printf("%li Moving %li to %li\n", reverse_trans_map[block->get_physical_address()+i], block->get_physical_address()+i, dataPpn);
-			invalidated_translation[reverse_trans_map[block->get_physical_address()+i]] = dataPpn;
+			if (reverse_trans_map[block->get_physical_address()+i] != -1) // Not mapped through the GTD
+				invalidated_translation[reverse_trans_map[block->get_physical_address()+i]] = dataPpn;
 			copycnt++;
 			printf("copycnt: %d\n", copycnt);
 			// Statistics
@@ -419,22 +506,13 @@ void FtlImpl_AMT::cleanup_block(Event &event, Block *block)
 		long real_vpn = (*i).first;
 		long newppn = (*i).second;
 
-		// Update translation map ( it also updates the CMT, as it is stored inside the GDT )
-		MPage current = trans_map[real_vpn];
-
-		update_translation_map(current, newppn);
+		// Update translation map, the CMT only holds which mappings are cached
+		update_translation_map(real_vpn, newppn);
 
-		if (current.cached)
-			current.modified_ts = event.get_start_time();
+		if (cmt->contains(real_vpn))
+			cmt->set_dirty(real_vpn, true);
 		else
-		{
-			current.modified_ts = event.get_start_time();
-			current.create_ts = event.get_start_time();
-			current.cached = true;
-			cmt++;
-		}
-
-		trans_map.replace(trans_map.begin()+real_vpn, current);
+			cmt->insert(real_vpn, false, false);
 	}
 }
 
@@ -447,7 +525,7 @@ bool FtlImpl_AMT::block_next_new()
 void FtlImpl_AMT::print_block_status()
 {
 	 for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++) {
-	 	printf("%d %lf / page: %d / valid: %d ||\t", i, EMT_table[i].emt, EMT_table[i].pageCount, EMT_table[i].validCount);
+	 	printf("%d %lf / page: %d / valid: %d ||\t", i, get_emt(i), EMT_table[i].pageCount, EMT_table[i].validCount);
 		if(i%4==3)printf("\n");
 	}
 }
@@ -457,4 +535,28 @@ void FtlImpl_AMT::print_ftl_statistics()
 	printf("FTL Stats:\n");
 	printf(" Blocks total: %i\n", NUMBER_OF_ADDRESSABLE_BLOCKS);
 
-	Block_manager::instance()->print_statistics();}
\ No newline at end of file
+	manager.print_statistics();}
+
+void FtlImpl_AMT::snapshot(Snapshot &snapshot)
+{
+	FtlImpl_DftlParent::snapshot(snapshot);
+	snapshot.section("amt");
+	uint ssdSize = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+	snapshot.io_array(AMT_table, ssdSize);
+	snapshot.io_array(EMT_table, NUMBER_OF_ADDRESSABLE_BLOCKS);
+	snapshot.io_array(pbn_to_lbn, NUMBER_OF_ADDRESSABLE_BLOCKS);
+	snapshot.io_array(trim_map, ssdSize);
+	snapshot.io(freePage);
+	snapshot.io(prev_start_time);
+	snapshot.io(emt_decay);
+	if (snapshot.is_saving())
+		return;
+
+	emt_index.clear();
+	emt_zero.clear();
+	open_blocks.clear();
+	free_blocks.clear();
+	index_state.assign(NUMBER_OF_ADDRESSABLE_BLOCKS, 0);
+	for(uint i = 0; i < NUMBER_OF_ADDRESSABLE_BLOCKS; i++)
+		reindex(i);
+}
@@ -64,6 +64,15 @@ LogPageBlock::~LogPageBlock()
 	delete [] aPages;
 }
 
+/* the owner of the log block saves the link to the next one */
+void LogPageBlock::snapshot(Snapshot &snapshot)
+{
+	snapshot.io_array(pages, BLOCK_SIZE);
+	snapshot.io_array(aPages, BLOCK_SIZE);
+	snapshot.io_address(address);
+	snapshot.io(numPages);
+}
+
 /* Comparison class for use by FTL to sort the LogPageBlock compared to the number of pages written. */
 bool LogPageBlock::operator() (const LogPageBlock& lhs, const LogPageBlock& rhs) const
 {
@@ -71,7 +80,8 @@ bool LogPageBlock::operator() (const LogPageBlock& lhs, const LogPageBlock& rhs)
 }
 
 FtlImpl_Bast::FtlImpl_Bast(Controller &controller):
-	FtlParent(controller)
+	FtlParent(controller),
+	log_map(BAST_LOG_BLOCK_LIMIT)
 {
 
 	// Detect required number of bits for logical address size
@@ -102,9 +112,7 @@ enum status FtlImpl_Bast::read(Event &event)
 	long lookupBlock = (event.get_logical_address() >> addressShift);
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	LogPageBlock *logBlock = NULL;
-	if (log_map.find(lookupBlock) != log_map.end())
-		logBlock = log_map[lookupBlock];
+	LogPageBlock *logBlock = log_map.find(lookupBlock);
 
 	controller.stats.numMemoryRead++;
 
@@ -133,19 +141,18 @@ enum status FtlImpl_Bast::read(Event &event)
 
 enum status FtlImpl_Bast::write(Event &event)
 {
-	LogPageBlock *logBlock = NULL;
-
 	long lba = (event.get_logical_address() >> addressShift);
 
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	if (log_map.find(lba) == log_map.end())
-		allocate_new_logblock(logBlock, lba, event);
+	LogPageBlock *logBlock = log_map.find(lba);
+	if (logBlock == NULL)
+		logBlock = allocate_new_logblock(lba, event);
+	else
+		log_map.touch(lba);
 
 	controller.stats.numMemoryRead++;
 
-	logBlock = log_map[lba];
-
 	// Can it fit inside the existing log block. Issue the request.
  	uint numValid = controller.get_num_valid(&logBlock->address);
 	if (numValid < BLOCK_SIZE)
@@ -166,8 +173,7 @@ enum status FtlImpl_Bast::write(Event &event)
 		if (!is_sequential(logBlock, lba, event))
 			random_merge(logBlock, lba, event);
 
-		allocate_new_logblock(logBlock, lba, event);
-		logBlock = log_map[lba];
+		logBlock = allocate_new_logblock(lba, event);
 		// Write the current io to a new block.
 		logBlock->pages[eventAddress.page] = 0;
 		Address dataPage = logBlock->address;
@@ -180,7 +186,7 @@ enum status FtlImpl_Bast::write(Event &event)
 	{
 
 		int offset = event.get_logical_address() % BLOCK_SIZE;
-		Address replace = new Address(data_list[lba]+offset, PAGE);
+		Address replace(data_list[lba]+offset, PAGE);
 		if (controller.get_block_pointer(replace)->get_state(offset) != EMPTY)
 			event.set_replace_address(replace);
 	}
@@ -197,9 +203,7 @@ enum status FtlImpl_Bast::trim(Event &event)
 	long lookupBlock = (event.get_logical_address() >> addressShift);
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	LogPageBlock *logBlock = NULL;
-	if (log_map.find(lookupBlock) != log_map.end())
-		logBlock = log_map[lookupBlock];
+	LogPageBlock *logBlock = log_map.find(lookupBlock);
 
 	controller.stats.numMemoryRead++;
 
@@ -215,8 +219,8 @@ enum status FtlImpl_Bast::trim(Event &event)
 
 		if (lBlock->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 		{
-			dispose_logblock(logBlock, lookupBlock);
-			Block_manager::instance()->erase_and_invalidate(event, returnAddress, LOG);
+			dispose_logblock(lookupBlock);
+			manager.erase_and_invalidate(event, returnAddress, LOG);
 		}
 
 	}
@@ -230,7 +234,7 @@ enum status FtlImpl_Bast::trim(Event &event)
 		if (dBlock->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 		{
 			data_list[lookupBlock] = -1;
-			Block_manager::instance()->erase_and_invalidate(event, dataAddress, DATA);
+			manager.erase_and_invalidate(event, dataAddress, DATA);
 		}
 
 	}
@@ -245,18 +249,12 @@ enum status FtlImpl_Bast::trim(Event &event)
 }
 
 
-void FtlImpl_Bast::allocate_new_logblock(LogPageBlock *logBlock, long lba, Event &event)
+LogPageBlock *FtlImpl_Bast::allocate_new_logblock(long lba, Event &event)
 {
 	if (log_map.size() >= BAST_LOG_BLOCK_LIMIT)
 	{
-		int victim = random()%log_map.size()-1;
-		std::map<long, LogPageBlock*>::iterator it = log_map.begin();
-
-		for (int i=0;i<victim;i++)
-			it++;
-
-		long exLogicalBlock = (*it).first;
-		LogPageBlock *exLogBlock = (*it).second;
+		long exLogicalBlock = log_map.victim();
+		LogPageBlock *exLogBlock = log_map.find(exLogicalBlock);
 
 		if (!is_sequential(exLogBlock, exLogicalBlock, event))
 			random_merge(exLogBlock, exLogicalBlock, event);
@@ -264,17 +262,18 @@ void FtlImpl_Bast::allocate_new_logblock(LogPageBlock *logBlock, long lba, Event
 		controller.stats.numPageBlockToPageConversion++;
 	}
 
-	logBlock = new LogPageBlock();
-	logBlock->address = Block_manager::instance()->get_free_block(LOG, event);
+	LogPageBlock *logBlock = new LogPageBlock();
+	logBlock->address = manager.get_free_block(LOG, event);
 
 	//printf("Using new log block with address: %lu Block: %u\n", logBlock->address.get_linear_address(), logBlock->address.block);
-	log_map[lba] = logBlock;
+	log_map.insert(lba, logBlock);
+	return logBlock;
 }
 
-void FtlImpl_Bast::dispose_logblock(LogPageBlock *logBlock, long lba)
+// Deletes the log block of lba
+void FtlImpl_Bast::dispose_logblock(long lba)
 {
 	log_map.erase(lba);
-	delete logBlock;
 }
 
 bool FtlImpl_Bast::is_sequential(LogPageBlock* logBlock, long lba, Event &event)
@@ -294,17 +293,17 @@ bool FtlImpl_Bast::is_sequential(LogPageBlock* logBlock, long lba, Event &event)
 
 	if (isSequential)
 	{
-		Block_manager::instance()->promote_block(DATA);
+		manager.promote_block(DATA);
 
 		// Add to empty list i.e. switch without erasing the datablock.
 		if (data_list[lba] != -1)
 		{
 			Address a = Address(data_list[lba], PAGE);
-			Block_manager::instance()->erase_and_invalidate(event, a, DATA);
+			manager.erase_and_invalidate(event, a, DATA);
 		}
 
 		data_list[lba] = logBlock->address.get_linear_address();
-		dispose_logblock(logBlock, lba);
+		dispose_logblock(lba);
 
 		controller.stats.numLogMergeSwitch++;
 		update_map_block(event);
@@ -326,7 +325,7 @@ bool FtlImpl_Bast::random_merge(LogPageBlock *logBlock, long lba, Event &event)
 	 */
 
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
-	Address newDataBlock = Block_manager::instance()->get_free_block(DATA, event);
+	Address newDataBlock = manager.get_free_block(DATA, event);
 
 	int t=0;
 	for (uint i=0;i<BLOCK_SIZE;i++)
@@ -352,12 +351,12 @@ bool FtlImpl_Bast::random_merge(LogPageBlock *logBlock, long lba, Event &event)
 
 		Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
 		writeEvent.set_address(Address(newDataBlock.get_linear_address() + i, PAGE));
-		writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+		writeEvent.set_payload(controller.get_page_data(readAddress.get_linear_address()));
 		writeEvent.set_replace_address(readAddress);
 		controller.issue(writeEvent);
 
 		//event.consolidate_metaevent(writeEvent);
-		event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+		event.join(writeEvent);
 		// Statistics
 		controller.stats.numFTLRead++;
 		controller.stats.numFTLWrite++;
@@ -370,19 +369,19 @@ bool FtlImpl_Bast::random_merge(LogPageBlock *logBlock, long lba, Event &event)
 
 	// Invalidate inactive pages (LOG and DATA
 
-	Block_manager::instance()->erase_and_invalidate(event, logBlock->address, LOG);
+	manager.erase_and_invalidate(event, logBlock->address, LOG);
 
 	if (data_list[lba] != -1)
 	{
 		Address a = Address(data_list[lba], PAGE);
-		Block_manager::instance()->erase_and_invalidate(event, a, DATA);
+		manager.erase_and_invalidate(event, a, DATA);
 	}
 
 	// Update mapping
 	data_list[lba] = newDataBlock.get_linear_address();
 	update_map_block(event);
 
-	dispose_logblock(logBlock, lba);
+	dispose_logblock(lba);
 
 	controller.stats.numLogMergeFull++;
 	return true;
@@ -396,7 +395,7 @@ void FtlImpl_Bast::update_map_block(Event &event)
 
 	controller.issue(writeEvent);
 
-	event.incr_time_taken(writeEvent.get_time_taken());
+	event.join(writeEvent);
 
 	controller.stats.numGCWrite++;
 	controller.stats.numFTLWrite++;
@@ -405,6 +404,14 @@ void FtlImpl_Bast::update_map_block(Event &event)
 
 void FtlImpl_Bast::print_ftl_statistics()
 {
-	Block_manager::instance()->print_statistics();
+	manager.print_statistics();
 }
 
+
+void FtlImpl_Bast::snapshot(Snapshot &snapshot)
+{
+	FtlParent::snapshot(snapshot);
+	snapshot.section("bast");
+	snapshot.io_array(data_list, NUMBER_OF_ADDRESSABLE_BLOCKS);
+	log_map.snapshot(snapshot);
+}
@@ -86,10 +86,10 @@ enum status FtlImpl_BDftl::read(Event &event)
 	} else { // DFTL lookup
 		resolve_mapping(event, false);
 
-		MPage current = trans_map[dlpn];
+		long ppn = trans_map[dlpn];
 
-		if (current.ppn != -1)
-			event.set_address(Address(current.ppn, PAGE));
+		if (ppn != -1)
+			event.set_address(Address(ppn, PAGE));
 		else
 		{
 			event.set_address(Address(0, PAGE));
@@ -121,7 +121,7 @@ enum status FtlImpl_BDftl::write(Event &event)
 
 		// Get new block if necessary
 		if (block_map[dlbn].pbn == -1u && dlpn % BLOCK_SIZE == 0)
-			block_map[dlbn].pbn = Block_manager::instance()->get_free_block(DATA, event).get_linear_address();
+			block_map[dlbn].pbn = manager.get_free_block(DATA, event).get_linear_address();
 
 		if (block_map[dlbn].pbn != -1u)
 		{
@@ -156,17 +156,13 @@ enum status FtlImpl_BDftl::write(Event &event)
 					if (b->get_state(i) != VALID)
 						continue;
 
-					MPage current = trans_map[startAdr + i];
-
-					if (current.ppn != -1)
+					if (trans_map[startAdr + i] != -1)
 					{
-						update_translation_map(current, block_map[dlbn].pbn+i);
-						current.create_ts = event.get_start_time();
-						current.modified_ts = event.get_start_time();
-						current.cached = true;
-						trans_map.replace(trans_map.begin()+startAdr+i, current);
-
-						cmt++;
+						update_translation_map(startAdr + i, block_map[dlbn].pbn+i);
+						if (cmt->contains(startAdr + i))
+							cmt->set_dirty(startAdr + i, false);
+						else
+							cmt->insert(startAdr + i, false, false);
 
 						event.incr_time_taken(RAM_WRITE_DELAY);
 						controller.stats.numMemoryWrite++;
@@ -203,19 +199,18 @@ enum status FtlImpl_BDftl::write(Event &event)
 		long free_page = get_free_biftl_page(event);
 		resolve_mapping(event, true);
 
-		MPage current = trans_map[dlpn];
+		long ppn = trans_map[dlpn];
 
-		Address a = Address(current.ppn, PAGE);
+		Address a = Address(ppn, PAGE);
 
-		if (current.ppn != -1)
+		if (ppn != -1)
 			event.set_replace_address(a);
 
 
-		update_translation_map(current, free_page);
-		trans_map.replace(trans_map.begin()+dlpn, current);
+		update_translation_map(dlpn, free_page);
 
 		// Finish DFTL logic
-		event.set_address(Address(current.ppn, PAGE));
+		event.set_address(Address(free_page, PAGE));
 	}
 
 	controller.stats.numMemoryRead += 3; // Block-level lookup + range check + optimal check
@@ -288,22 +283,21 @@ enum status FtlImpl_BDftl::trim(Event &event)
 		{
 			block_map[dlbn].pbn = -1;
 			block_map[dlbn].nextPage = 0;
-			Block_manager::instance()->erase_and_invalidate(event, address, DATA);
+			manager.erase_and_invalidate(event, address, DATA);
 		}
 	} else { // DFTL lookup
 
-		MPage current = trans_map[dlpn];
-		if (current.ppn != -1)
+		long ppn = trans_map[dlpn];
+		if (ppn != -1)
 		{
-			Address address = Address(current.ppn, PAGE);
+			Address address = Address(ppn, PAGE);
 			Block *block = controller.get_block_pointer(address);
 			block->invalidate_page(address.page);
 
 			evict_specific_page_from_cache(event, dlpn);
 
 			// Update translation map to default values.
-			update_translation_map(current, -1);
-			trans_map.replace(trans_map.begin()+dlpn, current);
+			update_translation_map(dlpn, -1);
 
 			event.incr_time_taken(RAM_READ_DELAY);
 			event.incr_time_taken(RAM_WRITE_DELAY);
@@ -353,7 +347,7 @@ void FtlImpl_BDftl::cleanup_block(Event &event, Block *block)
 	{
 		assert(block->get_state(i) != EMPTY);
 		// When valid, two events are create, one for read and one for write. They are chained and the controller are
-		// called to execute them. The execution time is then added to the real event.
+		// called to execute them. The real event then waits for the write to finish.
 		if (block->get_state(i) == VALID)
 		{
 			// Set up events.
@@ -371,19 +365,20 @@ void FtlImpl_BDftl::cleanup_block(Event &event, Block *block)
 			writeEvent.set_replace_address(Address(block->get_physical_address()+i, PAGE));
 
 			// Setup the write event to read from the right place.
-			writeEvent.set_payload((char*)page_data + (block->get_physical_address()+i) * PAGE_SIZE);
+			writeEvent.set_payload(controller.get_page_data(block->get_physical_address()+i));
 
 			if (controller.issue(writeEvent) == FAILURE)
 				printf("Data block copy failed.");
 
-			event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+			event.join(writeEvent);
 
 			// Update GTD
 			long dataPpn = dataBlockAddress.get_linear_address();
 
 			// vpn -> Old ppn to new ppn
 			//printf("%li Moving %li to %li\n", reverse_trans_map[block->get_physical_address()+i], block->get_physical_address()+i, dataPpn);
-			invalidated_translation[reverse_trans_map[block->get_physical_address()+i]] = dataPpn;
+			if (reverse_trans_map[block->get_physical_address()+i] != -1) // Not mapped through the GTD
+				invalidated_translation[reverse_trans_map[block->get_physical_address()+i]] = dataPpn;
 			copycnt++;
 			printf("copycnt: %d\n", copycnt);
 			// Statistics
@@ -409,22 +404,13 @@ void FtlImpl_BDftl::cleanup_block(Event &event, Block *block)
 		long real_vpn = (*i).first;
 		long newppn = (*i).second;
 
-		// Update translation map ( it also updates the CMT, as it is stored inside the GDT )
-		MPage current = trans_map[real_vpn];
-
-		update_translation_map(current, newppn);
+		// Update translation map, the CMT only holds which mappings are cached
+		update_translation_map(real_vpn, newppn);
 
-		if (current.cached)
-			current.modified_ts = event.get_start_time();
+		if (cmt->contains(real_vpn))
+			cmt->set_dirty(real_vpn, true);
 		else
-		{
-			current.modified_ts = event.get_start_time();
-			current.create_ts = event.get_start_time();
-			current.cached = true;
-			cmt++;
-		}
-
-		trans_map.replace(trans_map.begin()+real_vpn, current);
+			cmt->insert(real_vpn, false, false);
 	}
 }
 
@@ -452,6 +438,23 @@ void FtlImpl_BDftl::print_ftl_statistics()
 	}
 
 	printf(" Blocks optimal: %i\n", numOptimal);
-	Block_manager::instance()->print_statistics();
+	manager.print_statistics();
 }
 
+
+void FtlImpl_BDftl::snapshot(Snapshot &snapshot)
+{
+	FtlImpl_DftlParent::snapshot(snapshot);
+	snapshot.section("bdftl");
+	snapshot.io_array(block_map, NUMBER_OF_ADDRESSABLE_BLOCKS);
+	snapshot.io_array(trim_map, NUMBER_OF_ADDRESSABLE_BLOCKS*BLOCK_SIZE);
+	snapshot.io_block(inuseBlock, *this);
+
+	// The block queue is saved front to back.
+	std::vector<Block*> blocks;
+	for (; !blockQueue.empty(); blockQueue.pop())
+		blocks.push_back(blockQueue.front());
+	snapshot.io_blocks(blocks, *this);
+	for (uint i = 0; i < blocks.size(); i++)
+		blockQueue.push(blocks[i]);
+}
@@ -0,0 +1,388 @@
+/* Copyright 2011 Matias Bjørling */
+
+/* cache_policies.cpp  */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Replacement policies of the Cached Mapping Table
+ *
+ * Selected with CACHE_DFTL_POLICY: 0 = LRU, 1 = CLOCK, 2 = 2Q, 3 = ARC,
+ * 4 = S3-FIFO, 5 = TPFTL. Every policy evicts exactly one cached mapping per call to
+ * evict, the FTL writes its translation page back when it is dirty. Mappings
+ * cached by garbage collection are not host references and never count as a
+ * hit or move a ghost back into the cache.
+ */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include "../ssd.h"
+
+using namespace ssd;
+
+/* LRU */
+
+Mapping_cache_Lru::Mapping_cache_Lru(uint capacity, uint entries_per_page):
+	Mapping_cache(capacity, entries_per_page, 1, 0)
+{
+}
+
+void Mapping_cache_Lru::insert(long vpn, bool dirty, bool recent)
+{
+	add(vpn, 0, dirty, recent);
+}
+
+void Mapping_cache_Lru::touch(long vpn, bool dirty)
+{
+	move(hit(vpn, dirty), 0, true);
+}
+
+long Mapping_cache_Lru::evict(bool &dirty)
+{
+	if (queues[0].tail == -1)
+		return -1;
+	return drop(queues[0].tail, dirty);
+}
+
+/* CLOCK
+ *
+ * The hand sits at the tail of the queue, new mappings go in at the head,
+ * right behind the hand. A mapping that gets a second round moves from the
+ * tail to the head, which is the hand passing it. */
+
+Mapping_cache_Clock::Mapping_cache_Clock(uint capacity, uint entries_per_page):
+	Mapping_cache(capacity, entries_per_page, 1, 0)
+{
+}
+
+void Mapping_cache_Clock::insert(long vpn, bool dirty, bool recent)
+{
+	add(vpn, 0, dirty, recent);
+}
+
+void Mapping_cache_Clock::touch(long vpn, bool dirty)
+{
+	entries[hit(vpn, dirty)].hits = 1;
+}
+
+long Mapping_cache_Clock::evict(bool &dirty)
+{
+	int index;
+	while ((index = queues[0].tail) != -1 && entries[index].hits != 0)
+	{
+		entries[index].hits = 0;
+		move(index, 0, true);
+	}
+	if (index == -1)
+		return -1;
+	return drop(index, dirty);
+}
+
+/* 2Q
+ *
+ * The full version with the tuning of the paper: the FIFO A1in holds a
+ * quarter of the cache, the ghost queue A1out remembers half a cache worth of
+ * mappings evicted from A1in. Am is the main LRU queue. */
+
+#define TWOQ_AM 0
+#define TWOQ_A1IN 1
+#define TWOQ_A1OUT 2
+
+Mapping_cache_2Q::Mapping_cache_2Q(uint capacity, uint entries_per_page):
+	Mapping_cache(capacity, entries_per_page, 2, 1),
+	in_limit(capacity / 4 > 0 ? capacity / 4 : 1),
+	out_limit(capacity / 2 > 0 ? capacity / 2 : 1)
+{
+}
+
+void Mapping_cache_2Q::insert(long vpn, bool dirty, bool recent)
+{
+	int ghost = find_ghost(vpn);
+	if (ghost != -1)
+		remove(ghost);
+
+	if (ghost != -1 && recent)
+		add(vpn, TWOQ_AM, dirty, true);
+	else
+		add(vpn, TWOQ_A1IN, dirty, recent);
+}
+
+// Hits in A1in are correlated references and do not promote
+void Mapping_cache_2Q::touch(long vpn, bool dirty)
+{
+	int index = hit(vpn, dirty);
+	if (entries[index].queue == TWOQ_AM)
+		move(index, TWOQ_AM, true);
+}
+
+long Mapping_cache_2Q::evict(bool &dirty)
+{
+	if (queues[TWOQ_A1IN].size > in_limit || queues[TWOQ_AM].size == 0)
+	{
+		if (queues[TWOQ_A1IN].tail == -1)
+			return -1;
+		return demote(queues[TWOQ_A1IN].tail, TWOQ_A1OUT, out_limit, dirty);
+	}
+	return drop(queues[TWOQ_AM].tail, dirty);
+}
+
+/* ARC
+ *
+ * T1 and T2 hold the mappings used once and used again, B1 and B2 are their
+ * ghost queues. All four are LRU ordered. The FTL evicts before it inserts,
+ * so evict cannot tell whether the next miss hits B2 and the tie at
+ * |T1| == target goes to T2. */
+
+#define ARC_T1 0
+#define ARC_T2 1
+#define ARC_B1 2
+#define ARC_B2 3
+
+Mapping_cache_Arc::Mapping_cache_Arc(uint capacity, uint entries_per_page):
+	Mapping_cache(capacity, entries_per_page, 2, 2),
+	target(0)
+{
+}
+
+void Mapping_cache_Arc::insert(long vpn, bool dirty, bool recent)
+{
+	int ghost = find_ghost(vpn);
+	if (ghost != -1 && recent)
+	{
+		uint b1 = queues[ARC_B1].size;
+		uint b2 = queues[ARC_B2].size;
+		if (entries[ghost].queue == ARC_B1)
+		{
+			uint delta = b1 >= b2 ? 1 : b2 / b1;
+			target = target + delta < capacity ? target + delta : capacity;
+		} else {
+			uint delta = b2 >= b1 ? 1 : b1 / b2;
+			target = target > delta ? target - delta : 0;
+		}
+		remove(ghost);
+		add(vpn, ARC_T2, dirty, true);
+		return;
+	}
+
+	if (ghost != -1)
+		remove(ghost);
+	else if (queues[ARC_T1].size + queues[ARC_B1].size >= capacity && queues[ARC_B1].size > 0)
+		remove(queues[ARC_B1].tail);
+	else if (size() + queues[ARC_B1].size + queues[ARC_B2].size >= 2 * capacity && queues[ARC_B2].size > 0)
+		remove(queues[ARC_B2].tail);
+	add(vpn, ARC_T1, dirty, recent);
+}
+
+void Mapping_cache_Arc::touch(long vpn, bool dirty)
+{
+	move(hit(vpn, dirty), ARC_T2, true);
+}
+
+long Mapping_cache_Arc::evict(bool &dirty)
+{
+	uint t1 = queues[ARC_T1].size;
+	if (t1 > 0 && (t1 > target || queues[ARC_T2].size == 0))
+		return demote(queues[ARC_T1].tail, ARC_B1, capacity, dirty);
+	if (queues[ARC_T2].tail == -1)
+		return -1;
+	return demote(queues[ARC_T2].tail, ARC_B2, capacity, dirty);
+}
+
+void Mapping_cache_Arc::snapshot_policy(Snapshot &snapshot)
+{
+	snapshot.io(target);
+}
+
+/* S3-FIFO
+ *
+ * The small FIFO S holds a tenth of the cache, the ghost FIFO G remembers a
+ * cache worth of mappings evicted from S. A mapping leaves S for the main
+ * FIFO M when it was hit more than once, and M gives each mapping as many
+ * extra rounds as it has hits, up to 3. */
+
+#define S3FIFO_SMALL 0
+#define S3FIFO_MAIN 1
+#define S3FIFO_GHOST 2
+#define S3FIFO_MAX_HITS 3
+
+Mapping_cache_S3Fifo::Mapping_cache_S3Fifo(uint capacity, uint entries_per_page):
+	Mapping_cache(capacity, entries_per_page, 2, 1),
+	small_limit(capacity / 10 > 0 ? capacity / 10 : 1)
+{
+}
+
+void Mapping_cache_S3Fifo::insert(long vpn, bool dirty, bool recent)
+{
+	int ghost = find_ghost(vpn);
+	if (ghost != -1)
+		remove(ghost);
+
+	if (ghost != -1 && recent)
+		add(vpn, S3FIFO_MAIN, dirty, true);
+	else
+		add(vpn, S3FIFO_SMALL, dirty, recent);
+}
+
+void Mapping_cache_S3Fifo::touch(long vpn, bool dirty)
+{
+	entry &e = entries[hit(vpn, dirty)];
+	if (e.hits < S3FIFO_MAX_HITS)
+		e.hits++;
+}
+
+long Mapping_cache_S3Fifo::evict(bool &dirty)
+{
+	int index;
+	while ((index = queues[S3FIFO_SMALL].tail) != -1 && (queues[S3FIFO_SMALL].size >= small_limit || queues[S3FIFO_MAIN].size == 0))
+	{
+		if (entries[index].hits <= 1)
+			return demote(index, S3FIFO_GHOST, capacity, dirty);
+		entries[index].hits = 0;
+		move(index, S3FIFO_MAIN, true);
+	}
+
+	while ((index = queues[S3FIFO_MAIN].tail) != -1 && entries[index].hits != 0)
+	{
+		entries[index].hits--;
+		move(index, S3FIFO_MAIN, true);
+	}
+	if (index == -1)
+		return -1;
+	return drop(index, dirty);
+}
+
+/* TPFTL
+ *
+ * Every translation page has a queue of its own, numbered like the page, and
+ * the pages are linked into an LRU list of their own. A page stays listed
+ * until evict finds it empty, which also covers pages emptied by erase. */
+
+#define TPFTL_UNLISTED -2
+
+Mapping_cache_Tpftl::Mapping_cache_Tpftl(uint capacity, uint entries_per_page):
+	Mapping_cache(capacity, entries_per_page, (NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE + entries_per_page - 1) / entries_per_page, 0),
+	page_prev(queues.size(), TPFTL_UNLISTED),
+	page_next(queues.size(), TPFTL_UNLISTED),
+	page_head(-1),
+	page_tail(-1)
+{
+}
+
+void Mapping_cache_Tpftl::link_page(uint page, bool front)
+{
+	if (front)
+	{
+		page_prev[page] = -1;
+		page_next[page] = page_head;
+		if (page_head != -1)
+			page_prev[page_head] = page;
+		page_head = page;
+		if (page_tail == -1)
+			page_tail = page;
+	} else {
+		page_next[page] = -1;
+		page_prev[page] = page_tail;
+		if (page_tail != -1)
+			page_next[page_tail] = page;
+		page_tail = page;
+		if (page_head == -1)
+			page_head = page;
+	}
+}
+
+void Mapping_cache_Tpftl::unlink_page(uint page)
+{
+	if (page_prev[page] != -1)
+		page_next[page_prev[page]] = page_next[page];
+	else
+		page_head = page_next[page];
+	if (page_next[page] != -1)
+		page_prev[page_next[page]] = page_prev[page];
+	else
+		page_tail = page_prev[page];
+	page_prev[page] = TPFTL_UNLISTED;
+	page_next[page] = TPFTL_UNLISTED;
+}
+
+// A page cached by garbage collection goes to the tail of the page list,
+// a page that is already listed keeps its place
+void Mapping_cache_Tpftl::insert(long vpn, bool dirty, bool recent)
+{
+	uint page = vpn / entries_per_page;
+	add(vpn, page, dirty, recent);
+	if (page_prev[page] == TPFTL_UNLISTED)
+		link_page(page, recent);
+	else if (recent && page_head != (int) page)
+	{
+		unlink_page(page);
+		link_page(page, true);
+	}
+}
+
+void Mapping_cache_Tpftl::touch(long vpn, bool dirty)
+{
+	uint page = vpn / entries_per_page;
+	move(hit(vpn, dirty), page, true);
+	if (page_head != (int) page)
+	{
+		unlink_page(page);
+		link_page(page, true);
+	}
+}
+
+// Clean first: the least recently used clean mapping of the page, the least
+// recently used mapping when all of them are dirty
+long Mapping_cache_Tpftl::evict(bool &dirty)
+{
+	while (page_tail != -1 && queues[page_tail].size == 0)
+		unlink_page(page_tail);
+	if (page_tail == -1)
+		return -1;
+
+	int victim = queues[page_tail].tail;
+	for (int index = victim; index != -1; index = entries[index].prev)
+		if (!entries[index].dirty)
+		{
+			victim = index;
+			break;
+		}
+	return drop(victim, dirty);
+}
+
+// Walks the cached mappings of the page only
+void Mapping_cache_Tpftl::clean_page(long vpn)
+{
+	for (int index = queues[vpn / entries_per_page].head; index != -1; index = entries[index].next)
+		entries[index].dirty = false;
+}
+
+// The page list is stored from its tail to its head
+void Mapping_cache_Tpftl::snapshot_policy(Snapshot &snapshot)
+{
+	std::vector<int> pages;
+	for (int page = page_tail; page != -1; page = page_prev[page])
+		pages.push_back(page);
+	snapshot.io_vector(pages);
+	if (snapshot.is_saving())
+		return;
+
+	page_prev.assign(queues.size(), TPFTL_UNLISTED);
+	page_next.assign(queues.size(), TPFTL_UNLISTED);
+	page_head = -1;
+	page_tail = -1;
+	for (ulong i = 0; i < pages.size(); i++)
+		link_page(pages[i], true);
+}
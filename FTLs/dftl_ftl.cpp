@@ -60,14 +60,14 @@ enum status FtlImpl_Dftl::read(Event &event)
 	uint dlpn = event.get_logical_address();
 
 	resolve_mapping(event, false);
-	MPage current = trans_map[dlpn];
-	if (current.ppn == -1)
+	long ppn = trans_map[dlpn];
+	if (ppn == -1)
 	{
 		event.set_address(Address(0, PAGE));
 		event.set_noop(true);
 	}
 	else
-		event.set_address(Address(current.ppn, PAGE));
+		event.set_address(Address(ppn, PAGE));
 
 
 	controller.stats.numFTLRead++;
@@ -84,14 +84,13 @@ enum status FtlImpl_Dftl::write(Event &event)
 	// Important order. As get_free_data_page might change current.
 	long free_page = get_free_data_page(event);
 
-	MPage current = trans_map[dlpn];
+	long ppn = trans_map[dlpn];
 
-	Address a = Address(current.ppn, PAGE);
-	if (current.ppn != -1)
+	Address a = Address(ppn, PAGE);
+	if (ppn != -1)
 		event.set_replace_address(a);
 
-	update_translation_map(current, free_page);
-	trans_map.replace(trans_map.begin()+dlpn, current);
+	update_translation_map(dlpn, free_page);
 
 	Address b = Address(free_page, PAGE);
 	event.set_address(b);
@@ -107,19 +106,17 @@ enum status FtlImpl_Dftl::trim(Event &event)
 
 	event.set_address(Address(0, PAGE));
 
-	MPage current = trans_map[dlpn];
+	long ppn = trans_map[dlpn];
 
-	if (current.ppn != -1)
+	if (ppn != -1)
 	{
-		Address address = Address(current.ppn, PAGE);
+		Address address = Address(ppn, PAGE);
 		Block *block = controller.get_block_pointer(address);
 		block->invalidate_page(address.page);
 
 		evict_specific_page_from_cache(event, dlpn);
 
-		update_translation_map(current, -1);
-
-		trans_map.replace(trans_map.begin()+dlpn, current);
+		update_translation_map(dlpn, -1);
 	}
 
 	controller.stats.numFTLTrim++;
@@ -139,7 +136,7 @@ void FtlImpl_Dftl::cleanup_block(Event &event, Block *block)
 	{
 		assert(block->get_state(i) != EMPTY);
 		// When valid, two events are create, one for read and one for write. They are chained and the controller are
-		// called to execute them. The execution time is then added to the real event.
+		// called to execute them. The real event then waits for the write to finish.
 		if (block->get_state(i) == VALID)
 		{
 			// Set up events.
@@ -159,19 +156,20 @@ void FtlImpl_Dftl::cleanup_block(Event &event, Block *block)
 			writeEvent.set_replace_address(Address(block->get_physical_address()+i, PAGE));
 
 			// Setup the write event to read from the right place.
-			writeEvent.set_payload((char*)page_data + (block->get_physical_address()+i) * PAGE_SIZE);
+			writeEvent.set_payload(controller.get_page_data(block->get_physical_address()+i));
 
 			if (controller.issue(writeEvent) == FAILURE)
 				printf("Data block copy failed.");
 
-			event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+			event.join(writeEvent);
 
 			// Update GTD
 			long dataPpn = dataBlockAddress.get_linear_address();
 
 			// vpn -> Old ppn to new ppn
 			//printf("%li Moving %li to %li\n", reverse_trans_map[block->get_physical_address()+i], block->get_physical_address()+i, dataPpn);
-			invalidated_translation[reverse_trans_map[block->get_physical_address()+i]] = dataPpn;
+			if (reverse_trans_map[block->get_physical_address()+i] != -1) // Not mapped through the GTD
+				invalidated_translation[reverse_trans_map[block->get_physical_address()+i]] = dataPpn;
 			copycnt++;
 			// Statistics
 			controller.stats.numFTLRead++;
@@ -197,27 +195,20 @@ void FtlImpl_Dftl::cleanup_block(Event &event, Block *block)
 		long real_vpn = (*i).first;
 		long newppn = (*i).second;
 
-		// Update translation map ( it also updates the CMT, as it is stored inside the GDT )
-		MPage current = trans_map[real_vpn];
-
-		update_translation_map(current, newppn);
+		// Update translation map, the CMT only holds which mappings are cached
+		update_translation_map(real_vpn, newppn);
 
-		if (current.cached)
-			current.modified_ts = event.get_start_time();
+		// A cached mapping is now dirty. An uncached one is brought in as the
+		// least recently used and in sync with the batch updated translation page.
+		if (cmt->contains(real_vpn))
+			cmt->set_dirty(real_vpn, true);
 		else
-		{
-			current.modified_ts = event.get_start_time();
-			current.create_ts = event.get_start_time();
-			current.cached = true;
-			cmt++;
-		}
-
-		trans_map.replace(trans_map.begin()+real_vpn, current);
+			cmt->insert(real_vpn, false, false);
 	}
 
 }
 
 void FtlImpl_Dftl::print_ftl_statistics()
 {
-	Block_manager::instance()->print_statistics();
+	manager.print_statistics();
 }
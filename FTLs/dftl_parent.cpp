@@ -37,55 +37,48 @@
 #include <queue>
 #include <iostream>
 #include <limits>
+#include <algorithm>
 #include "../ssd.h"
 
 using namespace ssd;
 
-FtlImpl_DftlParent::MPage::MPage(long vpn)
+int FtlImpl_DftlParent::address_per_page(void)
 {
-	this->vpn = vpn;
-	this->ppn = -1;
-	this->create_ts = -1;
-	this->modified_ts = -1;
-	this->last_visited_time = -1;
-	this->cached = false;
-}
-
-double FtlImpl_DftlParent::mpage_last_visited_time_compare(const FtlImpl_DftlParent::MPage& mpage)
-{
-	if (!mpage.cached)
-		return std::numeric_limits<double>::max();
-
-	return mpage.last_visited_time;
+	int addressSize = log(NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE)/log(2);
+	return PAGE_SIZE/ceil(addressSize / 8.0); // 8 bits per byte
 }
 
 FtlImpl_DftlParent::FtlImpl_DftlParent(Controller &controller):
-	FtlParent(controller)
+	FtlParent(controller),
+	cmt(Mapping_cache::create(CACHE_DFTL_LIMIT * address_per_page(), address_per_page()))
 {
-	addressPerPage = 0;
-	cmt = 0;
 	currentDataPage = -1;
 	currentTranslationPage = -1;
 
+	lastReadPage = -1;
+	sequentialReads = 0;
+
 	// Detect required number of bits for logical address size
 	addressSize = log(NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE)/log(2);
 
 	// Find required number of bits for block size
-	addressPerPage = (PAGE_SIZE/ceil(addressSize / 8.0)); // 8 bits per byte
+	addressPerPage = address_per_page();
 
 	printf("Total required bits for representation: Address size: %i Total per page: %i \n", addressSize, addressPerPage);
 
 	totalCMTentries = CACHE_DFTL_LIMIT * addressPerPage;
 	printf("Number of elements in Cached Mapping Table (CMT): %i\n", totalCMTentries);
 
-	// Initialise block mapping table.
+	// Initialise the global translation directory, nothing is mapped.
 	uint ssdSize = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
 
-	trans_map.reserve(ssdSize);
+	trans_map = new long[ssdSize];
 	for (uint i=0;i<ssdSize;i++)
-		trans_map.push_back(MPage(i));
+		trans_map[i] = -1;
 
 	reverse_trans_map = new long[ssdSize];
+	for (uint i=0;i<ssdSize;i++)
+		reverse_trans_map[i] = -1;
 }
 
 void FtlImpl_DftlParent::consult_GTD(long dlpn, Event &event)
@@ -97,20 +90,13 @@ void FtlImpl_DftlParent::consult_GTD(long dlpn, Event &event)
 
 	if (controller.issue(readEvent) == FAILURE) { assert(false);}
 	//event.consolidate_metaevent(readEvent);
-	event.incr_time_taken(readEvent.get_time_taken());
+	event.join(readEvent);
 	controller.stats.numFTLRead++;
 }
 
-void FtlImpl_DftlParent::reset_MPage(FtlImpl_DftlParent::MPage &mpage)
-{
-	mpage.create_ts = -2;
-	mpage.modified_ts = -2;
-	mpage.last_visited_time = -2;
-}
-
 bool FtlImpl_DftlParent::lookup_CMT(long dlpn, Event &event)
 {
-	if (!trans_map[dlpn].cached)
+	if (!cmt->contains(dlpn))
 		return false;
 
 	event.incr_time_taken(RAM_READ_DELAY);
@@ -127,10 +113,10 @@ long FtlImpl_DftlParent::get_free_data_page(Event &event)
 long FtlImpl_DftlParent::get_free_data_page(Event &event, bool insert_events)
 {
 	if (currentDataPage == -1 || (currentDataPage % BLOCK_SIZE == BLOCK_SIZE -1 && insert_events))
-		Block_manager::instance()->insert_events(event);
+		manager.insert_events(event);
 
 	if (currentDataPage == -1 || currentDataPage % BLOCK_SIZE == BLOCK_SIZE -1)
-		currentDataPage = Block_manager::instance()->get_free_block(DATA, event).get_linear_address();
+		currentDataPage = manager.get_free_block(DATA, event).get_linear_address();
 	else
 		currentDataPage++;
 	return currentDataPage;
@@ -138,7 +124,9 @@ long FtlImpl_DftlParent::get_free_data_page(Event &event, bool insert_events)
 
 FtlImpl_DftlParent::~FtlImpl_DftlParent(void)
 {
+	delete[] trans_map;
 	delete[] reverse_trans_map;
+	delete cmt;
 }
 
 void FtlImpl_DftlParent::resolve_mapping(Event &event, bool isWrite)
@@ -149,19 +137,25 @@ void FtlImpl_DftlParent::resolve_mapping(Event &event, bool isWrite)
 	 * 3. If not, then goto GDT, lookup page
 	 * 4. If CMT full, evict a page
 	 * 5. Add mapping to CMT
+	 * 6. If the host reads sequentially, prefetch the following mappings
 	 */
-	//printf("%i\n", cmt);
+	if (!isWrite)
+	{
+		if (lastReadPage != -1 && dlpn == lastReadPage + 1)
+			sequentialReads++;
+		else
+			sequentialReads = 0;
+		lastReadPage = dlpn;
+	}
+
 	if (lookup_CMT(event.get_logical_address(), event))
 	{
 		controller.stats.numCacheHits++;
 
-		MPage current = trans_map[dlpn];
-		if (isWrite)
-		{
-			current.modified_ts = event.get_start_time();			
-		}
-		current.last_visited_time = event.get_start_time();
-		trans_map.replace(trans_map.begin()+dlpn, current);
+		if (CACHE_DFTL_PREFETCH > 0 && cmt->clear_prefetched(dlpn))
+			controller.stats.numCachePrefetchHits++;
+
+		cmt->touch(dlpn, isWrite);
 
 		// evict_page_from_cache(event);    // no need to evict page from cache
 	} else {
@@ -171,117 +165,97 @@ void FtlImpl_DftlParent::resolve_mapping(Event &event, bool isWrite)
 
 		consult_GTD(dlpn, event);
 
-		MPage current = trans_map[dlpn];
-		current.modified_ts = event.get_start_time();
-		current.last_visited_time = event.get_start_time();
-		if (isWrite)
-			current.modified_ts++;
-		current.create_ts = event.get_start_time();
-		current.cached = true;
-		trans_map.replace(trans_map.begin()+dlpn, current);
+		cmt->insert(dlpn, isWrite);
 
-		cmt++;
+		if (!isWrite && sequentialReads > 0 && CACHE_DFTL_PREFETCH > 0)
+			prefetch_mappings(event, dlpn);
 	}
 }
 
-void FtlImpl_DftlParent::evict_page_from_cache(Event &event)
+// Cache the mappings that follow dlpn on the translation page consult_GTD
+// just read, so the prefetch costs no flash read. At most half the CMT is
+// prefetched at once to leave room for the mappings already in use.
+void FtlImpl_DftlParent::prefetch_mappings(Event &event, long dlpn)
 {
-	while (cmt >= totalCMTentries)
+	long end = dlpn - dlpn % addressPerPage + addressPerPage;
+	long depth = std::min(CACHE_DFTL_PREFETCH, totalCMTentries / 2);
+	end = std::min(end, std::min(dlpn + 1 + depth, (long) NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE));
+
+	for (long vpn = dlpn + 1; vpn < end; vpn++)
 	{
-		// Find page to evict
-		MpageByLastVisited::iterator evictit = boost::multi_index::get<1>(trans_map).begin();
-		MPage evictPage = *evictit;
+		if (cmt->contains(vpn))
+			continue;
 
-		assert(evictPage.cached && evictPage.create_ts >= 0 && evictPage.modified_ts >= 0);
+		evict_page_from_cache(event);
+		cmt->insert(vpn, false);
+		cmt->mark_prefetched(vpn);
+		controller.stats.numCachePrefetches++;
+	}
+}
+
+void FtlImpl_DftlParent::evict_page_from_cache(Event &event)
+{
+	while (cmt->size() >= totalCMTentries)
+	{
+		// Remove the page the replacement policy picks
+		bool dirty;
+		long vpn = cmt->evict(dirty);
+		controller.stats.numCacheEvictions++;
 
-		if (evictPage.create_ts != evictPage.modified_ts)
+		if (dirty)
 		{
-			// Evict page
-			// Inform the ssd model that it should invalidate the previous page.
-			// Calculate the start address of the translation page.
-			int vpnBase = evictPage.vpn - evictPage.vpn % addressPerPage;
-
-			for (int i=0;i<addressPerPage;i++)
-			{
-				MPage cur = trans_map[vpnBase+i];
-				if (cur.cached)
-				{
-					cur.create_ts = cur.modified_ts;
-					trans_map.replace(trans_map.begin()+vpnBase+i, cur);
-				}
-			}
-
-			// Simulate the write to translate page
-			Event write_event = Event(WRITE, event.get_logical_address(), 1, event.get_start_time());
-			write_event.set_address(Address(0, PAGE));
-			write_event.set_noop(true);
-
-			if (controller.issue(write_event) == FAILURE) {	assert(false);}
-
-			event.incr_time_taken(write_event.get_time_taken());
-			controller.stats.numFTLWrite++;
-			controller.stats.numGCWrite++;
+			controller.stats.numCacheDirtyEvictions++;
+			write_back_translation_page(event, vpn);
 		}
-
-		// Remove page from cache.
-		cmt--;
-
-		evictPage.cached = false;
-		reset_MPage(evictPage);
-		trans_map.replace(trans_map.begin()+evictPage.vpn, evictPage);
 	}
 }
 
 void FtlImpl_DftlParent::evict_specific_page_from_cache(Event &event, long lba)
 {
-		// Find page to evict
-		MPage evictPage = trans_map[lba];
+	if (!cmt->contains(lba))
+		return;
 
-		if (!evictPage.cached)
-			return;
+	if (cmt->is_dirty(lba))
+		write_back_translation_page(event, lba);
 
-		assert(evictPage.cached && evictPage.create_ts >= 0 && evictPage.modified_ts >= 0);
+	// Remove page from cache.
+	cmt->erase(lba);
+}
 
-		if (evictPage.create_ts != evictPage.modified_ts)
-		{
-			// Evict page
-			// Inform the ssd model that it should invalidate the previous page.
-			// Calculate the start address of the translation page.
-			int vpnBase = evictPage.vpn - evictPage.vpn % addressPerPage;
-
-			for (int i=0;i<addressPerPage;i++)
-			{
-				MPage cur = trans_map[vpnBase+i];
-				if (cur.cached)
-				{
-					cur.create_ts = cur.modified_ts;
-					trans_map.replace(trans_map.begin()+vpnBase+i, cur);
-				}
-			}
-
-			// Simulate the write to translate page
-			Event write_event = Event(WRITE, event.get_logical_address(), 1, event.get_start_time());
-			write_event.set_address(Address(0, PAGE));
-			write_event.set_noop(true);
-
-			if (controller.issue(write_event) == FAILURE) {	assert(false);}
-
-			event.incr_time_taken(write_event.get_time_taken());
-			controller.stats.numFTLWrite++;
-			controller.stats.numGCWrite++;
-		}
+// Write the translation page holding the mapping of vpn, which cleans all
+// cached mappings on that page.
+void FtlImpl_DftlParent::write_back_translation_page(Event &event, long vpn)
+{
+	cmt->clean_page(vpn);
+
+	// Simulate the write to translate page
+	Event write_event = Event(WRITE, event.get_logical_address(), 1, event.get_start_time());
+	write_event.set_address(Address(0, PAGE));
+	write_event.set_noop(true);
 
-		// Remove page from cache.
-		cmt--;
+	if (controller.issue(write_event) == FAILURE) {	assert(false);}
 
-		evictPage.cached = false;
-		reset_MPage(evictPage);
-		trans_map.replace(trans_map.begin()+evictPage.vpn, evictPage);
+	event.join(write_event);
+	controller.stats.numFTLWrite++;
+	controller.stats.numGCWrite++;
+}
 
+void FtlImpl_DftlParent::update_translation_map(long vpn, long ppn)
+{
+	trans_map[vpn] = ppn;
+	if (ppn != -1)
+		reverse_trans_map[ppn] = vpn;
 }
 
-void FtlImpl_DftlParent::update_translation_map(FtlImpl_DftlParent::MPage &mpage, long ppn)
+void FtlImpl_DftlParent::snapshot(Snapshot &snapshot)
 {
-	mpage.ppn = ppn;
-	reverse_trans_map[ppn] = mpage.vpn;
+	FtlParent::snapshot(snapshot);
+	snapshot.section("dftl");
+	snapshot.io(currentDataPage);
+	snapshot.io(currentTranslationPage);
+	snapshot.io(lastReadPage);
+	snapshot.io(sequentialReads);
+	snapshot.io_array(trans_map, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE);
+	snapshot.io_array(reverse_trans_map, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE);
+	cmt->snapshot(snapshot);
 }
@@ -53,6 +53,8 @@ FtlImpl_Fast::FtlImpl_Fast(Controller &controller):
 
 	log_pages = NULL;
 
+	log_index.reserve(FAST_LOG_BLOCK_LIMIT*BLOCK_SIZE);
+
 	printf("Total mapping table size: %luKB\n", NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(uint) / 1024);
 	printf("Using FAST FTL.\n");
 }
@@ -71,13 +73,13 @@ void FtlImpl_Fast::initialize_log_pages()
 	Event event = Event(WRITE, 1, 1, 0);
 	// RW
 	log_pages = new LogPageBlock;
-	log_pages->address = Block_manager::instance()->get_free_block(LOG, event);
+	log_pages->address = manager.get_free_block(LOG, event);
 
 	LogPageBlock *next = log_pages;
 	for (uint i=0;i<FAST_LOG_BLOCK_LIMIT-1;i++)
 	{
 		LogPageBlock *newLPB = new LogPageBlock();
-		newLPB->address = Block_manager::instance()->get_free_block(LOG, event);
+		newLPB->address = manager.get_free_block(LOG, event);
 		next->next = newLPB;
 		next = newLPB;
 	}
@@ -92,31 +94,12 @@ enum status FtlImpl_Fast::read(Event &event)
 
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	LogPageBlock *currentBlock = log_pages;
-
-	bool found = false;
-	while (!found && currentBlock != NULL)
-	{
-		for (int i=0;i<currentBlock->numPages;i++)
-		{
-			//event.incr_time_taken(RAM_READ_DELAY);
-
-			if (currentBlock->aPages[i] == (long)event.get_logical_address())
-			{
-				Address readAddress = Address(currentBlock->address.get_linear_address() + i, PAGE);
-				event.set_address(readAddress);
-
-				// Cancel the while and for loop
-				found = true;
-				break;
-			}
-		}
-
-		currentBlock = currentBlock->next;
-	}
-
-	if (!found)
+	std::unordered_map<long, log_location>::const_iterator found = log_index.find(event.get_logical_address());
+	if (found != log_index.end())
 	{
+		Address readAddress = Address(found->second.block->address.get_linear_address() + found->second.offset, PAGE);
+		event.set_address(readAddress);
+	} else {
 		if (sequential_logicalblock_address == lookupBlock && sequential_offset > lbnOffset)
 		{
 			event.set_address(Address(sequential_address.get_linear_address() + lbnOffset, PAGE));
@@ -147,12 +130,15 @@ enum status FtlImpl_Fast::write(Event &event)
 
 	pin_list[event.get_logical_address()] = true;
 
+	// The copy in the RW log is stale unless this write goes there too
+	log_index.erase(event.get_logical_address());
+
 	uint lbnOffset = event.get_logical_address() % BLOCK_SIZE;
 
 	// if a collision occurs at offset of the data block of pbn.
 	if (data_list[logicalBlockAddress] == -1)
 	{
-		Address newBlock = Block_manager::instance()->get_free_block(DATA, event);
+		Address newBlock = manager.get_free_block(DATA, event);
 
 		// Register the mapping
 		data_list[logicalBlockAddress] = newBlock.get_linear_address();
@@ -173,7 +159,7 @@ enum status FtlImpl_Fast::write(Event &event)
 	}
 
 	// Insert go sarbage collection
-	Block_manager::instance()->insert_events(event);
+	manager.insert_events(event);
 
 	// Statistics
 	controller.stats.numFTLWrite++;
@@ -193,38 +179,25 @@ enum status FtlImpl_Fast::trim(Event &event)
 
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	LogPageBlock *currentBlock = log_pages;
-
-	bool found = false;
-	while (!found && currentBlock != NULL)
+	std::unordered_map<long, log_location>::iterator found = log_index.find(event.get_logical_address());
+	if (found != log_index.end())
 	{
-		for (int i=0;i<currentBlock->numPages;i++)
-		{
-			if (currentBlock->aPages[i] == (long)event.get_logical_address())
-			{
-				Address address = Address(currentBlock->address.get_linear_address() + i, PAGE);
-				Block *block = controller.get_block_pointer(address);
-				block->invalidate_page(address.page);
+		LogPageBlock *currentBlock = found->second.block;
+		int i = found->second.offset;
+		log_index.erase(found);
 
-				currentBlock->aPages[i] = -1;
+		Address address = Address(currentBlock->address.get_linear_address() + i, PAGE);
+		Block *block = controller.get_block_pointer(address);
+		block->invalidate_page(address.page);
 
-				if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
-				{
-					Block_manager::instance()->erase_and_invalidate(event, currentBlock->address, LOG);
-					data_list[lookupBlock] = -1;
-				}
+		currentBlock->aPages[i] = -1;
 
-				// Cancel the while and for loop
-				found = true;
-				break;
-			}
+		if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
+		{
+			manager.erase_and_invalidate(event, currentBlock->address, LOG);
+			data_list[lookupBlock] = -1;
 		}
-
-		currentBlock = currentBlock->next;
-	}
-
-	if (!found)
-	{
+	} else {
 		if (sequential_logicalblock_address == lookupBlock && sequential_offset > lbnOffset)
 		{
 			Address address = Address(sequential_address.get_linear_address() + lbnOffset, PAGE);
@@ -233,7 +206,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 
 			if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 			{
-				Block_manager::instance()->erase_and_invalidate(event, address, LOG);
+				manager.erase_and_invalidate(event, address, LOG);
 				sequential_logicalblock_address = -1;
 			}
 
@@ -247,7 +220,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 
 			if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 			{
-				Block_manager::instance()->erase_and_invalidate(event, address, LOG);
+				manager.erase_and_invalidate(event, address, LOG);
 				data_list[lookupBlock] = -1;
 			}
 		}
@@ -257,7 +230,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 	event.set_address(Address(0, PAGE));
 
 	// Insert garbage collection
-	Block_manager::instance()->insert_events(event);
+	manager.insert_events(event);
 
 	// Statistics
 	controller.stats.numFTLTrim++;
@@ -270,7 +243,7 @@ void FtlImpl_Fast::switch_sequential(Event &event)
 	// Add to empty list i.e. switch without erasing the datablock.
 
 	if (data_list[sequential_logicalblock_address] != -1)
-		Block_manager::instance()->invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
+		manager.invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
 
 	data_list[sequential_logicalblock_address] = sequential_address.get_linear_address();
 
@@ -287,11 +260,11 @@ void FtlImpl_Fast::merge_sequential(Event &event)
 	// Do merge (n reads, n writes and 2 erases (gc'ed))
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	Address newDataBlock = Block_manager::instance()->get_free_block(DATA, event);
+	Address newDataBlock = manager.get_free_block(DATA, event);
 	//printf("Using new data block with address: %lu Block: %u\n", newDataBlock.get_linear_address(), newDataBlock.block);
 
-	if (Block_manager::instance()->get_num_free_blocks() < 5)
-		Block_manager::instance()->insert_events(event);
+	if (manager.get_num_free_blocks() < 5)
+		manager.insert_events(event);
 
 	for (uint i=0;i<BLOCK_SIZE;i++)
 	{
@@ -311,11 +284,11 @@ void FtlImpl_Fast::merge_sequential(Event &event)
 		if (controller.issue(readEvent) == FAILURE) { printf("Read failed\n"); return; }
 
 		Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
-		writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+		writeEvent.set_payload(controller.get_page_data(readAddress.get_linear_address()));
 		writeEvent.set_address(Address(newDataBlock.get_linear_address() + i, PAGE));
 		if (controller.issue(writeEvent) == FAILURE) {  printf("Write failed\n"); return; }
 
-		event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+		event.join(writeEvent);
 
 		// Statistics
 		controller.stats.numFTLRead++;
@@ -325,9 +298,9 @@ void FtlImpl_Fast::merge_sequential(Event &event)
 	}
 
 	// Invalidate inactive pages
-	Block_manager::instance()->invalidate(&sequential_address, DATA);
+	manager.invalidate(&sequential_address, DATA);
 	if (data_list[sequential_logicalblock_address] != -1)
-		Block_manager::instance()->invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
+		manager.invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
 
 	// Update mapping
 	data_list[sequential_logicalblock_address] = newDataBlock.get_linear_address();
@@ -361,10 +334,10 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 		for (uint i=0;i<BLOCK_SIZE;++i)
 			pinned[i] = false;
 
-		if (Block_manager::instance()->get_num_free_blocks() < 5)
-			Block_manager::instance()->insert_events(event);
+		if (manager.get_num_free_blocks() < 5)
+			manager.insert_events(event);
 
-		Address mergeAddress = Block_manager::instance()->get_free_block(DATA, event);
+		Address mergeAddress = manager.get_free_block(DATA, event);
 
 		long victimLBA = m->first;
 		if (victimLBA == -1)
@@ -404,12 +377,12 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 						//event.consolidate_metaevent(readEvent);
 
 						Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
-						writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+						writeEvent.set_payload(controller.get_page_data(readAddress.get_linear_address()));
 						writeEvent.set_address(writeAddress);
 
 						if (controller.issue(writeEvent) == FAILURE) { printf("failed\n"); return false; }
 						//event.consolidate_metaevent(writeEvent);
-						event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+						event.join(writeEvent);
 
 						pinned[lpb->aPages[i]%BLOCK_SIZE] = true;
 
@@ -441,12 +414,12 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 
 					// Write the page to merge address
 					Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
-					writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+					writeEvent.set_payload(controller.get_page_data(readAddress.get_linear_address()));
 					writeEvent.set_address(writeAddress);
 					if (controller.issue(writeEvent) == FAILURE) { printf("failed\n"); return false;	}
 					//event.consolidate_metaevent(writeEvent);
 
-					event.incr_time_taken(writeEvent.get_time_taken() + readEvent.get_time_taken());
+					event.join(writeEvent);
 
 					pinned[i] = true;
 
@@ -460,10 +433,13 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 		}
 
 		// Invalidate inactive pages
-		Block_manager::instance()->invalidate(Address(data_list[victimLBA], BLOCK), DATA);
+		manager.invalidate(Address(data_list[victimLBA], BLOCK), DATA);
 
 		data_list[victimLBA] = mergeAddress.get_linear_address();
 
+		// The merged data block holds the newest copy of every page
+		drop_log_index(victimLBA);
+
 	}
 
 	controller.stats.numLogMergeFull++;
@@ -499,7 +475,7 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 		 */
 
 		sequential_offset = 1;
-		sequential_address = Block_manager::instance()->get_free_block(DATA, event);
+		sequential_address = manager.get_free_block(DATA, event);
 		sequential_logicalblock_address = logicalBlockAddress;
 
 		event.set_address(sequential_address);
@@ -523,7 +499,7 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 				merge_sequential(event);
 
 				sequential_offset = 1;
-				sequential_address = Block_manager::instance()->get_free_block(DATA, event);
+				sequential_address = manager.get_free_block(DATA, event);
 				sequential_logicalblock_address = logicalBlockAddress;
 
 				// Append data to the SW log block
@@ -546,12 +522,12 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 
 				// Maintain the log page list
 				log_pages = log_pages->next;
-				Block_manager::instance()->invalidate(&victim->address, LOG);
+				manager.invalidate(&victim->address, LOG);
 				delete victim;
 
 				// Create new LogPageBlock and append it to the log_pages list.
 				LogPageBlock *newLPB = new LogPageBlock();
-				newLPB->address = Block_manager::instance()->get_free_block(LOG, event);
+				newLPB->address = manager.get_free_block(LOG, event);
 
 				LogPageBlock *next = log_pages;
 				while (next->next != NULL) next = next->next;
@@ -569,6 +545,9 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 			victim->aPages[log_page_next % BLOCK_SIZE] = event.get_logical_address();
 			victim->numPages++;
 
+			log_location location = {victim, (int) (log_page_next % BLOCK_SIZE)};
+			log_index[event.get_logical_address()] = location;
+
 			Address rw = victim->address;
 			rw.valid = PAGE;
 			rw += log_page_next % BLOCK_SIZE;
@@ -581,6 +560,12 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 	return true;
 }
 
+void FtlImpl_Fast::drop_log_index(long logicalBlockAddress)
+{
+	for (uint i=0;i<BLOCK_SIZE;i++)
+		log_index.erase((logicalBlockAddress << addressShift) + i);
+}
+
 void FtlImpl_Fast::update_map_block(Event &event)
 {
 	Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time());
@@ -589,7 +574,7 @@ void FtlImpl_Fast::update_map_block(Event &event)
 
 	controller.issue(writeEvent);
 
-	event.incr_time_taken(writeEvent.get_time_taken());
+	event.join(writeEvent);
 
 	controller.stats.numGCWrite++;
 	controller.stats.numFTLWrite++;
@@ -598,6 +583,78 @@ void FtlImpl_Fast::update_map_block(Event &event)
 
 void FtlImpl_Fast::print_ftl_statistics()
 {
-	Block_manager::instance()->print_statistics();
+	manager.print_statistics();
 }
 
+
+void FtlImpl_Fast::snapshot(Snapshot &snapshot)
+{
+	FtlParent::snapshot(snapshot);
+	snapshot.section("fast");
+	snapshot.io_array(data_list, NUMBER_OF_ADDRESSABLE_BLOCKS);
+	snapshot.io_array(pin_list, NUMBER_OF_ADDRESSABLE_BLOCKS*BLOCK_SIZE);
+	snapshot.io(sequential_logicalblock_address);
+	snapshot.io_address(sequential_address);
+	snapshot.io(sequential_offset);
+	snapshot.io(log_page_next);
+
+	// The RW log blocks are a list, saved as its length followed by the blocks in order.
+	ulong count = 0;
+	for (LogPageBlock *lpb = log_pages; lpb != NULL; lpb = lpb->next)
+		count++;
+	snapshot.io(count);
+	std::vector<LogPageBlock *> blocks;
+	if (snapshot.is_saving())
+	{
+		for (LogPageBlock *lpb = log_pages; lpb != NULL; lpb = lpb->next)
+		{
+			lpb->snapshot(snapshot);
+			blocks.push_back(lpb);
+		}
+	} else {
+		while (log_pages != NULL)
+		{
+			LogPageBlock *next = log_pages->next;
+			delete log_pages;
+			log_pages = next;
+		}
+		LogPageBlock **tail = &log_pages;
+		for (ulong i = 0; i < count; i++)
+		{
+			*tail = new LogPageBlock();
+			(*tail)->snapshot(snapshot);
+			blocks.push_back(*tail);
+			tail = &(*tail)->next;
+		}
+	}
+
+	// The log index refers to the blocks by their position in the list.
+	std::vector<long> lpns;
+	std::vector<ulong> positions;
+	std::vector<int> offsets;
+	if (snapshot.is_saving())
+	{
+		std::unordered_map<LogPageBlock *, ulong> position;
+		for (ulong i = 0; i < blocks.size(); i++)
+			position[blocks[i]] = i;
+		typedef std::unordered_map<long, log_location>::const_iterator LI;
+		for (LI l = log_index.begin(); l != log_index.end(); ++l)
+		{
+			lpns.push_back(l->first);
+			positions.push_back(position[l->second.block]);
+			offsets.push_back(l->second.offset);
+		}
+	}
+	snapshot.io_vector(lpns);
+	snapshot.io_vector(positions);
+	snapshot.io_vector(offsets);
+	if (snapshot.is_saving())
+		return;
+
+	log_index.clear();
+	for (ulong i = 0; i < lpns.size(); i++)
+	{
+		log_location location = {blocks[positions[i]], offsets[i]};
+		log_index[lpns[i]] = location;
+	}
+}
@@ -0,0 +1,202 @@
+/* Copyright 2011 Matias Bjørling */
+
+/* log_block_map.cpp  */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Log block map of BAST
+ *
+ * Associates logical blocks with their log block. Entries are kept dense in
+ * an array, erasing one moves the last entry into its place, so a random
+ * victim is a single draw over the array. A hash map from logical blocks to
+ * entries finds them and a list chained by index through the entries keeps
+ * them oldest first for FIFO and LRU victims.
+ */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../ssd.h"
+
+using namespace ssd;
+
+Log_block_map::Log_block_map(uint limit):
+	head(-1),
+	tail(-1)
+{
+	if (BAST_LOG_VICTIM > 2)
+	{
+		fprintf(stderr, "Log_block_map error: %s: unknown BAST_LOG_VICTIM %u\n", __func__, BAST_LOG_VICTIM);
+		exit(FILE_ERR);
+	}
+
+	entries.reserve(limit);
+	index.reserve(limit);
+}
+
+Log_block_map::~Log_block_map(void)
+{
+	for (uint i = 0; i < entries.size(); i++)
+		delete entries[i].block;
+}
+
+int Log_block_map::find_entry(long lba) const
+{
+	std::unordered_map<long, int>::const_iterator found = index.find(lba);
+	return found == index.end() ? -1 : found->second;
+}
+
+// Returns the log block of lba or NULL if it has none
+LogPageBlock *Log_block_map::find(long lba) const
+{
+	int i = find_entry(lba);
+	return i == -1 ? NULL : entries[i].block;
+}
+
+uint Log_block_map::size(void) const
+{
+	return entries.size();
+}
+
+// Link an entry in as the newest
+void Log_block_map::link(int i)
+{
+	entries[i].next = -1;
+	entries[i].prev = tail;
+	if (tail != -1)
+		entries[tail].next = i;
+	tail = i;
+	if (head == -1)
+		head = i;
+}
+
+void Log_block_map::unlink(int i)
+{
+	entry &e = entries[i];
+	if (e.prev != -1)
+		entries[e.prev].next = e.next;
+	else
+		head = e.next;
+	if (e.next != -1)
+		entries[e.next].prev = e.prev;
+	else
+		tail = e.prev;
+}
+
+// Takes ownership of block, lba must not have a log block
+void Log_block_map::insert(long lba, LogPageBlock *block)
+{
+	assert(find_entry(lba) == -1);
+
+	int i = entries.size();
+	entry e = {lba, block, -1, -1};
+	entries.push_back(e);
+	link(i);
+	index[lba] = i;
+}
+
+// Deletes the log block of lba
+void Log_block_map::erase(long lba)
+{
+	std::unordered_map<long, int>::iterator found = index.find(lba);
+	assert(found != index.end());
+	int i = found->second;
+	index.erase(found);
+
+	unlink(i);
+	delete entries[i].block;
+
+	// Move the last entry into the gap
+	int last = entries.size() - 1;
+	if (i != last)
+	{
+		entry &e = entries[i];
+		e = entries[last];
+		index[e.lba] = i;
+		if (e.prev != -1)
+			entries[e.prev].next = i;
+		else
+			head = i;
+		if (e.next != -1)
+			entries[e.next].prev = i;
+		else
+			tail = i;
+	}
+	entries.pop_back();
+}
+
+// A write to the log block of lba, makes it the newest for LRU
+void Log_block_map::touch(long lba)
+{
+	if (BAST_LOG_VICTIM != 2)
+		return;
+
+	int i = find_entry(lba);
+	assert(i != -1);
+	if (i == tail)
+		return;
+	unlink(i);
+	link(i);
+}
+
+// The map must not be empty
+long Log_block_map::victim(void) const
+{
+	assert(!entries.empty());
+	if (BAST_LOG_VICTIM == 0)
+		return entries[random() % entries.size()].lba;
+	return entries[head].lba;
+}
+
+// Entries are stored in array order with their list links, so a random
+// victim draws the same entry after a load
+void Log_block_map::snapshot(Snapshot &snapshot)
+{
+	std::vector<long> lbas;
+	std::vector<int> links;
+	for (uint i = 0; i < entries.size(); i++)
+	{
+		lbas.push_back(entries[i].lba);
+		links.push_back(entries[i].prev);
+		links.push_back(entries[i].next);
+	}
+	snapshot.io_vector(lbas);
+	snapshot.io_vector(links);
+	snapshot.io(head);
+	snapshot.io(tail);
+
+	if (snapshot.is_saving())
+	{
+		for (uint i = 0; i < entries.size(); i++)
+			entries[i].block->snapshot(snapshot);
+		return;
+	}
+
+	for (uint i = 0; i < entries.size(); i++)
+		delete entries[i].block;
+	entries.resize(lbas.size());
+	index.clear();
+	for (uint i = 0; i < entries.size(); i++)
+	{
+		entries[i].lba = lbas[i];
+		entries[i].prev = links[2 * i];
+		entries[i].next = links[2 * i + 1];
+		entries[i].block = new LogPageBlock();
+		entries[i].block->snapshot(snapshot);
+		index[lbas[i]] = i;
+	}
+}
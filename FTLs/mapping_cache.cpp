@@ -0,0 +1,382 @@
+/* Copyright 2011 Matias Bjørling */
+
+/* mapping_cache.cpp  */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Cached Mapping Table (CMT) of the DFTL family
+ *
+ * Holds which logical pages have their mapping cached and whether the cached
+ * mapping differs from the translation page in flash. The mappings themselves
+ * stay in the GTD of the FTL. Entries are kept in an array and chained by
+ * index into the queues of the replacement policy (see cache_policies.cpp),
+ * an open addressing hash table maps logical pages to entries. Ghost entries
+ * of evicted pages are hashed too, so a policy finds them with the same probe.
+ */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../ssd.h"
+
+using namespace ssd;
+
+Mapping_cache *Mapping_cache::create(uint capacity, uint entries_per_page)
+{
+	switch (CACHE_DFTL_POLICY)
+	{
+	case 0:
+		return new Mapping_cache_Lru(capacity, entries_per_page);
+	case 1:
+		return new Mapping_cache_Clock(capacity, entries_per_page);
+	case 2:
+		return new Mapping_cache_2Q(capacity, entries_per_page);
+	case 3:
+		return new Mapping_cache_Arc(capacity, entries_per_page);
+	case 4:
+		return new Mapping_cache_S3Fifo(capacity, entries_per_page);
+	case 5:
+		return new Mapping_cache_Tpftl(capacity, entries_per_page);
+	}
+	fprintf(stderr, "Mapping_cache error: %s: unknown CACHE_DFTL_POLICY %u\n", __func__, CACHE_DFTL_POLICY);
+	exit(FILE_ERR);
+}
+
+Mapping_cache::Mapping_cache(uint capacity, uint entries_per_page, uint num_queues, uint num_ghost_queues):
+	num_resident_queues(num_queues),
+	capacity(capacity),
+	entries_per_page(entries_per_page),
+	bucket_bits(1),
+	free_list(-1),
+	count(0),
+	used(0)
+{
+	queue empty = {-1, -1, 0};
+	queues.assign(num_queues + num_ghost_queues, empty);
+
+	// Keep the hash table at most half full
+	while ((1UL << bucket_bits) < 2UL * capacity)
+		bucket_bits++;
+
+	entries.reserve(capacity);
+	buckets.assign(1UL << bucket_bits, -1);
+}
+
+Mapping_cache::~Mapping_cache(void)
+{
+}
+
+uint Mapping_cache::bucket(long vpn) const
+{
+	return ((ulong) vpn * 11400714819323198485UL) >> (64 - bucket_bits);
+}
+
+// Returns the entry of vpn, resident or ghost, or -1 if there is none
+int Mapping_cache::find(long vpn) const
+{
+	uint mask = buckets.size() - 1;
+	for (uint i = bucket(vpn); buckets[i] != -1; i = (i + 1) & mask)
+		if (entries[buckets[i]].vpn == vpn)
+			return buckets[i];
+	return -1;
+}
+
+// Returns the ghost entry of vpn or -1 if vpn is cached or not remembered
+int Mapping_cache::find_ghost(long vpn) const
+{
+	int index = find(vpn);
+	if (index != -1 && entries[index].queue < num_resident_queues)
+		return -1;
+	return index;
+}
+
+// Returns the entry of a cached vpn and dirties it on a write
+int Mapping_cache::hit(long vpn, bool dirty)
+{
+	int index = find(vpn);
+	assert(index != -1 && entries[index].queue < num_resident_queues);
+	if (dirty)
+		entries[index].dirty = true;
+	return index;
+}
+
+bool Mapping_cache::contains(long vpn) const
+{
+	int index = find(vpn);
+	return index != -1 && entries[index].queue < num_resident_queues;
+}
+
+bool Mapping_cache::is_dirty(long vpn) const
+{
+	int index = find(vpn);
+	assert(index != -1 && entries[index].queue < num_resident_queues);
+	return entries[index].dirty;
+}
+
+uint Mapping_cache::size(void) const
+{
+	return count;
+}
+
+// Link an entry in at the front or at the tail of a queue
+void Mapping_cache::link(int index, uint q, bool front)
+{
+	entry &e = entries[index];
+	queue &l = queues[q];
+	e.queue = q;
+	if (front)
+	{
+		e.prev = -1;
+		e.next = l.head;
+		if (l.head != -1)
+			entries[l.head].prev = index;
+		l.head = index;
+		if (l.tail == -1)
+			l.tail = index;
+	} else {
+		e.next = -1;
+		e.prev = l.tail;
+		if (l.tail != -1)
+			entries[l.tail].next = index;
+		l.tail = index;
+		if (l.head == -1)
+			l.head = index;
+	}
+	l.size++;
+	if (q < num_resident_queues)
+		count++;
+}
+
+void Mapping_cache::unlink(int index)
+{
+	entry &e = entries[index];
+	queue &l = queues[e.queue];
+	if (e.prev != -1)
+		entries[e.prev].next = e.next;
+	else
+		l.head = e.next;
+	if (e.next != -1)
+		entries[e.next].prev = e.prev;
+	else
+		l.tail = e.prev;
+	l.size--;
+	if (e.queue < num_resident_queues)
+		count--;
+}
+
+// Add an entry for vpn, which must have none, to a queue
+int Mapping_cache::add(long vpn, uint q, bool dirty, bool front)
+{
+	assert(find(vpn) == -1);
+
+	if (2UL * (used + 1) > buckets.size())
+		rehash(buckets.size() * 2);
+
+	int index;
+	if (free_list != -1)
+	{
+		index = free_list;
+		free_list = entries[index].next;
+	} else {
+		index = entries.size();
+		entries.push_back(entry());
+	}
+
+	entries[index].vpn = vpn;
+	entries[index].hits = 0;
+	entries[index].dirty = dirty;
+	entries[index].prefetched = false;
+	link(index, q, front);
+
+	uint mask = buckets.size() - 1;
+	uint i = bucket(vpn);
+	while (buckets[i] != -1)
+		i = (i + 1) & mask;
+	buckets[i] = index;
+	used++;
+	return index;
+}
+
+void Mapping_cache::move(int index, uint q, bool front)
+{
+	unlink(index);
+	link(index, q, front);
+}
+
+// Evict an entry without remembering it
+long Mapping_cache::drop(int index, bool &dirty)
+{
+	long vpn = entries[index].vpn;
+	dirty = entries[index].dirty;
+	remove(index);
+	return vpn;
+}
+
+// Evict an entry into the front of a ghost queue, which forgets its oldest
+// ghosts beyond ghost_limit
+long Mapping_cache::demote(int index, uint ghost_queue, uint ghost_limit, bool &dirty)
+{
+	long vpn = entries[index].vpn;
+	dirty = entries[index].dirty;
+	entries[index].dirty = false;
+	move(index, ghost_queue, true);
+	while (queues[ghost_queue].size > ghost_limit)
+		remove(queues[ghost_queue].tail);
+	return vpn;
+}
+
+// Ignored when vpn is not cached
+void Mapping_cache::set_dirty(long vpn, bool dirty)
+{
+	int index = find(vpn);
+	if (index != -1 && entries[index].queue < num_resident_queues)
+		entries[index].dirty = dirty;
+}
+
+// Ignored when vpn is not cached
+void Mapping_cache::mark_prefetched(long vpn)
+{
+	int index = find(vpn);
+	if (index != -1 && entries[index].queue < num_resident_queues)
+		entries[index].prefetched = true;
+}
+
+// Returns whether a cached vpn was prefetched and not used before
+bool Mapping_cache::clear_prefetched(long vpn)
+{
+	int index = find(vpn);
+	if (index == -1 || entries[index].queue >= num_resident_queues || !entries[index].prefetched)
+		return false;
+	entries[index].prefetched = false;
+	return true;
+}
+
+// Without a grouping by translation page every sibling is looked up
+void Mapping_cache::clean_page(long vpn)
+{
+	long first = vpn - vpn % entries_per_page;
+	for (uint i = 0; i < entries_per_page; i++)
+		set_dirty(first + i, false);
+}
+
+// Forget a cached mapping without making it a ghost
+void Mapping_cache::erase(long vpn)
+{
+	int index = find(vpn);
+	assert(index != -1 && entries[index].queue < num_resident_queues);
+	remove(index);
+}
+
+void Mapping_cache::remove(int index)
+{
+	uint mask = buckets.size() - 1;
+	uint i = bucket(entries[index].vpn);
+	while (buckets[i] != index)
+		i = (i + 1) & mask;
+
+	unlink(index);
+	entries[index].next = free_list;
+	free_list = index;
+	used--;
+
+	// Shift back the entries of the probe sequence that follow the hole
+	uint hole = i;
+	for (i = (i + 1) & mask; buckets[i] != -1; i = (i + 1) & mask)
+	{
+		uint home = bucket(entries[buckets[i]].vpn);
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			buckets[hole] = buckets[i];
+			hole = i;
+		}
+	}
+	buckets[hole] = -1;
+}
+
+void Mapping_cache::rehash(uint num_buckets)
+{
+	while ((1UL << bucket_bits) < num_buckets)
+		bucket_bits++;
+	buckets.assign(1UL << bucket_bits, -1);
+
+	uint mask = buckets.size() - 1;
+	for (uint q = 0; q < queues.size(); q++)
+		for (int index = queues[q].head; index != -1; index = entries[index].next)
+		{
+			uint i = bucket(entries[index].vpn);
+			while (buckets[i] != -1)
+				i = (i + 1) & mask;
+			buckets[i] = index;
+		}
+}
+
+void Mapping_cache::clear(void)
+{
+	queue empty = {-1, -1, 0};
+	entries.clear();
+	buckets.assign(buckets.size(), -1);
+	queues.assign(queues.size(), empty);
+	free_list = -1;
+	count = 0;
+	used = 0;
+}
+
+// Bytes of SRAM the cache takes
+ulong Mapping_cache::get_memory_size(void) const
+{
+	return entries.capacity() * sizeof(entry) + buckets.size() * sizeof(int);
+}
+
+// State of the policy beyond its queues
+void Mapping_cache::snapshot_policy(Snapshot &snapshot)
+{
+}
+
+// Each queue is stored from its tail to its head, ghosts included; the flags
+// hold dirty in bit 0 and prefetched in bit 1
+void Mapping_cache::snapshot(Snapshot &snapshot)
+{
+	std::vector<std::vector<long> > vpns(queues.size());
+	std::vector<std::vector<unsigned char> > hits(queues.size());
+	std::vector<std::vector<unsigned char> > flags(queues.size());
+	for (uint q = 0; q < queues.size(); q++)
+		for (int index = queues[q].tail; index != -1; index = entries[index].prev)
+		{
+			vpns[q].push_back(entries[index].vpn);
+			hits[q].push_back(entries[index].hits);
+			flags[q].push_back(entries[index].dirty | entries[index].prefetched << 1);
+		}
+
+	for (uint q = 0; q < queues.size(); q++)
+	{
+		snapshot.io_vector(vpns[q]);
+		snapshot.io_vector(hits[q]);
+		snapshot.io_vector(flags[q]);
+	}
+	snapshot_policy(snapshot);
+	if (snapshot.is_saving())
+		return;
+
+	clear();
+	for (uint q = 0; q < queues.size(); q++)
+		for (ulong i = 0; i < vpns[q].size(); i++)
+		{
+			entry &e = entries[add(vpns[q][i], q, flags[q][i] & 1, true)];
+			e.hits = hits[q][i];
+			e.prefetched = flags[q][i] >> 1;
+		}
+}
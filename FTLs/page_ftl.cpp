@@ -17,7 +17,15 @@
 
 /****************************************************************************/
 
-/* Implements a very simple page-level FTL without merge */
+/* Page-level FTL
+ *
+ * Every logical page maps to any physical page, the whole map is held in SRAM.
+ * The host writes go to the open blocks of the Block_manager, one per die
+ * unless BLOCK_ALLOCATION is linear, and the pages garbage collection moves
+ * to a block of their own, so the pages that survive a collection are kept
+ * apart from the hot ones. The Block_manager collects garbage with the
+ * victim policy of GC_POLICY and hands the victims to cleanup_block.
+ */
 
 #include <new>
 #include <assert.h>
@@ -30,23 +38,64 @@ using namespace ssd;
 FtlImpl_Page::FtlImpl_Page(Controller &controller):
 	FtlParent(controller)
 {
-	trim_map = new bool[NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE];
+	uint ssdSize = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
 
-	numPagesActive = 0;
+	map = new long[ssdSize];
+	reverse_map = new long[ssdSize];
+	for (uint i=0;i<ssdSize;i++)
+	{
+		map[i] = -1;
+		reverse_map[i] = -1;
+	}
+
+	gcFrontier = -1;
+	copycnt = 0;
 
 	return;
 }
 
 FtlImpl_Page::~FtlImpl_Page(void)
 {
-
+	delete[] map;
+	delete[] reverse_map;
 	return;
 }
 
+// The map is in SRAM, a lookup costs a RAM read like a CMT hit in DFTL
+long FtlImpl_Page::lookup(long lpn, Event &event)
+{
+	event.incr_time_taken(RAM_READ_DELAY);
+	controller.stats.numMemoryRead++;
+	return map[lpn];
+}
+
+// Next page of the open block of the pages garbage collection moves
+long FtlImpl_Page::get_gc_page(Event &event)
+{
+	if (gcFrontier == -1 || gcFrontier % BLOCK_SIZE == BLOCK_SIZE - 1)
+		gcFrontier = manager.get_free_block(DATA, event).get_linear_address();
+	else
+		gcFrontier++;
+	return gcFrontier;
+}
+
+void FtlImpl_Page::update_map(long lpn, long ppn)
+{
+	map[lpn] = ppn;
+	if (ppn != -1)
+		reverse_map[ppn] = lpn;
+}
+
 enum status FtlImpl_Page::read(Event &event)
 {
-	event.set_address(Address(0, PAGE));
-	event.set_noop(true);
+	long ppn = lookup(event.get_logical_address(), event);
+	if (ppn == -1)
+	{
+		event.set_address(Address(0, PAGE));
+		event.set_noop(true);
+	}
+	else
+		event.set_address(Address(ppn, PAGE));
 
 	controller.stats.numFTLRead++;
 
@@ -55,65 +104,100 @@ enum status FtlImpl_Page::read(Event &event)
 
 enum status FtlImpl_Page::write(Event &event)
 {
-	event.set_address(Address(1, PAGE));
-	event.set_noop(true);
-
-	controller.stats.numFTLWrite++;
-
-	if (numPagesActive == NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE)
-	{
-		numPagesActive -= BLOCK_SIZE;
+	long lpn = event.get_logical_address();
 
-		Event eraseEvent = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
-		eraseEvent.set_address(Address(0, PAGE));
+	lookup(lpn, event);
 
-		if (controller.issue(eraseEvent) == FAILURE) printf("Erase failed");
+	// Garbage collection may move the page being replaced, so get the free
+	// page before the current mapping.
+	long ppn = manager.get_free_page(event);
 
-		event.incr_time_taken(eraseEvent.get_time_taken());
-
-		controller.stats.numFTLErase++;
+	if (map[lpn] != -1)
+	{
+		event.set_replace_address(Address(map[lpn], PAGE));
+		reverse_map[map[lpn]] = -1;
 	}
 
-	numPagesActive++;
+	update_map(lpn, ppn);
+	event.set_address(Address(ppn, PAGE));
 
+	controller.stats.numFTLWrite++;
 
 	return controller.issue(event);
 }
 
 enum status FtlImpl_Page::trim(Event &event)
 {
-	controller.stats.numFTLTrim++;
-
-	uint dlpn = event.get_logical_address();
+	long lpn = event.get_logical_address();
 
-	if (!trim_map[event.get_logical_address()])
-		trim_map[event.get_logical_address()] = true;
+	event.set_address(Address(0, PAGE));
 
-	// Update trim map and update block map if all pages are trimmed. i.e. the state are reseted to optimal.
-	long addressStart = dlpn - dlpn % BLOCK_SIZE;
-	bool allTrimmed = true;
-	for (uint i=addressStart;i<addressStart+BLOCK_SIZE;i++)
+	long ppn = lookup(lpn, event);
+	if (ppn != -1)
 	{
-		if (!trim_map[i])
-			allTrimmed = false;
+		Address address = Address(ppn, PAGE);
+		controller.get_block_pointer(address)->invalidate_page(address.page);
+		reverse_map[ppn] = -1;
+		update_map(lpn, -1);
+		controller.stats.numMemoryWrite++;
 	}
 
-	if (allTrimmed)
-	{
-		Event eraseEvent = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
-		eraseEvent.set_address(Address(0, PAGE));
-
-		if (controller.issue(eraseEvent) == FAILURE) printf("Erase failed");
-
-		event.incr_time_taken(eraseEvent.get_time_taken());
-
-		for (uint i=addressStart;i<addressStart+BLOCK_SIZE;i++)
-			trim_map[i] = false;
+	controller.stats.numFTLTrim++;
 
-		controller.stats.numFTLErase++;
+	return controller.issue(event);
+}
 
-		numPagesActive -= BLOCK_SIZE;
+// Move the valid pages of a victim of the Block_manager to the garbage
+// collection block, the Block_manager erases it afterwards
+void FtlImpl_Page::cleanup_block(Event &event, Block *block)
+{
+	for (uint i=0;i<BLOCK_SIZE;i++)
+	{
+		assert(block->get_state(i) != EMPTY);
+		if (block->get_state(i) != VALID)
+			continue;
+
+		long oldPpn = block->get_physical_address() + i;
+
+		Event readEvent = Event(READ, event.get_logical_address(), 1, event.get_start_time());
+		readEvent.set_address(Address(oldPpn, PAGE));
+		if (controller.issue(readEvent) == FAILURE)
+			printf("Data block copy failed.");
+
+		long newPpn = get_gc_page(event);
+
+		Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
+		writeEvent.set_address(Address(newPpn, PAGE));
+		writeEvent.set_replace_address(Address(oldPpn, PAGE));
+		writeEvent.set_payload(controller.get_page_data(oldPpn));
+		if (controller.issue(writeEvent) == FAILURE)
+			printf("Data block copy failed.");
+
+		event.join(writeEvent);
+
+		long lpn = reverse_map[oldPpn];
+		assert(lpn != -1 && map[lpn] == oldPpn);
+		reverse_map[oldPpn] = -1;
+		update_map(lpn, newPpn);
+
+		copycnt++;
+		controller.stats.numFTLRead++;
+		controller.stats.numFTLWrite++;
+		controller.stats.numMemoryRead++;
+		controller.stats.numMemoryWrite++;
 	}
+}
 
-	return SUCCESS;
+void FtlImpl_Page::print_ftl_statistics()
+{
+	manager.print_statistics();
+}
+
+void FtlImpl_Page::snapshot(Snapshot &snapshot)
+{
+	FtlParent::snapshot(snapshot);
+	snapshot.section("page");
+	snapshot.io(gcFrontier);
+	snapshot.io_array(map, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE);
+	snapshot.io_array(reverse_map, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE);
 }
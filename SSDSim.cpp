@@ -38,11 +38,8 @@ void SSD_Write(unsigned long long address, int size, void *buf)
 
 	double time = ((ssd_request_time.tv_sec - ssd_boot_time.tv_sec) * 1000 + (ssd_request_time.tv_usec - ssd_boot_time.tv_usec) / 1000.0) + 0.5;
 
-	for (int i=0;i<size;i += PAGE_SIZE)
-	{
-		double result = ssdImpl->event_arrive(WRITE, address, 1, time, NULL);
-		printf("Write time address %llu (%i): %.20lf at %.3f\n", address, size, result, time);
-	}
+	double result = ssdImpl->event_arrive(WRITE, address, (size + PAGE_SIZE - 1) / PAGE_SIZE, time, NULL);
+	printf("Write time address %llu (%i): %.20lf at %.3f\n", address, size, result, time);
 }
 
 void SSD_Read(unsigned long long address, int size, void *buf)
@@ -51,10 +48,7 @@ void SSD_Read(unsigned long long address, int size, void *buf)
 
 	double time = ((ssd_request_time.tv_sec - ssd_boot_time.tv_sec) * 1000 + (ssd_request_time.tv_usec - ssd_boot_time.tv_usec) / 1000.0) + 0.5;
 
-	for (int i=0;i<size;i += PAGE_SIZE)
-	{
-		double result = ssdImpl->event_arrive(READ, address, 1, time, NULL);
-		printf("Read time %llu (%i): %.20lf at %.3f\n", address, size, result, time);
-	}
+	double result = ssdImpl->event_arrive(READ, address, (size + PAGE_SIZE - 1) / PAGE_SIZE, time, NULL);
+	printf("Read time %llu (%i): %.20lf at %.3f\n", address, size, result, time);
 }
 
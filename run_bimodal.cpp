@@ -22,6 +22,7 @@
 #include <vector>
 #include <algorithm>
 #include <math.h>
+#include <unistd.h>
 #include "ssd.h"
 
 using namespace ssd;
@@ -107,18 +108,35 @@ int main(int argc, char **argv){
 	ssd.reset_statistics();
 
 	// 1. Write random to the size of the device
-	srand(1);
+	// With a snapshot file given, start from the snapshot if it exists and
+	// save one after preconditioning otherwise.
+	const char *snapshot = argc > 1 ? argv[1] : NULL;
 	double afterFormatStartTime = 0;
-	//for (int i=0; i<preIO/3*2;i++)
-	for (int i=0; i<preIO*1.1;i++)
-	//for (int i=0; i<700000;i++)
+	if (snapshot != NULL && access(snapshot, R_OK) == 0)
 	{
-		long int r = random()%preIO;
-		double d = ssd.event_arrive(WRITE, r, 1, afterFormatStartTime);
-		afterFormatStartTime += d;
-
-		if (i % 10000 == 0)
-			printf("Wrote %i %f\n", i,d );
+		afterFormatStartTime = ssd.load_snapshot(snapshot);
+		printf("Loaded preconditioned drive from %s\n", snapshot);
+	}
+	else
+	{
+		// Only the resulting state matters, so skip the timing simulation.
+		ssd.set_functional(true);
+		srand(1);
+		//for (int i=0; i<preIO/3*2;i++)
+		for (int i=0; i<preIO*1.1;i++)
+		//for (int i=0; i<700000;i++)
+		{
+			long int r = random()%preIO;
+			double d = ssd.event_arrive(WRITE, r, 1, afterFormatStartTime);
+			afterFormatStartTime += d;
+
+			if (i % 10000 == 0)
+				printf("Wrote %i %f\n", i,d );
+		}
+		ssd.set_functional(false);
+
+		if (snapshot != NULL)
+			ssd.save_snapshot(snapshot, afterFormatStartTime);
 	}
 
 	start_time = afterFormatStartTime;
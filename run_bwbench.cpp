@@ -0,0 +1,126 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_bwbench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Bandwidth benchmark
+ *
+ * Writes and then reads the first half of the drive sequentially, one request
+ * at a time.  The first table issues single page requests for superpages of
+ * 1, 2, 4, ... physical pages up to the number of dies (VIRTUAL_PAGE_SIZE in
+ * striping mode, see Controller::translate_address), the second requests of
+ * 1, 2, 4, ... up to [max request] pages without striping (see
+ * Controller::event_arrive_pages), the third requests of a page per plane of
+ * every die with multi-plane commands of 1, 2, 4, ... planes up to the
+ * planes of a die (MULTI_PLANE, see Die::multi_plane) and the fourth requests
+ * of [max request] pages without (0) and with (1) cache read and cache
+ * program (PLANE_CACHE_READ and PLANE_CACHE_PROGRAM, see Die::can_cache).
+ * Each run moves the same number of physical pages, so the bandwidth shows
+ * how much a request gains from spreading over the packages, dies and planes
+ * and from pipelining the pages of a plane.  The host writes
+ * reach the dies as BLOCK_ALLOCATION places them.  Bandwidth is in physical
+ * pages per 1000 time units of the delays in ssd.conf, which supplies the
+ * other settings.
+ *
+ * usage: bwbench [max request]
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+/* returns the simulated time to write and to read the pages */
+static void run(ulong pages, uint size, double &write_time, double &read_time)
+{
+	Ssd ssd;
+	ulong requests = pages / VIRTUAL_PAGE_SIZE / size;
+
+	double time = 0.0;
+	for (ulong i = 0; i < requests; i++)
+		time += ssd.event_arrive(WRITE, i * size, size, time);
+	write_time = time;
+
+	for (ulong i = 0; i < requests; i++)
+		time += ssd.event_arrive(READ, i * size, size, time);
+	read_time = time - write_time;
+}
+
+static void print(const char *name, uint value, ulong pages, uint size)
+{
+	double write_time;
+	double read_time;
+	run(pages, size, write_time, read_time);
+	printf("%s %10u %10lu %12.1f %12.1f %12.2f %12.2f\n", name, value, pages / VIRTUAL_PAGE_SIZE / size, write_time, read_time, 1000.0 * pages / write_time, 1000.0 * pages / read_time);
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	uint max_request = 64;
+	if (argc > 1)
+		max_request = atoi(argv[1]);
+
+	uint dies = SSD_SIZE * PACKAGE_SIZE;
+	ulong blocks = SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE;
+	ulong pages = blocks * BLOCK_SIZE / 2;
+
+	if (max_request < 1 || pages / max_request < 1)
+	{
+		fprintf(stderr, "bwbench: need a request of at least one page and at most half the drive\n");
+		return 1;
+	}
+
+	printf("%10s %10s %10s %12s %12s %12s %12s\n", "", "pages", "requests", "write time", "read time", "write bw", "read bw");
+	for (uint size = 1; size <= dies; size *= 2)
+	{
+		Config config;
+		config.PARALLELISM_MODE = 1;
+		config.VIRTUAL_PAGE_SIZE = size;
+		config.NUMBER_OF_ADDRESSABLE_BLOCKS = blocks / size;
+		config.apply();
+		print(" superpage", size, pages, 1);
+	}
+
+	Config config;
+	config.PARALLELISM_MODE = 0;
+	config.VIRTUAL_PAGE_SIZE = 1;
+	config.NUMBER_OF_ADDRESSABLE_BLOCKS = blocks;
+	config.MULTI_PLANE = 1;
+	config.PLANE_CACHE_READ = false;
+	config.PLANE_CACHE_PROGRAM = false;
+	config.apply();
+	for (uint size = 1; size <= max_request; size *= 2)
+		print("   request", size, pages, size);
+
+	for (uint planes = 1; planes <= DIE_SIZE; planes *= 2)
+	{
+		config.MULTI_PLANE = planes;
+		config.apply();
+		print("multiplane", planes, pages, dies * DIE_SIZE);
+	}
+
+	config.MULTI_PLANE = 1;
+	for (uint cache = 0; cache <= 1; cache++)
+	{
+		config.PLANE_CACHE_READ = cache;
+		config.PLANE_CACHE_PROGRAM = cache;
+		config.apply();
+		print("     cache", cache, pages, max_request);
+	}
+	return 0;
+}
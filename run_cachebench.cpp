@@ -0,0 +1,131 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_cachebench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Cached Mapping Table replacement policy benchmark
+ *
+ * Runs the same workload on DFTL once for every CACHE_DFTL_POLICY and prints
+ * the hits, faults and dirty evictions of the CMT.  Every fault reads a
+ * translation page and every dirty eviction writes one, so the policy with
+ * the fewest translation reads and writes per request costs the least flash
+ * traffic.  The drive gets enough blocks per plane for 65536 pages, no page
+ * data and a CMT of a sixteenth of their mappings, so the hot set does not
+ * fit.  The first [range] pages, three quarters of the drive unless given,
+ * are written once in functional mode (see Ssd::set_functional), then
+ * [requests] requests follow: 80% go to a hot fifth of the range, the rest
+ * are sequential scans of 64 pages from random places, half of all requests
+ * are writes.  The other settings come from ssd.conf.
+ *
+ * usage: cachebench [requests] [range]
+ */
+
+#include <algorithm>
+#include "ssd.h"
+
+using namespace ssd;
+
+#define CACHEBENCH_POLICIES 6
+#define CACHEBENCH_SCAN 64
+#define CACHEBENCH_PAGES 65536
+#define CACHEBENCH_CMT_SHARE 16
+
+static const char *policy_names[CACHEBENCH_POLICIES] = {"LRU", "CLOCK", "2Q", "ARC", "S3-FIFO", "TPFTL"};
+
+static Stats run(uint requests, uint range)
+{
+	ulong seed = 42;
+	Ssd ssd;
+	bench_fill(ssd, range);
+	ssd.set_functional(true);
+
+	uint hot = range / 5 > 0 ? range / 5 : 1;
+	uint scan = 0;
+	ulong scan_address = 0;
+	for (uint i = 0; i < requests; i++)
+	{
+		ulong address;
+		if (scan > 0)
+		{
+			address = scan_address++ % range;
+			scan--;
+		}
+		/* a scan starts once in 4 * CACHEBENCH_SCAN requests, so they make
+		 * up a fifth of the requests */
+		else if (next_random(seed) % (4 * CACHEBENCH_SCAN) != 0)
+			address = next_random(seed) % hot;
+		else {
+			scan_address = next_random(seed) % range;
+			scan = CACHEBENCH_SCAN - 1;
+			address = scan_address++;
+		}
+		enum event_type type = next_random(seed) % 2 == 0 ? READ : WRITE;
+		ssd.event_arrive(type, address, 1, 0.0);
+	}
+	return ssd.get_controller().stats;
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	/* BiModal and AMT map whole blocks past the CMT, and neither survives
+	 * random overwrites of a mostly full drive */
+	if (FTL_IMPLEMENTATION != 3)
+	{
+		fprintf(stderr, "cachebench: set FTL_IMPLEMENTATION to DFTL (3) in ssd.conf\n");
+		return 1;
+	}
+
+	/* the CMT size depends on the number of pages, so the geometry goes
+	 * first */
+	uint planes = SSD_SIZE * PACKAGE_SIZE * DIE_SIZE;
+	Config config;
+	config.PLANE_SIZE = (CACHEBENCH_PAGES / BLOCK_SIZE + planes - 1) / planes;
+	config.NUMBER_OF_ADDRESSABLE_BLOCKS = planes * config.PLANE_SIZE / VIRTUAL_PAGE_SIZE;
+	config.PAGE_ENABLE_DATA = false;
+	config.apply();
+	uint pages = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+	config.CACHE_DFTL_LIMIT = std::max(pages / CACHEBENCH_CMT_SHARE / FtlImpl_DftlParent::address_per_page(), 1u);
+	config.apply();
+
+	uint requests = pages;
+	uint range = pages / 4 * 3;
+	if (argc > 1)
+		requests = atoi(argv[1]);
+	if (argc > 2)
+		range = atoi(argv[2]);
+
+	if (range < 1 || range > pages)
+	{
+		fprintf(stderr, "cachebench: range must be between 1 and %u pages\n", pages);
+		return 1;
+	}
+
+	printf("%u pages, CMT of %u mappings\n", pages, CACHE_DFTL_LIMIT * FtlImpl_DftlParent::address_per_page());
+	printf("%8s %10s %10s %10s %8s %10s %12s %12s\n", "policy", "requests", "hits", "faults", "hit %", "dirty ev", "trans rd/io", "trans wr/io");
+	bench_sweep(&Config::CACHE_DFTL_POLICY, CACHEBENCH_POLICIES, [&](uint policy)
+	{
+		Stats stats = run(requests, range);
+		printf("%8s %10u %10li %10li %8.2f %10li %12.4f %12.4f\n", policy_names[policy], requests,
+				stats.numCacheHits, stats.numCacheFaults,
+				100.0 * stats.numCacheHits / (stats.numCacheHits + stats.numCacheFaults),
+				stats.numCacheDirtyEvictions,
+				(double) stats.numCacheFaults / requests, (double) stats.numCacheDirtyEvictions / requests);
+	});
+	return 0;
+}
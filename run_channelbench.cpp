@@ -0,0 +1,189 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_channelbench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Channel schedule table microbenchmark
+ *
+ * Replays the same stream of bus locks against the Channel class and against
+ * the sorted vector schedule table it used before, checks that both produce
+ * the same schedule and prints the lock rate of each.  Locks arrive in bursts
+ * of <depth> so the table grows up to <depth> entries, which is what long
+ * trace replays with busy channels and garbage collection look like.
+ *
+ * usage: channelbench [locks per depth]
+ */
+
+#include <algorithm>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* the schedule table Channel used before the interval index:
+ * erase expired entries, sort by lock time, then scan for the first gap */
+class Legacy_channel
+{
+public:
+	void lock(double start_time, double duration, Event &event)
+	{
+		unlock(start_time);
+
+		double sched_time = BUS_CHANNEL_FREE_FLAG;
+		if(timings.size() == 0)
+			sched_time = start_time;
+		else
+		{
+			std::vector<lock_times>::iterator it = timings.begin();
+			if((*it).lock_time > start_time && (*it).lock_time - start_time >= duration)
+				sched_time = start_time;
+			if(sched_time == BUS_CHANNEL_FREE_FLAG)
+			{
+				for(; it < timings.end(); it++)
+				{
+					if (it + 1 != timings.end())
+					{
+						if((*it).unlock_time >= start_time  && (*(it+1)).lock_time - (*it).unlock_time >= duration)
+						{
+							sched_time = (*it).unlock_time;
+							break;
+						}
+					}
+				}
+			}
+			if(sched_time == BUS_CHANNEL_FREE_FLAG)
+				sched_time = timings.back().unlock_time;
+		}
+
+		lock_times lt;
+		lt.lock_time = sched_time;
+		lt.unlock_time = sched_time + duration;
+		timings.push_back(lt);
+
+		event.incr_bus_wait_time(sched_time - start_time);
+		event.incr_time_taken(sched_time - start_time + duration);
+	}
+private:
+	struct lock_times {
+		double lock_time;
+		double unlock_time;
+	};
+
+	static bool timings_sorter(lock_times const& lhs, lock_times const& rhs)
+	{
+		return lhs.lock_time < rhs.lock_time;
+	}
+
+	void unlock(double start_time)
+	{
+		std::vector<lock_times>::iterator it;
+		for ( it = timings.begin(); it < timings.end();)
+		{
+			if((*it).unlock_time <= start_time)
+				timings.erase(it);
+			else
+				it++;
+		}
+		std::sort(timings.begin(), timings.end(), &timings_sorter);
+	}
+
+	std::vector<lock_times> timings;
+};
+
+struct lock_request {
+	double start_time;
+	double duration;
+};
+
+/* bursts of depth lock requests with increasing start times spread over the
+ * first quarter of the time the burst needs on the bus, so the channel falls
+ * behind and the table fills up like it does under garbage collection copies;
+ * lock durations are the control and control+data bus delays */
+static void generate(std::vector<lock_request> &requests, uint count, uint depth)
+{
+	double ctrl = BUS_CTRL_DELAY;
+	double data = BUS_CTRL_DELAY + BUS_DATA_DELAY;
+	double burst = depth * (ctrl + data) / 2;
+	double clock = 0.0;
+	ulong seed = 42;
+
+	requests.resize(count);
+	for(uint i = 0; i < count; i++)
+	{
+		requests[i].duration = next_random(seed) & 1 ? data : ctrl;
+		requests[i].start_time = clock + (i % depth) * burst / (4 * depth);
+		if((i + 1) % depth == 0)
+			clock += burst;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	uint count = 100000;
+	if(argc > 1)
+		count = atoi(argv[1]);
+
+	uint depths[] = {16, 128, 512, 2048};
+	int failed = 0;
+
+	printf("%8s %10s %14s %14s %8s %s\n", "depth", "locks", "legacy lock/s", "index lock/s", "speedup", "schedules");
+	for(uint d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+	{
+		/* keep the legacy run short at large depths, it is O(n log n) a lock */
+		uint locks = std::min(count, (uint) (50000000 / depths[d]));
+		std::vector<lock_request> requests;
+		generate(requests, locks, depths[d]);
+
+		std::vector<double> legacy_sched(locks);
+		std::vector<double> index_sched(locks);
+
+		Legacy_channel legacy;
+		double t = wall_clock();
+		for(uint i = 0; i < locks; i++)
+		{
+			Event event(READ, 0, 1, requests[i].start_time);
+			legacy.lock(requests[i].start_time, requests[i].duration, event);
+			legacy_sched[i] = event.get_bus_wait_time();
+		}
+		double legacy_time = wall_clock() - t;
+
+		Channel channel;
+		t = wall_clock();
+		for(uint i = 0; i < locks; i++)
+		{
+			Event event(READ, 0, 1, requests[i].start_time);
+			channel.lock(requests[i].start_time, requests[i].duration, event);
+			index_sched[i] = event.get_bus_wait_time();
+		}
+		double index_time = wall_clock() - t;
+
+		uint mismatches = 0;
+		for(uint i = 0; i < locks; i++)
+			if(legacy_sched[i] != index_sched[i])
+				mismatches++;
+		if(mismatches > 0)
+			failed = 1;
+
+		printf("%8u %10u %14.0f %14.0f %7.1fx %s", depths[d], locks, locks / legacy_time, locks / index_time, legacy_time / index_time, mismatches == 0 ? "identical" : "DIFFER");
+		if(mismatches > 0)
+			printf(" (%u mismatches)", mismatches);
+		printf("\n");
+	}
+	return failed;
+}
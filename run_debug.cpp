@@ -62,12 +62,12 @@ void debug(Ssd& ssd) throw (std::invalid_argument)
 			default:
 				throw std::invalid_argument("Invalid I/O type!");
 		}
-		global_buffer = nullptr;
 		ssd.event_arrive(type, vaddr, 1, time(NULL), buffer);
 		if (type == READ)
 		{
-			std::cout << (global_buffer ? *(int*) global_buffer : 0) << '\t';
-			std::cout << global_buffer << std::endl;
+			void *result = ssd.get_result_buffer();
+			std::cout << (result ? *(int*) result : 0) << '\t';
+			std::cout << result << std::endl;
 		}
 	}
 }
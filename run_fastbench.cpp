@@ -0,0 +1,101 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_fastbench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* FAST read benchmark
+ *
+ * Measures the wall-clock read throughput of the FAST FTL for a growing number
+ * of RW log blocks (FAST_LOG_BLOCK_LIMIT).  For each log size the drive gets
+ * enough blocks per plane for the first [range] pages plus the log, the range
+ * is written once and then overwritten at random in functional mode (see
+ * Ssd::set_functional) until the RW log blocks are about full, without
+ * triggering a merge.  [reads] random reads over the range follow in timed
+ * mode.  The other settings come from ssd.conf.
+ *
+ * usage: fastbench [reads] [range]
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+#define FASTBENCH_LOG_SIZES 5
+
+static const uint log_sizes[FASTBENCH_LOG_SIZES] = {16, 64, 256, 1024, 4096};
+
+/* returns the wall-clock time of the reads */
+static double run(uint reads, uint range, double &latency)
+{
+	ulong seed = 42;
+	Ssd ssd;
+
+	ssd.set_functional(true);
+	for (uint i = 0; i < range; i++)
+		ssd.event_arrive(WRITE, i, 1, 0.0);
+
+	/* writes to the first page of a block go to the SW log block instead, so
+	 * the RW log blocks stay just short of full */
+	for (uint i = 0; i < FAST_LOG_BLOCK_LIMIT * (BLOCK_SIZE - 1); i++)
+		ssd.event_arrive(WRITE, next_random(seed) % range, 1, 0.0);
+	ssd.set_functional(false);
+
+	double time = 0.0;
+	double start = wall_clock();
+	for (uint i = 0; i < reads; i++)
+		time += ssd.event_arrive(READ, next_random(seed) % range, 1, time);
+	latency = time / reads;
+	return wall_clock() - start;
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	uint reads = 100000;
+	uint range = 64 * BLOCK_SIZE;
+	if (argc > 1)
+		reads = atoi(argv[1]);
+	if (argc > 2)
+		range = atoi(argv[2]);
+
+	if (reads < 1 || range < BLOCK_SIZE)
+	{
+		fprintf(stderr, "fastbench: need at least one read and a range of at least one block\n");
+		return 1;
+	}
+
+	uint planes = SSD_SIZE * PACKAGE_SIZE * DIE_SIZE;
+	printf("%10s %10s %12s %12s\n", "log blocks", "reads", "reads/s", "latency");
+	for (uint i = 0; i < FASTBENCH_LOG_SIZES; i++)
+	{
+		/* data blocks, the log and as many again for merges and garbage */
+		uint blocks = 2 * ((range + BLOCK_SIZE - 1) / BLOCK_SIZE + log_sizes[i]);
+
+		Config config;
+		config.FTL_IMPLEMENTATION = 2;
+		config.FAST_LOG_BLOCK_LIMIT = log_sizes[i];
+		config.PLANE_SIZE = (blocks + planes - 1) / planes;
+		config.NUMBER_OF_ADDRESSABLE_BLOCKS = planes * config.PLANE_SIZE / VIRTUAL_PAGE_SIZE;
+		config.apply();
+
+		double latency;
+		double seconds = run(reads, range, latency);
+		printf("%10u %10u %12.0f %12.2f\n", log_sizes[i], reads, reads / seconds, latency);
+	}
+	return 0;
+}
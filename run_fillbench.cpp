@@ -0,0 +1,105 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_fillbench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Preconditioning benchmark
+ *
+ * Fills a drive with random writes once in timed mode and once in functional
+ * mode (see Ssd::set_functional), prints the wall-clock time of each and checks
+ * that both leave the FTL with the same counts.  Both drives then switch to
+ * timed mode and serve the same random reads and writes, which must again
+ * give the same counts.  The writes go to the first [range] pages, [range]
+ * must leave the FTL of ssd.conf enough free blocks to collect garbage.
+ *
+ * usage: fillbench [writes] [range]
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+static bool same_counts(const Stats &a, const Stats &b)
+{
+	return a.numFTLRead == b.numFTLRead && a.numFTLWrite == b.numFTLWrite && a.numFTLErase == b.numFTLErase
+		&& a.numGCRead == b.numGCRead && a.numGCWrite == b.numGCWrite && a.numGCErase == b.numGCErase
+		&& a.numWLRead == b.numWLRead && a.numWLWrite == b.numWLWrite && a.numWLErase == b.numWLErase
+		&& a.numLogMergeSwitch == b.numLogMergeSwitch && a.numLogMergePartial == b.numLogMergePartial && a.numLogMergeFull == b.numLogMergeFull
+		&& a.numPageBlockToPageConversion == b.numPageBlockToPageConversion
+		&& a.numCacheHits == b.numCacheHits && a.numCacheFaults == b.numCacheFaults
+		&& a.numCacheEvictions == b.numCacheEvictions && a.numCacheDirtyEvictions == b.numCacheDirtyEvictions;
+}
+
+/* precondition ssd, in functional mode if functional is set, then measure in
+ * timed mode
+ * returns the wall-clock time of the preconditioning */
+static double fill(Ssd &ssd, bool functional, uint writes, uint range, Stats &filled, Stats &measured)
+{
+	ulong seed = 42;
+	double time = 0.0;
+
+	/* BAST picks merge victims with random() */
+	srandom(1);
+	ssd.set_functional(functional);
+	double start = wall_clock();
+	for (uint i = 0; i < writes; i++)
+		time += ssd.event_arrive(WRITE, next_random(seed) % range, 1, time);
+	double wall_time = wall_clock() - start;
+	filled = ssd.get_controller().stats;
+
+	/* carry on in timed mode after the last timed request */
+	ssd.set_functional(false);
+	for (uint i = 0; i < writes / 10; i++)
+	{
+		enum event_type type = next_random(seed) % 2 == 0 ? READ : WRITE;
+		time += ssd.event_arrive(type, next_random(seed) % range, 1, time);
+	}
+	measured = ssd.get_controller().stats;
+	return wall_time;
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	uint pages = SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE;
+	uint writes = 2 * pages;
+	uint range = pages / 4 * 3;
+	if (argc > 1)
+		writes = atoi(argv[1]);
+	if (argc > 2)
+		range = atoi(argv[2]);
+
+	if (range < 1 || range > pages)
+	{
+		fprintf(stderr, "fillbench: range must be between 1 and %u pages\n", pages);
+		return 1;
+	}
+
+	Stats timed_filled, timed_measured, functional_filled, functional_measured;
+	Ssd *timed = new Ssd();
+	double timed_wall = fill(*timed, false, writes, range, timed_filled, timed_measured);
+	delete timed;
+	Ssd *functional = new Ssd();
+	double functional_wall = fill(*functional, true, writes, range, functional_filled, functional_measured);
+	delete functional;
+
+	bool same = same_counts(timed_filled, functional_filled) && same_counts(timed_measured, functional_measured);
+	printf("%6s %10s %10s %10s %12s %8s %s\n", "FTL", "writes", "range", "timed s", "functional s", "speedup", "state");
+	printf("%6d %10u %10u %10.3f %12.3f %7.2fx %s\n", FTL_IMPLEMENTATION, writes, range, timed_wall, functional_wall, timed_wall / functional_wall, same ? "identical" : "DIFFER");
+	return same ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_gcbench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Garbage collection victim policy benchmark
+ *
+ * Runs the same workload on the page FTL or DFTL of ssd.conf once for every
+ * GC_POLICY and prints the write amplification of the garbage collection, the
+ * time it adds to the writes that trigger it and the mean write latency.  The
+ * drive gets enough blocks per plane for 256 blocks, so a collection run of
+ * GC_BLOCKS victims fits in the blocks GC_THRESHOLD leaves free.  The first
+ * [range] pages, three quarters of the addressable pages unless given, are
+ * written once in functional mode (see Ssd::set_functional), then [writes]
+ * timed writes follow, 80% of them to a hot fifth of the range.  The other
+ * settings, GC_THRESHOLD, GC_BLOCKS, GC_CHOICES and GC_WINDOW included, come
+ * from ssd.conf.
+ *
+ * usage: gcbench [writes] [range]
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+#define GCBENCH_POLICIES 5
+#define GCBENCH_BLOCKS 256
+
+static const char *policy_names[GCBENCH_POLICIES] = {"greedy", "cost-benefit", "CAT", "d-choices", "window"};
+
+static Stats run(uint writes, uint range)
+{
+	ulong seed = 42;
+	Ssd ssd;
+	bench_fill(ssd, range);
+
+	uint hot = range / 5 > 0 ? range / 5 : 1;
+	double time = 0.0;
+	for (uint i = 0; i < writes; i++)
+	{
+		ulong address;
+		if (next_random(seed) % 10 < 8)
+			address = next_random(seed) % hot;
+		else
+			address = hot + next_random(seed) % (range - hot);
+		time += ssd.event_arrive(WRITE, address, 1, time);
+	}
+	return ssd.get_controller().stats;
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	/* BiModal hands its block-mapped and partly written blocks to the
+	 * victim policies, whose collections it does not survive */
+	if (FTL_IMPLEMENTATION != 0 && FTL_IMPLEMENTATION != 3)
+	{
+		fprintf(stderr, "gcbench: set FTL_IMPLEMENTATION to the page FTL or DFTL (0 or 3) in ssd.conf\n");
+		return 1;
+	}
+
+	uint planes = SSD_SIZE * PACKAGE_SIZE * DIE_SIZE;
+	Config config;
+	config.PLANE_SIZE = (GCBENCH_BLOCKS + planes - 1) / planes;
+	config.NUMBER_OF_ADDRESSABLE_BLOCKS = planes * config.PLANE_SIZE / VIRTUAL_PAGE_SIZE;
+	config.apply();
+
+	uint pages = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+	uint writes = 4 * pages;
+	uint range = pages / 4 * 3;
+	if (argc > 1)
+		writes = atoi(argv[1]);
+	if (argc > 2)
+		range = atoi(argv[2]);
+
+	if (range < 5 || range > pages)
+	{
+		fprintf(stderr, "gcbench: range must be between 5 and %u pages\n", pages);
+		return 1;
+	}
+
+	printf("%u blocks of %u pages\n", NUMBER_OF_ADDRESSABLE_BLOCKS, BLOCK_SIZE);
+	printf("%12s %10s %8s %10s %10s %12s %12s\n", "policy", "writes", "WAF", "GC runs", "GC erases", "GC lat/wr", "latency");
+	bench_sweep(&Config::GC_POLICY, GCBENCH_POLICIES, [&](uint policy)
+	{
+		Stats stats = run(writes, range);
+		printf("%12s %10u %8.3f %10li %10li %12.2f %12.2f\n", policy_names[policy], writes,
+				stats.write_amplification(), stats.numGCRuns, stats.numGCErase,
+				stats.sumGCLatency / writes, stats.average_latency());
+	});
+	return 0;
+}
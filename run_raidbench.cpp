@@ -0,0 +1,88 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_raidbench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* RAID front end benchmark
+ *
+ * Replays the same striped random write and read workload on a RaidSsd with
+ * its members run one after the other and with one worker thread per member,
+ * checks that both simulate the same times and prints the wall-clock time of
+ * each.  Uses ssd.conf with PARALLELISM_MODE set to 1 (striping) and an FTL
+ * with room for [requests] / 2 pages.
+ *
+ * usage: raidbench [requests] [members]
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+/* sequential writes followed by random reads of the written pages, which
+ * keeps garbage collection out of the measurement
+ * returns the sum of the times taken, the wall-clock time in wall_time */
+static double replay(bool parallel, uint requests, double &wall_time)
+{
+	RaidSsd *raid = new RaidSsd(SSD_SIZE, parallel);
+	uint writes = requests / 2;
+	ulong seed = 42;
+	double total = 0.0;
+
+	double start = wall_clock();
+	for (uint i = 0; i < writes; i++)
+		total += raid -> event_arrive(WRITE, i, 1, i * 0.001);
+	for (uint i = writes; i < requests; i++)
+		total += raid -> event_arrive(READ, next_random(seed) % writes, 1, i * 0.001);
+	wall_time = wall_clock() - start;
+
+	delete raid;
+	return total;
+}
+
+int main(int argc, char **argv)
+{
+	load_config();
+
+	uint requests = 100000;
+	if (argc > 1)
+		requests = atoi(argv[1]);
+
+	/* the member count is a configuration variable */
+	if (argc > 2)
+	{
+		Config config;
+		config.RAID_NUMBER_OF_PHYSICAL_SSDS = atoi(argv[2]);
+		config.apply();
+	}
+
+	if (requests < 2)
+		requests = 2;
+
+	if (PARALLELISM_MODE != 1)
+	{
+		fprintf(stderr, "raidbench: set PARALLELISM_MODE 1 (striping) in ssd.conf\n");
+		return 1;
+	}
+
+	double serial_wall, parallel_wall;
+	double serial_total = replay(false, requests, serial_wall);
+	double parallel_total = replay(true, requests, parallel_wall);
+
+	printf("%8s %10s %12s %12s %8s %s\n", "members", "requests", "serial s", "parallel s", "speedup", "times");
+	printf("%8u %10u %12.3f %12.3f %7.2fx %s\n", RAID_NUMBER_OF_PHYSICAL_SSDS, requests, serial_wall, parallel_wall, serial_wall / parallel_wall, serial_total == parallel_total ? "identical" : "DIFFER");
+	return serial_total == parallel_total ? 0 : 1;
+}
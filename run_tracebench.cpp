@@ -0,0 +1,116 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_tracebench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Trace parsing microbenchmark
+ *
+ * Converts a text trace to the binary format, then reads both the way the
+ * replay drivers do: the text trace with fgets and sscanf into an 80 byte line
+ * like ufliptrace did, the binary trace through a Trace_reader mapping.  Each
+ * path runs [rounds] times; the records of both must be the same.  Only the
+ * decoding is timed, the Ssd is not involved.
+ *
+ * usage: tracebench <text trace> [binary trace] [rounds]
+ */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* sum of the fields a driver uses, so neither loop can be optimized away */
+static double checksum(const Trace_record &record)
+{
+	return record.address + record.size + record.type + record.arrive_time;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s <text trace> [binary trace] [rounds]\n", argv[0]);
+		return -1;
+	}
+	std::string binary = argc > 2 ? argv[2] : std::string(argv[1]) + ".bin";
+	uint rounds = argc > 3 ? atoi(argv[3]) : 20;
+
+	ulong num_records = Trace_reader::convert(argv[1], binary.c_str());
+
+	/* fgets and sscanf as in ufliptrace */
+	std::vector<Trace_record> text_records;
+	double text_sum = 0.0;
+	double t = wall_clock();
+	for (uint r = 0; r < rounds; r++)
+	{
+		FILE *trace = fopen(argv[1], "r");
+		if (trace == NULL)
+		{
+			printf("File was moved or access was denied.\n");
+			return -1;
+		}
+		char line[80];
+		Trace_record record;
+		long vaddr;
+		memset(&record, 0, sizeof(Trace_record));
+		while (fgets(line, 80, trace) != NULL)
+		{
+			sscanf(line, "%c; %c; %li; %u; %i; %lf", &record.pattern, &record.type, &vaddr, &record.query_time, &record.size, &record.arrive_time);
+			record.address = vaddr;
+			text_sum += checksum(record);
+			if (r == 0)
+				text_records.push_back(record);
+		}
+		fclose(trace);
+	}
+	double text_time = wall_clock() - t;
+
+	/* records in place from the mapping */
+	double binary_sum = 0.0;
+	uint mismatches = 0;
+	t = wall_clock();
+	for (uint r = 0; r < rounds; r++)
+	{
+		Trace_reader trace(binary.c_str());
+		for (const Trace_record *record = trace.begin(); record != trace.end(); record++)
+			binary_sum += checksum(*record);
+	}
+	double binary_time = wall_clock() - t;
+
+	Trace_reader trace(binary.c_str());
+	if (text_records.size() != (ulong) (trace.end() - trace.begin()))
+		mismatches = text_records.size() + 1;
+	else
+		for (ulong i = 0; i < text_records.size(); i++)
+			if (memcmp(&text_records[i], trace.begin() + i, sizeof(Trace_record)) != 0)
+				mismatches++;
+	if (text_sum != binary_sum)
+		mismatches++;
+
+	FILE *in = fopen(argv[1], "r");
+	fseek(in, 0, SEEK_END);
+	long text_size = ftell(in);
+	fclose(in);
+	long binary_size = sizeof(Trace_header) + num_records * sizeof(Trace_record);
+
+	printf("%8s %10s %12s %14s %8s %s\n", "format", "bytes", "records", "records/s", "speedup", "records");
+	printf("%8s %10ld %12lu %14.0f %8s\n", "text", text_size, num_records, num_records * rounds / text_time, "");
+	printf("%8s %10ld %12lu %14.0f %7.1fx %s\n", "binary", binary_size, num_records, num_records * rounds / binary_time, text_time / binary_time, mismatches == 0 ? "identical" : "DIFFER");
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_traceconv.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Trace converter
+ *
+ * Writes the binary form of "%c; %c; %li; %u; %i; %lf" text traces.  Given two
+ * directories it converts every regular file of the first into a file of the
+ * same name in the second, so the output directory can be replayed by
+ * ufliptrace in place of the text one.
+ *
+ * usage: traceconv <text trace> <binary trace>
+ *        traceconv <text trace directory>/ <binary trace directory>/
+ */
+
+#include <dirent.h>
+#include <string>
+#include "ssd.h"
+
+using namespace ssd;
+
+int main(int argc, char **argv)
+{
+	if (argc != 3)
+	{
+		printf("usage: %s <text trace> <binary trace>\n", argv[0]);
+		printf("       %s <text trace directory> <binary trace directory>\n", argv[0]);
+		return -1;
+	}
+
+	DIR *working_directory = opendir(argv[1]);
+	if (working_directory == NULL)
+	{
+		ulong records = Trace_reader::convert(argv[1], argv[2]);
+		printf("%s: %lu records\n", argv[2], records);
+		return 0;
+	}
+
+	struct dirent *dirp;
+	while ((dirp = readdir(working_directory)) != NULL)
+	{
+		if (dirp->d_type != DT_REG)
+			continue;
+		std::string in = std::string(argv[1]) + "/" + dirp->d_name;
+		std::string out = std::string(argv[2]) + "/" + dirp->d_name;
+		ulong records = Trace_reader::convert(in.c_str(), out.c_str());
+		printf("%s: %lu records\n", out.c_str(), records);
+	}
+	closedir(working_directory);
+	return 0;
+}
@@ -23,21 +23,35 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <thread>
+#include <unistd.h>
 #include "ssd.h"
 
 using namespace ssd;
 
+/* a request whose pages are consecutive on the device goes to the drive as a
+ * single request of size pages, which the drive serves concurrently; pages a
+ * pattern strides over or that wrap around the end of the device are issued
+ * one after the other */
+static double issue(Ssd &ssd, enum event_type type, long vaddr, int size, int multiplier, int addressDivisor, int deviceSize, double start_time)
+{
+	long first = (vaddr / addressDivisor) % deviceSize;
+	if (multiplier == addressDivisor && first + size <= deviceSize)
+		return ssd.event_arrive(type, first, size, start_time);
+
+	double time_taken = 0;
+	for (int i=0;i<size;i++)
+		time_taken += ssd.event_arrive(type, ((vaddr+(i*multiplier))/addressDivisor)%deviceSize, 1, start_time+time_taken);
+	return time_taken;
+}
+
 int main(int argc, char **argv){
 
 	long vaddr;
-	ssd::uint queryTime;
-	char ioPatternType; // (S)equential or (R)andom
 	char ioType; // (R)ead or (W)rite
-	double arrive_time;
+	double arrive_time = 0;
 	int ioSize;
 
-	char line[80];
-
 	double afterFormatStartTime = 0;
 
 	load_config();
@@ -88,6 +102,12 @@ int main(int argc, char **argv){
 		exit(-1);
 	}
 
+	/* decode the trace in its own thread when there is a core to run it on,
+	 * the optional second argument (0 or 1) overrides */
+	bool pipelined = std::thread::hardware_concurrency() > 1;
+	if (argc > 2)
+		pipelined = atoi(argv[2]) != 0;
+
 	std::vector<std::string> files;
 	struct dirent *dirp;
 	while ((dirp = readdir(working_directory)) != NULL)
@@ -102,18 +122,30 @@ int main(int argc, char **argv){
 	double timeMultiplier = 10000;
 
 
+	/* the optional third argument names a snapshot of the drive after the
+	 * pre write pass: loaded in place of the pass if it exists, saved after
+	 * the pass otherwise */
+	const char *snapshot = argc > 3 ? argv[3] : NULL;
+	bool preconditioned = false;
+	if (snapshot != NULL && access(snapshot, R_OK) == 0)
+	{
+		start_time = ssd.load_snapshot(snapshot);
+		arrive_time = 0;
+		preconditioned = true;
+		printf("Loaded pre written drive from %s\n", snapshot);
+	}
+
 	long writeEvent = 0;
 	long readEvent = 0;
-	for (unsigned int i=0; i<files.size();i++)
+	double replay_start = wall_clock();
+	for (unsigned int i=0; !preconditioned && i<files.size();i++)
 	{
 		char *filename = NULL;
 		asprintf(&filename, "%s%s", argv[1], files[i].c_str());
 
-		FILE *trace = NULL;
-		if((trace = fopen(filename, "r")) == NULL){
-			printf("File was moved or access was denied.\n");
-			exit(-1);
-		}
+		/* text or binary (see traceconv) trace */
+		Trace_pipeline trace(filename, pipelined);
+		Trace_record record;
 
 		printf("-__- %s -__-\n", files[i].c_str());
 
@@ -136,8 +168,11 @@ int main(int argc, char **argv){
 		}
 
 		/* first go through and write to all read addresses to prepare the SSD */
-		while(fgets(line, 80, trace) != NULL){
-			sscanf(line, "%c; %c; %li; %u; %i; %lf", &ioPatternType, &ioType, &vaddr, &queryTime, &ioSize, &arrive_time);
+		while(trace.next(record)){
+			ioType = record.type;
+			vaddr = record.address;
+			ioSize = record.size;
+			arrive_time = record.arrive_time;
 
 			//printf("%li %c %c %li %u %lf %lf %li\n", ++cnt, ioPatternType, ioType, vaddr, queryTime, arrive_time, start_time+arrive_time);
 
@@ -145,34 +180,27 @@ int main(int argc, char **argv){
 
 			if (ioType == 'R')
 			{
-				for (int i=0;i<ioSize;i++)
-				{
-					local_loop_time += ssd.event_arrive(READ, ((vaddr+(i*(int)multiplier))/addressDivisor)%deviceSize, 1, ((start_time+arrive_time)*timeMultiplier)+local_loop_time);
-					readEvent++;
-				}
-
-
+				local_loop_time = issue(ssd, READ, vaddr, ioSize, (int)multiplier, addressDivisor, deviceSize, (start_time+arrive_time)*timeMultiplier);
+				readEvent += ioSize;
 			}
 			else if(ioType == 'W')
 			{
-				for (int i=0;i<ioSize;i++)
-				{
-					local_loop_time += ssd.event_arrive(WRITE, ((vaddr+(i*(int)multiplier))/addressDivisor)%deviceSize, 1, ((start_time+arrive_time)*timeMultiplier)+local_loop_time);
-					writeEvent++;
-				}
-
-
+				local_loop_time = issue(ssd, WRITE, vaddr, ioSize, (int)multiplier, addressDivisor, deviceSize, (start_time+arrive_time)*timeMultiplier);
+				writeEvent += ioSize;
 			}
 
 			arrive_time += local_loop_time;
 		}
-
-		fclose(trace);
 	}
 
+	if (snapshot != NULL && !preconditioned)
+		ssd.save_snapshot(snapshot, start_time + arrive_time);
+
 	printf("Pre write done------------------------------\n");
 	ssd.print_ftl_statistics();
 	printf("Num read %li write %li\n", readEvent, writeEvent);
+	double replay_time = wall_clock() - replay_start;
+	printf("Replayed %li events in %f s (%.0f events/sec)\n", readEvent + writeEvent, replay_time, (readEvent + writeEvent) / replay_time);
 	getchar();
 
 
@@ -192,16 +220,16 @@ int main(int argc, char **argv){
 	unsigned long num_reads = 0;
 	unsigned long num_writes = 0;
 
+	unsigned long total_events = 0;
+	replay_start = wall_clock();
 	for (unsigned int i=0; i<files.size();i++)
 	{
 		char *filename = NULL;
 		asprintf(&filename, "%s%s", argv[1], files[i].c_str());
 
-		FILE *trace = NULL;
-		if((trace = fopen(filename, "r")) == NULL){
-			printf("File was moved or access was denied.\n");
-			exit(-1);
-		}
+		/* text or binary (see traceconv) trace */
+		Trace_pipeline trace(filename, pipelined);
+		Trace_record record;
 
 		fprintf(logFile, "%s;", files[i].c_str());
 
@@ -234,8 +262,11 @@ int main(int argc, char **argv){
 		}
 
 		/* first go through and write to all read addresses to prepare the SSD */
-		while(fgets(line, 80, trace) != NULL){
-			sscanf(line, "%c; %c; %li; %u; %i; %lf", &ioPatternType, &ioType, &vaddr, &queryTime, &ioSize, &arrive_time);
+		while(trace.next(record)){
+			ioType = record.type;
+			vaddr = record.address;
+			ioSize = record.size;
+			arrive_time = record.arrive_time;
 
 			//printf("%li %c %c %li %u %lf %lf %li\n", ++cnt, ioPatternType, ioType, vaddr, queryTime, arrive_time, start_time+arrive_time);
 
@@ -243,40 +274,35 @@ int main(int argc, char **argv){
 
 			if (ioType == 'R')
 			{
-				for (int i=0;i<ioSize;i++)
-				{
-					local_loop_time += ssd.event_arrive(READ, ((vaddr+(i*(int)multiplier))/addressDivisor)%deviceSize, 1, ((start_time+arrive_time)*timeMultiplier)+local_loop_time);
-					num_reads++;
-				}
-
+				local_loop_time = issue(ssd, READ, vaddr, ioSize, (int)multiplier, addressDivisor, deviceSize, (start_time+arrive_time)*timeMultiplier);
+				num_reads += ioSize;
 				read_time += local_loop_time;
 			}
 			else if(ioType == 'W')
 			{
-				for (int i=0;i<ioSize;i++)
-				{
-					local_loop_time += ssd.event_arrive(WRITE, ((vaddr+(i*(int)multiplier))/addressDivisor)%deviceSize, 1, ((start_time+arrive_time)*timeMultiplier)+local_loop_time);
-
-					num_writes++;
-				}
+				local_loop_time = issue(ssd, WRITE, vaddr, ioSize, (int)multiplier, addressDivisor, deviceSize, (start_time+arrive_time)*timeMultiplier);
+				num_writes += ioSize;
 				write_time += local_loop_time;
-
 			}
 
 			arrive_time += local_loop_time;
 		}
 
+		total_events += num_reads + num_writes;
+
 		// Write all statistics
 		fprintf(logFile, "%lu;%f;%lu;%f;%lu;%f;", num_reads, read_time, num_writes, write_time, num_reads+num_writes, read_time+write_time);
 		ssd.write_statistics(logFile);
 
-		fclose(trace);
 
 
 	}
 
 	fclose(logFile);
 
+	replay_time = wall_clock() - replay_start;
+	printf("Replayed %lu events in %f s (%.0f events/sec)\n", total_events, replay_time, total_events / replay_time);
+
 	closedir(working_directory);
 
 	printf("Finished.\n");
@@ -29,13 +29,16 @@
 #include <stdio.h>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <map>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/global_fun.hpp>
-#include <boost/multi_index/random_access_index.hpp>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
  
 #ifndef _SSD_H
 #define _SSD_H
@@ -57,15 +60,24 @@ typedef unsigned long ulong;
 
 /* Simulator configuration from ssd_config.cpp */
 
-/* Configuration file parsing for extern config variables defined below */
+/* Configuration file parsing for extern config variables defined below
+ * The configuration variables are per thread, load_config only sets them for
+ * the calling thread.  ssd_config.cpp defines and sets them, to everyone else
+ * they are constants. */
 void load_entry(char *name, double value, uint line_number);
-void load_config(void);
+void load_config(const char *config_name = "ssd.conf");
 void print_config(FILE *stream);
 
+#ifdef SSD_CONFIG_DEFINITIONS
+#define CONFIG_CONST
+#else
+#define CONFIG_CONST const
+#endif
+
 /* Ram class:
  * 	delay to read from and write to the RAM for 1 page of data */
-extern const double RAM_READ_DELAY;
-extern const double RAM_WRITE_DELAY;
+extern thread_local CONFIG_CONST double RAM_READ_DELAY;
+extern thread_local CONFIG_CONST double RAM_WRITE_DELAY;
 
 /* Bus class:
  * 	delay to communicate over bus
@@ -73,97 +85,198 @@ extern const double RAM_WRITE_DELAY;
  * 	flag value to detect free table entry (keep this negative)
  * 	number of time entries bus has to keep track of future schedule usage
  * 	number of simultaneous communication channels - defined by SSD_SIZE */
-extern const double BUS_CTRL_DELAY;
-extern const double BUS_DATA_DELAY;
-extern const uint BUS_MAX_CONNECT;
-extern const double BUS_CHANNEL_FREE_FLAG;
-extern const uint BUS_TABLE_SIZE;
+extern thread_local CONFIG_CONST double BUS_CTRL_DELAY;
+extern thread_local CONFIG_CONST double BUS_DATA_DELAY;
+extern thread_local CONFIG_CONST uint BUS_MAX_CONNECT;
+extern thread_local CONFIG_CONST double BUS_CHANNEL_FREE_FLAG;
+extern thread_local CONFIG_CONST uint BUS_TABLE_SIZE;
 /* extern const uint BUS_CHANNELS = 4; same as # of Packages, defined by SSD_SIZE */
 
 /* Ssd class:
  * 	number of Packages per Ssd (size) */
-extern const uint SSD_SIZE;
+extern thread_local CONFIG_CONST uint SSD_SIZE;
 
 /* Package class:
  * 	number of Dies per Package (size) */
-extern const uint PACKAGE_SIZE;
+extern thread_local CONFIG_CONST uint PACKAGE_SIZE;
 
 /* Die class:
- * 	number of Planes per Die (size) */
-extern const uint DIE_SIZE;
+ * 	number of Planes per Die (size)
+ * 	most Planes a multi-plane command spans, 1 for none */
+extern thread_local CONFIG_CONST uint DIE_SIZE;
+extern thread_local CONFIG_CONST uint MULTI_PLANE;
 
 /* Plane class:
  * 	number of Blocks per Plane (size)
  * 	delay for reading from plane register
  * 	delay for writing to plane register
  * 	delay for merging is based on read, write, reg_read, reg_write 
- * 		and does not need to be explicitly defined */
-extern const uint PLANE_SIZE;
-extern const double PLANE_REG_READ_DELAY;
-extern const double PLANE_REG_WRITE_DELAY;
+ * 		and does not need to be explicitly defined
+ * 	cache read and cache program modes, which pipeline the bus transfers
+ * 		with the array operations through the plane registers */
+extern thread_local CONFIG_CONST uint PLANE_SIZE;
+extern thread_local CONFIG_CONST double PLANE_REG_READ_DELAY;
+extern thread_local CONFIG_CONST double PLANE_REG_WRITE_DELAY;
+extern thread_local CONFIG_CONST bool PLANE_CACHE_READ;
+extern thread_local CONFIG_CONST bool PLANE_CACHE_PROGRAM;
 
 /* Block class:
  * 	number of Pages per Block (size)
  * 	number of erases in lifetime of block
  * 	delay for erasing block */
-extern const uint BLOCK_SIZE;
-extern const uint BLOCK_ERASES;
-extern const double BLOCK_ERASE_DELAY;
+extern thread_local CONFIG_CONST uint BLOCK_SIZE;
+extern thread_local CONFIG_CONST uint BLOCK_ERASES;
+extern thread_local CONFIG_CONST double BLOCK_ERASE_DELAY;
 
 /* Page class:
  * 	delay for Page reads
  * 	delay for Page writes */
-extern const double PAGE_READ_DELAY;
-extern const double PAGE_WRITE_DELAY;
-extern const uint PAGE_SIZE;
-extern const bool PAGE_ENABLE_DATA;
+extern thread_local CONFIG_CONST double PAGE_READ_DELAY;
+extern thread_local CONFIG_CONST double PAGE_WRITE_DELAY;
+extern thread_local CONFIG_CONST uint PAGE_SIZE;
+extern thread_local CONFIG_CONST bool PAGE_ENABLE_DATA;
 
 /*
  * Mapping directory
  */
-extern const uint MAP_DIRECTORY_SIZE;
+extern thread_local CONFIG_CONST uint MAP_DIRECTORY_SIZE;
 
 /*
  * FTL Implementation
  */
-extern const uint FTL_IMPLEMENTATION;
+extern thread_local CONFIG_CONST uint FTL_IMPLEMENTATION;
 
 /*
  * LOG page limit for BAST.
  */
-extern const uint BAST_LOG_BLOCK_LIMIT;
+extern thread_local CONFIG_CONST uint BAST_LOG_BLOCK_LIMIT;
+
+/*
+ * Victim choice of BAST among its log blocks: 0 = random, 1 = FIFO, 2 = LRU.
+ */
+extern thread_local CONFIG_CONST uint BAST_LOG_VICTIM;
 
 /*
  * LOG page limit for FAST.
  */
-extern const uint FAST_LOG_BLOCK_LIMIT;
+extern thread_local CONFIG_CONST uint FAST_LOG_BLOCK_LIMIT;
 
 /*
  * Number of blocks allowed to be in DFTL Cached Mapping Table.
  */
-extern const uint CACHE_DFTL_LIMIT;
+extern thread_local CONFIG_CONST uint CACHE_DFTL_LIMIT;
+
+/*
+ * Replacement policy of the DFTL Cached Mapping Table.
+ */
+extern thread_local CONFIG_CONST uint CACHE_DFTL_POLICY;
+
+/*
+ * Mappings the DFTL family prefetches into its Cached Mapping Table on a
+ * sequential read miss.
+ */
+extern thread_local CONFIG_CONST uint CACHE_DFTL_PREFETCH;
+
+/*
+ * Garbage collection of the block manager: victim policy (0 = greedy,
+ * 1 = cost-benefit, 2 = CAT, 3 = d-choices, 4 = windowed greedy), fraction
+ * of blocks in use that starts it, blocks collected each time, blocks sampled
+ * by d-choices and blocks in the window of windowed greedy.
+ */
+extern thread_local CONFIG_CONST uint GC_POLICY;
+extern thread_local CONFIG_CONST double GC_THRESHOLD;
+extern thread_local CONFIG_CONST uint GC_BLOCKS;
+extern thread_local CONFIG_CONST uint GC_CHOICES;
+extern thread_local CONFIG_CONST uint GC_WINDOW;
+
+/*
+ * Free block and host write point allocation of the block manager: 0 = linear,
+ * 1 = round-robin over the dies, 2 = least busy die
+ */
+extern thread_local CONFIG_CONST uint BLOCK_ALLOCATION;
 
 /*
  * Parallelism mode
  */
-extern const uint PARALLELISM_MODE;
+extern thread_local CONFIG_CONST uint PARALLELISM_MODE;
 
 /* Virtual block size (as a multiple of the physical block size) */
-extern const uint VIRTUAL_BLOCK_SIZE;
+extern thread_local CONFIG_CONST uint VIRTUAL_BLOCK_SIZE;
 
 /* Virtual page size (as a multiple of the physical page size) */
-extern const uint VIRTUAL_PAGE_SIZE;
+extern thread_local CONFIG_CONST uint VIRTUAL_PAGE_SIZE;
 
-extern const uint NUMBER_OF_ADDRESSABLE_BLOCKS;
+extern thread_local CONFIG_CONST uint NUMBER_OF_ADDRESSABLE_BLOCKS;
 
 /* RAISSDs: Number of physical SSDs */
-extern const uint RAID_NUMBER_OF_PHYSICAL_SSDS;
+extern thread_local CONFIG_CONST uint RAID_NUMBER_OF_PHYSICAL_SSDS;
+
+/* Copy of the configuration variables above.  The default constructor copies
+ * the configuration of the calling thread and apply makes the copy the
+ * configuration of the calling thread.  Each Ssd keeps the configuration it
+ * was created with, so Ssds with different configurations can be simulated in
+ * one process and from several threads at once. */
+class Config
+{
+public:
+	Config(void);
+	void apply(void) const;
+
+	double RAM_READ_DELAY;
+	double RAM_WRITE_DELAY;
+	double BUS_CTRL_DELAY;
+	double BUS_DATA_DELAY;
+	uint BUS_MAX_CONNECT;
+	double BUS_CHANNEL_FREE_FLAG;
+	uint BUS_TABLE_SIZE;
+	uint SSD_SIZE;
+	uint PACKAGE_SIZE;
+	uint DIE_SIZE;
+	uint MULTI_PLANE;
+	uint PLANE_SIZE;
+	double PLANE_REG_READ_DELAY;
+	double PLANE_REG_WRITE_DELAY;
+	bool PLANE_CACHE_READ;
+	bool PLANE_CACHE_PROGRAM;
+	uint BLOCK_SIZE;
+	uint BLOCK_ERASES;
+	double BLOCK_ERASE_DELAY;
+	double PAGE_READ_DELAY;
+	double PAGE_WRITE_DELAY;
+	uint PAGE_SIZE;
+	bool PAGE_ENABLE_DATA;
+	uint MAP_DIRECTORY_SIZE;
+	uint FTL_IMPLEMENTATION;
+	uint BAST_LOG_BLOCK_LIMIT;
+	uint BAST_LOG_VICTIM;
+	uint FAST_LOG_BLOCK_LIMIT;
+	uint CACHE_DFTL_LIMIT;
+	uint CACHE_DFTL_POLICY;
+	uint CACHE_DFTL_PREFETCH;
+	uint GC_POLICY;
+	double GC_THRESHOLD;
+	uint GC_BLOCKS;
+	uint GC_CHOICES;
+	uint GC_WINDOW;
+	uint BLOCK_ALLOCATION;
+	uint PARALLELISM_MODE;
+	uint VIRTUAL_BLOCK_SIZE;
+	uint VIRTUAL_PAGE_SIZE;
+	uint NUMBER_OF_ADDRESSABLE_BLOCKS;
+	uint RAID_NUMBER_OF_PHYSICAL_SSDS;
+};
 
-/*
- * Memory area to support pages with data.
- */
-extern void *page_data;
-extern void *global_buffer;
+/* Makes a configuration the configuration of the calling thread for the
+ * lifetime of the scope and restores the previous one afterwards.  Every
+ * public Ssd method opens one for the configuration of the Ssd. */
+class Config_scope
+{
+public:
+	Config_scope(const Config &config);
+	~Config_scope(void);
+private:
+	Config saved;
+};
 
 /* Enumerations to clarify status integers in simulation
  * Do not use typedefs on enums for reader clarity */
@@ -225,12 +338,14 @@ enum ftl_implementation {IMPL_PAGE, IMPL_BAST, IMPL_FAST, IMPL_DFTL, IMPL_BIMODA
  * Defining the agregate class first enables use of its non-default
  * constructors that accept args
  * (e.g. a Ssd contains a Controller, Ram, Bus, and Packages). */
+class Snapshot;
 class Address;
 class Stats;
 class Event;
+class Event_pool;
 class Channel;
 class Bus;
-class Page;
+class Flash_state;
 class Block;
 class Plane;
 class Die;
@@ -250,9 +365,64 @@ class FTLImpl_AMT;
 class Ram;
 class Controller;
 class Ssd;
+class RaidSsd;
+class Trace_reader;
+class Trace_pipeline;
 
 
 
+/* Binary image of the state of an Ssd (see Ssd::save_snapshot).  Saving
+ * writes the state of each component in turn and loading maps the image into
+ * memory and reads it back in the same order, so each component has a single
+ * snapshot method that serves both directions.  The image starts with a
+ * header holding the configuration that shapes the state (geometry, FTL and
+ * table sizes) and only loads into an Ssd with the same configuration; delays
+ * may differ. */
+class Snapshot
+{
+public:
+	Snapshot(const char *filename, bool saving);
+	~Snapshot(void);
+	bool is_saving(void) const;
+	void io(void *data, ulong size);
+	void section(const char *name);
+	void io_block(Block *&block, FtlParent &ftl);
+	void io_blocks(std::vector<Block *> &blocks, FtlParent &ftl);
+	void io_address(Address &address);
+	void finish(void);
+
+	template <class T>
+	void io(T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only plain data is copied into a snapshot");
+		io(&value, sizeof(T));
+	}
+
+	template <class T>
+	void io_array(T *values, ulong count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only plain data is copied into a snapshot");
+		io((void *) values, count * sizeof(T));
+	}
+
+	template <class T>
+	void io_vector(std::vector<T> &values)
+	{
+		ulong count = values.size();
+		io(count);
+		if(!saving)
+			values.resize(count);
+		io_array(values.data(), count);
+	}
+private:
+	char *filename;
+	bool saving;
+	FILE *file;
+	char *map;
+	ulong map_size;
+	ulong offset;
+};
+
 /* Class to manage physical addresses for the SSD.  It was designed to have
  * public members like a struct for quick access but also have checking,
  * printing, and assignment functionality.  An instance is created for each
@@ -260,12 +430,12 @@ class Ssd;
 class Address
 {
 public:
+	ulong real_address;
 	uint package;
 	uint die;
 	uint plane;
 	uint block;
 	uint page;
-	ulong real_address;
 	enum address_valid valid;
 	Address(void);
 	Address(const Address &address);
@@ -285,6 +455,10 @@ public:
 	void set_linear_address(ulong address, enum address_valid valid);
 	void set_linear_address(ulong address);
 	ulong get_linear_address() const;
+
+	ulong get_packed(void) const;
+	void set_packed(ulong packed);
+	static bool packable(uint ssd_size = SSD_SIZE, uint package_size = PACKAGE_SIZE, uint die_size = DIE_SIZE, uint plane_size = PLANE_SIZE, uint block_size = BLOCK_SIZE);
 };
 
 class Stats
@@ -296,10 +470,12 @@ public:
 	long numFTLErase;
 	long numFTLTrim;
 
-	// Garbage Collection
+	// Garbage Collection, pages moved and blocks erased by the Block_manager
 	long numGCRead;
 	long numGCWrite;
 	long numGCErase;
+	long numGCRuns;
+	double sumGCLatency;
 
 	// Wear-leveling
 	long numWLRead;
@@ -317,6 +493,10 @@ public:
 	// Cache based FTL's
 	long numCacheHits;
 	long numCacheFaults;
+	long numCacheEvictions;
+	long numCacheDirtyEvictions;
+	long numCachePrefetches;
+	long numCachePrefetchHits;
 
 	// Memory consumptions (Bytes)
 	long numMemoryTranslation;
@@ -325,10 +505,21 @@ public:
 	long numMemoryRead;
 	long numMemoryWrite;
 
+	// Request timing (host requests seen by Ssd::event_arrive)
+	long numHostWrite;
+	long numRequests;
+	long numOutstandingMax;
+	double sumLatency;
+	double firstArrival;
+	double lastCompletion;
+
 	// Advance statictics
 	double translation_overhead() const;
 	double variance_of_io() const;
 	double cache_hit_ratio() const;
+	double average_latency() const;
+	double throughput() const;
+	double write_amplification() const;
 
 	// Constructors, maintainance, output, etc.
 	Stats(void);
@@ -337,6 +528,7 @@ public:
 	void reset_statistics();
 	void write_statistics(FILE *stream);
 	void write_header(FILE *stream);
+	void snapshot(Snapshot &snapshot);
 private:
 	void reset();
 };
@@ -355,6 +547,7 @@ public:
 
 	LogPageBlock *next;
 
+	void snapshot(Snapshot &snapshot);
 	bool operator() (const ssd::LogPageBlock& lhs, const ssd::LogPageBlock& rhs) const;
 	bool operator() (const ssd::LogPageBlock*& lhs, const ssd::LogPageBlock*& rhs) const;
 };
@@ -369,11 +562,13 @@ public:
 	Event(enum event_type type, ulong logical_address, uint size, double start_time);
 	~Event(void);
 	void consolidate_metaevent(Event &list);
+	double join(const Event &event);
 	ulong get_logical_address(void) const;
 	const Address &get_address(void) const;
-	const Address &get_merge_address(void) const;
-	const Address &get_log_address(void) const;
-	const Address &get_replace_address(void) const;
+	Address get_merge_address(void) const;
+	Address get_log_address(void) const;
+	Address get_replace_address(void) const;
+	bool has_replace_address(void) const;
 	uint get_size(void) const;
 	enum event_type get_event_type(void) const;
 	double get_start_time(void) const;
@@ -397,19 +592,52 @@ private:
 	double start_time;
 	double time_taken;
 	double bus_wait_time;
-	enum event_type type;
-
 	ulong logical_address;
+
+	/* the address the event is issued to is kept unpacked because every
+	 * level of the hardware indexes on it
+	 * the secondary addresses are only looked at once or twice, so they are
+	 * stored in the 64-bit packed form of Address::get_packed */
 	Address address;
-	Address merge_address;
-	Address log_address;
-	Address replace_address;
-	uint size;
+	ulong merge_address;
+	ulong log_address;
+	ulong replace_address;
+
 	void *payload;
 	Event *next;
+	enum event_type type;
+	uint size;
 	bool noop;
 };
 
+/* Slab allocator for Events.  Events are carved out of slabs of slab_size
+ * events and recycled through an intrusive free list, so after the first few
+ * requests the Ssd serves requests without touching the heap. */
+class Event_pool
+{
+public:
+	Event_pool(uint slab_size = 256);
+	~Event_pool(void);
+	Event *alloc(enum event_type type, ulong logical_address, uint size, double start_time);
+	void free(Event *event);
+	ulong get_num_allocated(void) const;
+	ulong get_num_slabs(void) const;
+private:
+	void grow(void);
+
+	/* a free slot holds the pointer to the next free slot in place of the
+	 * event */
+	union slot {
+		slot *next_free;
+		char event[sizeof(Event)];
+	};
+
+	std::vector<slot *> slabs;
+	slot *free_list;
+	uint slab_size;
+	ulong num_allocated;
+};
+
 /* Single bus channel
  * Simulate multiple devices on 1 bus channel with variable bus transmission
  * durations for data and control delays with the Channel class.  Provide the 
@@ -428,16 +656,40 @@ public:
 	enum status connect(void);
 	enum status disconnect(void);
 	double ready_time(void);
+	uint get_table_entries(void) const;
+	void snapshot(Snapshot &snapshot);
 private:
 	void unlock(double current_time);
 
+	/* The schedule table is a treap of the non-overlapping lock intervals
+	 * keyed by lock_time.  Each entry also keeps the first lock time, the
+	 * last unlock time and the largest free gap of its subtree, so expiring
+	 * old entries, inserting and finding the first gap a new lock fits into
+	 * all take O(log n).  Entries live in one vector and are linked by index
+	 * so the table does not allocate once it has grown to its working size. */
 	struct lock_times {
 		double lock_time;
 		double unlock_time;
+		double first_lock;
+		double last_unlock;
+		double max_gap;
+		uint priority;
+		int left;
+		int right;
 	};
 
-	static bool timings_sorter(lock_times const& lhs, lock_times const& rhs);
+	int new_entry(double lock_time, double unlock_time);
+	void update_entry(int entry);
+	void split_lock(int entry, double lock_time, int &left, int &right);
+	void split_expired(int entry, double current_time, int &left, int &right);
+	int merge_entries(int left, int right);
+	void free_entries(int entry);
+	double first_fit(double start_time, double duration) const;
+
 	std::vector<lock_times> timings;
+	std::vector<int> free_slots;
+	int root;
+	uint seed;
 
 	uint table_entries;
 	uint selected_entry;
@@ -446,7 +698,7 @@ private:
 	double ctrl_delay;
 	double data_delay;
 
-	// Stores the highest unlock_time in the vector timings list.
+	// Stores the highest unlock_time in the schedule table.
 	double ready_at;
 };
 
@@ -468,6 +720,7 @@ public:
 	enum status disconnect(uint channel);
 	Channel &get_channel(uint channel);
 	double ready_time(uint channel);
+	void snapshot(Snapshot &snapshot);
 private:
 	uint num_channels;
 	Channel * const channels;
@@ -475,33 +728,62 @@ private:
 
 
 
-/* The page is the lowest level data storage unit that is the size unit of
- * requests (events).  Pages maintain their state as events modify them. */
-class Page 
+/* Flash state store
+ * Keeps the state of every page and block of the SSD in flat arrays indexed by
+ * physical block number (physical page address / BLOCK_SIZE) instead of in a
+ * Page object per page.  Page states take 2 bits each in a bitmap per block.
+ * The block metadata arrays are public like the members of a struct for quick
+ * access from the Block class, which is a thin view on its entry.  The store
+ * also holds the page data of the SSD. */
+class Flash_state
 {
 public:
-	Page(const Block &parent, double read_delay = PAGE_READ_DELAY, double write_delay = PAGE_WRITE_DELAY);
-	~Page(void);
-	enum status _read(Event &event);
-	enum status _write(Event &event);
-	const Block &get_parent(void) const;
-	enum page_state get_state(void) const;
-	void set_state(enum page_state state);
+	Flash_state(ulong num_blocks, uint block_size = BLOCK_SIZE, uint erases_remaining = BLOCK_ERASES, uint page_size = PAGE_SIZE, bool enable_data = PAGE_ENABLE_DATA);
+	~Flash_state(void);
+	enum page_state get_page_state(ulong block, uint page) const;
+	void set_page_state(ulong block, uint page, enum page_state state);
+	void erase_pages(ulong block);
+	enum status find_empty_page(ulong block, uint &page) const;
+	ulong get_num_blocks(void) const;
+	uint get_block_size(void) const;
+	ulong get_memory_size(void) const;
+	void *get_page_data(ulong page) const;
+	void *get_result_buffer(void) const;
+	void set_result_buffer(void *buffer);
+	void snapshot(Snapshot &snapshot);
+
+	uint * const pages_valid;
+	uint * const pages_invalid;
+	uint * const erases_remaining;
+	double * const last_erase_time;
+	double * const modification_time;
+	unsigned char * const block_state;
+	unsigned char * const block_type;
 private:
-	enum page_state state;
-	const Block &parent;
-	double read_delay;
-	double write_delay;
+	ulong get_data_size(void) const;
+
+	ulong num_blocks;
+	uint block_size;
+	uint words_per_block;
+	ulong * const page_states;
+
+	/* contents of the pages when PAGE_ENABLE_DATA is set, NULL otherwise */
+	uint page_size;
+	void *page_data;
+
+	/* page data of the last read */
+	void *result_buffer;
 };
 
 /* The block is the data storage hardware unit where erases are implemented.
- * Blocks maintain wear statistics for the FTL. */
+ * Blocks maintain wear statistics for the FTL.  The page states and wear
+ * statistics are kept in the Flash_state store of the SSD, the block only
+ * knows where its entry is. */
 class Block 
 {
 public:
 	long physical_address;
-	uint pages_invalid;
-	Block(const Plane &parent, uint size = BLOCK_SIZE, ulong erases_remaining = BLOCK_ERASES, double erase_delay = BLOCK_ERASE_DELAY, long physical_address = 0);
+	Block(const Plane &parent, Flash_state &store, Block_manager &manager, long physical_address = 0);
 	~Block(void);
 	enum status read(Event &event);
 	enum status write(Event &event);
@@ -525,17 +807,12 @@ public:
 	void set_block_type(block_type value);
 
 private:
-	uint size;
-	Page * const data;
 	const Plane &parent;
-	uint pages_valid;
-	enum block_state state;
-	ulong erases_remaining;
-	double last_erase_time;
-	double erase_delay;
-	double modification_time;
+	Flash_state &store;
+	Block_manager &manager;
 
-	block_type btype;
+	/* physical block number, the index of this block in the store */
+	ulong index;
 };
 
 /* The plane is the data storage hardware unit that contains blocks.
@@ -544,7 +821,7 @@ private:
 class Plane 
 {
 public:
-	Plane(const Die &parent, uint plane_size = PLANE_SIZE, double reg_read_delay = PLANE_REG_READ_DELAY, double reg_write_delay = PLANE_REG_WRITE_DELAY, long physical_address = 0);
+	Plane(const Die &parent, Flash_state &store, Block_manager &manager, uint plane_size = PLANE_SIZE, double reg_read_delay = PLANE_REG_READ_DELAY, double reg_write_delay = PLANE_REG_WRITE_DELAY, long physical_address = 0);
 	~Plane(void);
 	enum status read(Event &event);
 	enum status write(Event &event);
@@ -563,6 +840,8 @@ public:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	double get_ready_time(void) const;
+	void snapshot(Snapshot &snapshot);
 private:
 	void update_wear_stats(void);
 	enum status get_next_page(void);
@@ -576,6 +855,9 @@ private:
 	double reg_write_delay;
 	Address next_page;
 	uint free_blocks;
+
+	/* time when the plane finishes its last array operation */
+	double ready_at;
 };
 
 /* The die is the data storage hardware unit that contains planes and is a flash
@@ -583,15 +865,17 @@ private:
 class Die 
 {
 public:
-	Die(const Package &parent, Channel &channel, uint die_size = DIE_SIZE, long physical_address = 0);
+	Die(const Package &parent, Channel &channel, Flash_state &store, Block_manager &manager, uint die_size = DIE_SIZE, long physical_address = 0);
 	~Die(void);
 	enum status read(Event &event);
+	void read_out(const Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
 	enum status replace(Event &event);
 	enum status merge(Event &event);
 	enum status _merge(Event &event);
 	const Package &get_parent(void) const;
+	bool is_functional(void) const;
 	double get_last_erase_time(const Address &address) const;
 	ulong get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
@@ -602,8 +886,14 @@ public:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	double get_ready_time(const Address &address) const;
+	double get_ready_time(const Event &event) const;
+	void snapshot(Snapshot &snapshot);
 private:
 	void update_wear_stats(const Address &address);
+	bool can_join(const Event &event) const;
+	bool can_cache(const Event &event) const;
+	bool multi_plane(Event &event);
 	uint size;
 	Plane * const data;
 	const Package &parent;
@@ -611,6 +901,26 @@ private:
 	uint least_worn;
 	ulong erases_remaining;
 	double last_erase_time;
+
+	/* time when the die finishes its last array operation and can accept
+	 * the next command */
+	double ready_at;
+
+	/* last array operation of the die, which commands to other planes at
+	 * the same block and page offset may join (see multi_plane): its type,
+	 * offsets, number of planes and start time */
+	enum event_type multi_type;
+	uint multi_block;
+	uint multi_page;
+	uint multi_planes;
+	double multi_start;
+
+	/* cache read and cache program (see can_cache): the plane of the last
+	 * operation, when the next command to it can go on the channel and
+	 * when the data of the last read has left the registers */
+	uint cache_plane;
+	double cache_ready;
+	double output_at;
 };
 
 /* The package is the highest level data storage hardware unit.  While the
@@ -620,9 +930,10 @@ private:
 class Package 
 {
 public:
-	Package (const Ssd &parent, Channel &channel, uint package_size = PACKAGE_SIZE, long physical_address = 0);
+	Package (const Ssd &parent, Channel &channel, Flash_state &store, Block_manager &manager, uint package_size = PACKAGE_SIZE, long physical_address = 0);
 	~Package ();
 	enum status read(Event &event);
+	void read_out(const Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
 	enum status replace(Event &event);
@@ -638,6 +949,9 @@ public:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	double get_ready_time(const Address &address) const;
+	double get_ready_time(const Event &event) const;
+	void snapshot(Snapshot &snapshot);
 private:
 	void update_wear_stats (const Address &address);
 	uint size;
@@ -667,6 +981,134 @@ public:
 	enum status insert(const Address &address);
 };
 
+/* Blocks by their number of invalid pages, for the greedy garbage collection.
+ * Each count has a list of the blocks filed under it and the lists hold the
+ * blocks in the order of a sorted sequence that keeps a block in place while
+ * its count does not pass a neighbour's: a block whose count grows by one
+ * goes first in its new list if it was last in its old one, else it joins the
+ * end, and a block whose count drops joins the end.  update must follow each
+ * change of a count; moving a block and finding the last block, the one with
+ * the most invalid pages, take constant time. */
+class Block_cost_index
+{
+public:
+	Block_cost_index(void);
+	void insert(Block *block);
+	void update(Block *block);
+	Block *first(void) const;
+	Block *last(void) const;
+	Block *next(Block *block) const;
+	Block *previous(Block *block) const;
+	uint size(void) const;
+	Block *get_block(uint index) const;
+	void snapshot(Snapshot &snapshot);
+private:
+	void link(int index, uint count, bool front);
+	void unlink(int index);
+
+	/* blocks by their physical address */
+	std::vector<Block *> blocks;
+
+	/* neighbours in the list of each block, -1 at the ends, and the count
+	 * it is filed under */
+	std::vector<int> prev_block;
+	std::vector<int> next_block;
+	std::vector<uint> count;
+
+	/* first and last block of each list, -1 when empty */
+	std::vector<int> head;
+	std::vector<int> tail;
+
+	/* highest count with a block */
+	uint top;
+};
+
+/* Victim choice of the garbage collection of the Block_manager (GC_POLICY).
+ * A victim is a full block with invalid pages other than the block being
+ * written; victim returns NULL when the policy finds none.  allocated and
+ * erased follow the life of the blocks for policies that need their age. */
+class Gc_policy
+{
+public:
+	static Gc_policy *create(const Block_cost_index &index);
+	virtual ~Gc_policy(void);
+	virtual Block *victim(long writing_block, double time) = 0;
+	virtual const char *name(void) const = 0;
+	virtual void allocated(Block *block);
+	virtual void erased(Block *block);
+	virtual void snapshot(Snapshot &snapshot);
+protected:
+	Gc_policy(const Block_cost_index &index);
+	bool is_candidate(const Block *block, long writing_block) const;
+	Block *greedy(long writing_block) const;
+
+	const Block_cost_index &index;
+};
+
+/* Greedy: the block with the most invalid pages, from the cost index. */
+class Gc_policy_Greedy : public Gc_policy
+{
+public:
+	Gc_policy_Greedy(const Block_cost_index &index);
+	Block *victim(long writing_block, double time);
+	const char *name(void) const;
+};
+
+/* Cost-benefit (Kawaguchi et al.): the highest age * invalid / valid, where
+ * age is the time since the last write to the block.  Scans all blocks.  The
+ * ages come from the request times, so functional mode (see
+ * Ssd::set_functional) picks the same victims as timed mode only when it is
+ * given the same times. */
+class Gc_policy_CostBenefit : public Gc_policy
+{
+public:
+	Gc_policy_CostBenefit(const Block_cost_index &index);
+	Block *victim(long writing_block, double time);
+	const char *name(void) const;
+};
+
+/* CAT, Cost-Age-Times (Chiang et al.): cost-benefit divided by the erases
+ * of the block, which spreads the wear.  Scans all blocks. */
+class Gc_policy_Cat : public Gc_policy
+{
+public:
+	Gc_policy_Cat(const Block_cost_index &index);
+	Block *victim(long writing_block, double time);
+	const char *name(void) const;
+};
+
+/* d-choices: the most invalid pages among GC_CHOICES blocks drawn at random,
+ * greedy when no drawn block is a candidate. */
+class Gc_policy_DChoices : public Gc_policy
+{
+public:
+	Gc_policy_DChoices(const Block_cost_index &index);
+	Block *victim(long writing_block, double time);
+	const char *name(void) const;
+	void snapshot(Snapshot &snapshot);
+private:
+	ulong seed;
+};
+
+/* Windowed greedy: the most invalid pages among the GC_WINDOW full blocks
+ * that were allocated first, greedy when none is a candidate. */
+class Gc_policy_Window : public Gc_policy
+{
+public:
+	Gc_policy_Window(const Block_cost_index &index);
+	Block *victim(long writing_block, double time);
+	const char *name(void) const;
+	void allocated(Block *block);
+	void erased(Block *block);
+	void snapshot(Snapshot &snapshot);
+private:
+	/* blocks in the order of allocation with the allocation count of the
+	 * block at the time, entries of erased or reallocated blocks are stale
+	 * and dropped when they reach the front */
+	std::deque<std::pair<uint, ulong> > order;
+	std::vector<ulong> allocations;
+};
+
 class Block_manager
 {
 public:
@@ -684,24 +1126,27 @@ public:
 	bool is_log_full();
 	void erase_and_invalidate(Event &event, Address &address, block_type btype);
 	int get_num_free_blocks();
+	long get_free_page(Event &event);
 
 	// Used to update GC on used pages in blocks.
 	void update_block(Block * b);
 
-	// Singleton
-	static Block_manager *instance();
-	static void instance_initialize(FtlParent *ftl);
-	static Block_manager *inst;
-	
-
 	void cost_insert(Block *b);
 
 	void print_cost_status();
 
-
+	void snapshot(Snapshot &snapshot);
 
 private:
-	void get_page_block(Address &address, Event &event);
+	void get_page_block(Address &address, Event &event, uint pool);
+	bool get_plane_block(Address &address, uint plane);
+	void open_write_blocks(Event &event, uint pool);
+	ulong unused_block(ulong index) const;
+	uint next_pool(Event &event);
+	uint get_pool(const Block *block) const;
+	bool pool_is_empty(uint pool) const;
+	void release(Block *block);
+	void collect(Event &event, Block *victim);
 	static bool block_comparitor_simple (Block const *x,Block const *y);
 
 	FtlParent *ftl;
@@ -716,32 +1161,38 @@ private:
 	ulong max_map_pages;
 	ulong map_space_capacity;
 
-	// Cost/Benefit priority queue.
-	typedef boost::multi_index_container<
-			Block*,
-			boost::multi_index::indexed_by<
-				boost::multi_index::random_access<>,
-				boost::multi_index::ordered_non_unique<BOOST_MULTI_INDEX_MEMBER(Block,uint,pages_invalid) >
-		  >
-		> active_set;
-
-	typedef active_set::nth_index<0>::type ActiveBySeq;
-	typedef active_set::nth_index<1>::type ActiveByCost;
+	// Blocks by number of invalid pages, picks the greedy victims.
+	Block_cost_index active_cost;
 
-	active_set active_cost;
+	Gc_policy *gc_policy;
 
 	// Usual block lists
 	std::vector<Block*> active_list;
-	std::vector<Block*> free_list;
 	std::vector<Block*> invalid_list;
 
+	// Free blocks per die, a single pool with linear allocation. A pool
+	// hands out its blocks that were never written in address order, the
+	// planes of a die in turn with MULTI_PLANE (see unused_block), and
+	// then its erased blocks oldest first.
+	uint num_pools;
+	ulong pool_span;
+	std::vector<ulong> pool_unused;
+	std::vector<std::deque<Block*> > free_pools;
+	ulong num_unused;
+	ulong num_erased;
+
+	// Next page of each open block of a pool for get_free_page, a block
+	// per plane of a multi-plane set, the one the next write goes to, and
+	// the pool chosen last.
+	std::vector<std::vector<long> > write_points;
+	std::vector<uint> write_members;
+	uint last_pool;
+
 	// Counter for returning the next free page.
 	ulong directoryCurrentPage;
 	// Address on the current cached page in SRAM.
 	ulong directoryCachedPage;
 
-	ulong simpleCurrentFree;
-
 	// Counter for handling periodic sort of active_list
 	uint num_insert_events;
 
@@ -750,6 +1201,9 @@ private:
 	bool inited;
 
 	bool out_of_blocks;
+
+	// Set while a collection runs, see insert_events.
+	bool collecting;
 };
 
 class FtlParent
@@ -765,6 +1219,10 @@ public:
 
 	virtual void print_ftl_statistics();
 
+	/* save or load the mapping tables, overridden by FTLs with state of
+	 * their own, which call this first */
+	virtual void snapshot(Snapshot &snapshot);
+
 	friend class Block_manager;
 
 	uint copycnt;
@@ -775,8 +1233,10 @@ public:
 	Block *get_block_pointer(const Address & address);
 
 	Address resolve_logical_address(unsigned int logicalAddress);
+	Block_manager &get_block_manager(void);
 protected:
 	Controller &controller;
+	Block_manager manager;
 };
 
 class FtlImpl_Page : public FtlParent
@@ -787,11 +1247,61 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status trim(Event &event);
+	void cleanup_block(Event &event, Block *block);
+	void print_ftl_statistics();
+	void snapshot(Snapshot &snapshot);
 private:
-	ulong currentPage;
-	ulong numPagesActive;
-	bool *trim_map;
+	long lookup(long lpn, Event &event);
+	long get_gc_page(Event &event);
+	void update_map(long lpn, long ppn);
+
+	/* logical to physical page and back, -1 when unmapped */
 	long *map;
+	long *reverse_map;
+
+	/* last page written to the open block of the pages garbage collection
+	 * moves, -1 before the first */
+	long gcFrontier;
+};
+
+/* Log blocks of BAST keyed by the logical block they belong to.  The entries
+ * are kept dense in an array so a random victim costs one draw, a hash map on
+ * the logical block finds them and a list through the entries keeps them in
+ * the order of allocation, or of the last write for LRU.
+ * The map owns the LogPageBlocks it holds.  victim returns the logical block
+ * whose log block BAST_LOG_VICTIM selects. */
+class Log_block_map
+{
+public:
+	Log_block_map(uint limit);
+	~Log_block_map(void);
+	LogPageBlock *find(long lba) const;
+	void insert(long lba, LogPageBlock *block);
+	void erase(long lba);
+	void touch(long lba);
+	uint size(void) const;
+	long victim(void) const;
+	void snapshot(Snapshot &snapshot);
+private:
+	struct entry {
+		long lba;
+		LogPageBlock *block;
+		int prev;
+		int next;
+	};
+
+	int find_entry(long lba) const;
+	void link(int index);
+	void unlink(int index);
+
+	std::vector<entry> entries;
+
+	/* entry index of each logical block */
+	std::unordered_map<long, int> index;
+
+	/* oldest and newest entry of the list */
+	int head;
+	int tail;
 };
 
 class FtlImpl_Bast : public FtlParent
@@ -802,13 +1312,14 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status trim(Event &event);
+	void snapshot(Snapshot &snapshot);
 private:
-	std::map<long, LogPageBlock*> log_map;
+	Log_block_map log_map;
 
 	long *data_list;
 
-	void dispose_logblock(LogPageBlock *logBlock, long lba);
-	void allocate_new_logblock(LogPageBlock *logBlock, long lba, Event &event);
+	void dispose_logblock(long lba);
+	LogPageBlock *allocate_new_logblock(long lba, Event &event);
 
 	bool is_sequential(LogPageBlock* logBlock, long lba, Event &event);
 	bool random_merge(LogPageBlock *logBlock, long lba, Event &event);
@@ -829,6 +1340,7 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status trim(Event &event);
+	void snapshot(Snapshot &snapshot);
 private:
 	void initialize_log_pages();
 
@@ -837,6 +1349,16 @@ private:
 	long *data_list;
 	bool *pin_list;
 
+	/* Page of the newest copy of each logical page in the RW log blocks.
+	 * Pages whose newest copy is in the SW log block or a data block have no
+	 * entry, so a read needs one lookup instead of a scan of the log. */
+	struct log_location {
+		LogPageBlock *block;
+		int offset;
+	};
+	std::unordered_map<long, log_location> log_index;
+	void drop_log_index(long logicalBlockAddress);
+
 	bool write_to_log_block(Event &event, long logicalBlockAddress);
 
 	void switch_sequential(Event &event);
@@ -860,52 +1382,219 @@ private:
 
 
 
-class FtlImpl_DftlParent : public FtlParent
+/* Cached mapping table (CMT) of the DFTL family: the set of logical pages
+ * whose mapping is held in SRAM.  Entries live in a table and are linked by
+ * index into the queues of a replacement policy; an open addressing hash on
+ * the logical page finds them, so a hit costs one probe and a relink.  Policies
+ * that remember recently evicted pages keep them as ghost entries in queues of
+ * their own, a ghost holds no mapping and is not contained in the cache.  The
+ * FTLs evict down to the capacity before they insert on a miss, garbage
+ * collection may insert past it until the next miss evicts, in which case the
+ * tables grow.  create returns the policy selected by CACHE_DFTL_POLICY for
+ * translation pages of entries_per_page mappings. */
+class Mapping_cache
 {
 public:
-	FtlImpl_DftlParent(Controller &controller);
-	~FtlImpl_DftlParent();
-	virtual enum status read(Event &event) = 0;
-	virtual enum status write(Event &event) = 0;
-	virtual enum status trim(Event &event) = 0;
+	static Mapping_cache *create(uint capacity, uint entries_per_page);
+	virtual ~Mapping_cache(void);
+	bool contains(long vpn) const;
+	bool is_dirty(long vpn) const;
+	uint size(void) const;
+	void set_dirty(long vpn, bool dirty);
+	void mark_prefetched(long vpn);
+	bool clear_prefetched(long vpn);
+	void erase(long vpn);
+	ulong get_memory_size(void) const;
+	void snapshot(Snapshot &snapshot);
+
+	/* cache vpn after a miss, a mapping that is not recent (cached by garbage
+	 * collection) gets the lowest priority of the policy */
+	virtual void insert(long vpn, bool dirty, bool recent = true) = 0;
+
+	/* a hit, dirties vpn on a write */
+	virtual void touch(long vpn, bool dirty) = 0;
+
+	/* remove the victim of the policy and return it, -1 if the cache is
+	 * empty */
+	virtual long evict(bool &dirty) = 0;
+
+	/* the translation page of vpn was written, its cached mappings are
+	 * clean */
+	virtual void clean_page(long vpn);
 protected:
-	struct MPage {
+	Mapping_cache(uint capacity, uint entries_per_page, uint num_queues, uint num_ghost_queues);
+
+	struct entry {
 		long vpn;
-		long ppn;
-		double create_ts;
-		double modified_ts;
-		double last_visited_time;
-		bool cached;
+		int prev;
+		int next;
+		uint queue;
+		unsigned char hits; // reference bit or frequency, up to the policy
+		bool dirty;
+		bool prefetched; // cached ahead of use and not hit since
+	};
 
-		MPage(long vpn);
+	struct queue {
+		int head;
+		int tail;
+		uint size;
 	};
 
-	long int cmt;
+	int find_ghost(long vpn) const;
+	int hit(long vpn, bool dirty);
+	int add(long vpn, uint queue, bool dirty, bool front);
+	void move(int index, uint queue, bool front);
+	long drop(int index, bool &dirty);
+	long demote(int index, uint ghost_queue, uint ghost_limit, bool &dirty);
+	void remove(int index);
+	virtual void snapshot_policy(Snapshot &snapshot);
+
+	std::vector<entry> entries;
+
+	/* resident queues first, then the ghost queues */
+	std::vector<queue> queues;
+	uint num_resident_queues;
+	uint capacity;
+	uint entries_per_page;
+private:
+	int find(long vpn) const;
+	uint bucket(long vpn) const;
+	void link(int index, uint queue, bool front);
+	void unlink(int index);
+	void rehash(uint num_buckets);
+	void clear(void);
+
+	/* entry index or -1 for each bucket, linear probing */
+	std::vector<int> buckets;
+	uint bucket_bits;
+
+	/* unused entries are chained through next */
+	int free_list;
+
+	/* resident entries, and all entries including ghosts */
+	uint count;
+	uint used;
+};
+
+/* LRU: a hit moves the mapping to the front, the tail is evicted. */
+class Mapping_cache_Lru : public Mapping_cache
+{
+public:
+	Mapping_cache_Lru(uint capacity, uint entries_per_page);
+	void insert(long vpn, bool dirty, bool recent = true);
+	void touch(long vpn, bool dirty);
+	long evict(bool &dirty);
+};
 
-	static double mpage_last_visited_time_compare(const MPage& mpage);
+/* CLOCK: a hit sets the reference bit, the hand clears set bits and gives
+ * those mappings another round before it evicts one with a clear bit. */
+class Mapping_cache_Clock : public Mapping_cache
+{
+public:
+	Mapping_cache_Clock(uint capacity, uint entries_per_page);
+	void insert(long vpn, bool dirty, bool recent = true);
+	void touch(long vpn, bool dirty);
+	long evict(bool &dirty);
+};
 
-	typedef boost::multi_index_container<
-		FtlImpl_DftlParent::MPage,
-			boost::multi_index::indexed_by<
-		    // sort by MPage::operator<
-    			boost::multi_index::random_access<>,
+/* 2Q (Johnson and Shasha): new mappings enter a FIFO, a mapping that misses
+ * again while the ghost queue behind the FIFO remembers it enters the main LRU
+ * queue. */
+class Mapping_cache_2Q : public Mapping_cache
+{
+public:
+	Mapping_cache_2Q(uint capacity, uint entries_per_page);
+	void insert(long vpn, bool dirty, bool recent = true);
+	void touch(long vpn, bool dirty);
+	long evict(bool &dirty);
+private:
+	uint in_limit;
+	uint out_limit;
+};
 
-    			// Sort by last visited time
-    			boost::multi_index::ordered_non_unique<boost::multi_index::global_fun<const FtlImpl_DftlParent::MPage&,double,&FtlImpl_DftlParent::mpage_last_visited_time_compare> >
-		  >
-		> trans_set;
+/* ARC (Megiddo and Modha): splits the cache between mappings used once and
+ * mappings used again and moves the split towards the side whose ghost queue
+ * takes the misses. */
+class Mapping_cache_Arc : public Mapping_cache
+{
+public:
+	Mapping_cache_Arc(uint capacity, uint entries_per_page);
+	void insert(long vpn, bool dirty, bool recent = true);
+	void touch(long vpn, bool dirty);
+	long evict(bool &dirty);
+protected:
+	void snapshot_policy(Snapshot &snapshot);
+private:
+	/* target size of the queue of mappings used once */
+	uint target;
+};
+
+/* S3-FIFO (Yang et al.): a small FIFO filters out mappings used once, the
+ * others live in a main FIFO that evicts like CLOCK with a 2 bit frequency. */
+class Mapping_cache_S3Fifo : public Mapping_cache
+{
+public:
+	Mapping_cache_S3Fifo(uint capacity, uint entries_per_page);
+	void insert(long vpn, bool dirty, bool recent = true);
+	void touch(long vpn, bool dirty);
+	long evict(bool &dirty);
+private:
+	uint small_limit;
+};
+
+/* TPFTL (Zhou et al.): mappings are grouped by translation page, the pages
+ * are kept in LRU order and so are the mappings within each page.  The victim
+ * comes from the least recently used page, a clean mapping if the page has
+ * one.  A dirty victim makes the FTL write its translation page, which cleans
+ * every cached mapping of the page, so the dirty mappings of a page go back
+ * to flash in one write and the page is then emptied with clean evictions. */
+class Mapping_cache_Tpftl : public Mapping_cache
+{
+public:
+	Mapping_cache_Tpftl(uint capacity, uint entries_per_page);
+	void insert(long vpn, bool dirty, bool recent = true);
+	void touch(long vpn, bool dirty);
+	long evict(bool &dirty);
+	void clean_page(long vpn);
+protected:
+	void snapshot_policy(Snapshot &snapshot);
+private:
+	void link_page(uint page, bool front);
+	void unlink_page(uint page);
+
+	/* LRU list of the translation pages with cached mappings, the queue of
+	 * each page holds its mappings; -2 marks a page that is not listed */
+	std::vector<int> page_prev;
+	std::vector<int> page_next;
+	int page_head;
+	int page_tail;
+};
 
-	typedef trans_set::nth_index<0>::type MpageByID;
-	typedef trans_set::nth_index<1>::type MpageByLastVisited;
+class FtlImpl_DftlParent : public FtlParent
+{
+public:
+	FtlImpl_DftlParent(Controller &controller);
+	~FtlImpl_DftlParent();
+	virtual enum status read(Event &event) = 0;
+	virtual enum status write(Event &event) = 0;
+	virtual enum status trim(Event &event) = 0;
+	void snapshot(Snapshot &snapshot);
 
-	trans_set trans_map;
+	// Number of mappings that fit in a translation page, the unit of
+	// CACHE_DFTL_LIMIT
+	static int address_per_page(void);
+protected:
+	// Global translation directory: ppn of each logical page, -1 if unmapped
+	long *trans_map;
 	long *reverse_trans_map;
 
+	// Cached mapping table
+	Mapping_cache *cmt;
+
 	void consult_GTD(long dppn, Event &event);
-	void reset_MPage(FtlImpl_DftlParent::MPage &mpage);
 
 	void resolve_mapping(Event &event, bool isWrite);
-	void update_translation_map(FtlImpl_DftlParent::MPage &mpage, long ppn);
+	void update_translation_map(long vpn, long ppn);
 
 	bool lookup_CMT(long dlpn, Event &event);
 
@@ -914,6 +1603,8 @@ protected:
 
 	void evict_page_from_cache(Event &event);
 	void evict_specific_page_from_cache(Event &event, long lba);
+	void write_back_translation_page(Event &event, long vpn);
+	void prefetch_mappings(Event &event, long dlpn);
 
 	// Mapping information
 	int addressPerPage;
@@ -923,6 +1614,10 @@ protected:
 	// Current storage
 	long currentDataPage;
 	long currentTranslationPage;
+
+	// Sequential read detection for the mapping prefetch
+	long lastReadPage;
+	uint sequentialReads;
 };
 
 class FtlImpl_Dftl : public FtlImpl_DftlParent
@@ -946,10 +1641,11 @@ public:
 	enum status write(Event &event);
 	enum status trim(Event &event);
 	void cleanup_block(Event &event, Block *block);
+	void snapshot(Snapshot &snapshot);
 	struct BPage {
 		uint pbn;
 		unsigned char nextPage;
-		double emt;
+		double emt; // EMT plus emt_decay, see get_emt
 		bool allocating;
 		uint pageCount;
 		uint validCount;
@@ -981,6 +1677,27 @@ public:
 	void print_block_status();
 	long get_my_free_data_page(Event &event);
 
+	double get_emt(uint dlbn) const;
+	void set_emt(uint dlbn, double emt);
+	void decay_emt(double timeGap);
+	void reindex(uint dlbn);
+
+	/* Time every EMT has decayed by. The table holds each EMT plus the
+	 * decay at the time it was set, so a write decays all blocks by adding
+	 * to emt_decay and an EMT that reaches zero stays there. */
+	double emt_decay;
+
+	/* Blocks with free pages by EMT, those whose EMT decayed to zero apart
+	 * and by block, so the nearest EMT is a lookup on either side instead
+	 * of a scan of the table. Allocated blocks with free pages and blocks
+	 * without a physical block, by block, for garbage collection. reindex
+	 * moves a block to the sets its entry calls for. */
+	std::set<std::pair<double, uint> > emt_index;
+	std::set<uint> emt_zero;
+	std::set<uint> open_blocks;
+	std::set<uint> free_blocks;
+	std::vector<double> index_key;
+	std::vector<unsigned char> index_state;
 };
 
 class FtlImpl_BDftl : public FtlImpl_DftlParent
@@ -992,6 +1709,7 @@ public:
 	enum status write(Event &event);
 	enum status trim(Event &event);
 	void cleanup_block(Event &event, Block *block);
+	void snapshot(Snapshot &snapshot);
 private:
 	struct BPage {
 		uint pbn;
@@ -1055,9 +1773,20 @@ public:
 	Stats stats;
 	void print_ftl_statistics();
 	const FtlParent &get_ftl(void) const;
+	Block_manager &get_block_manager(void);
+	void snapshot(Snapshot &snapshot);
+	void set_functional(bool value);
+	bool is_functional(void) const;
 private:
+	enum status event_arrive_pages(Event &event);
 	enum status issue(Event &event_list);
-	void translate_address(Address &address);
+	enum status issue_superpages(Event &event_list);
+	enum status issue_pages(Event &event_list);
+	enum status issue_functional(Event &event_list);
+	void *get_page_data(ulong page) const;
+	void wait_ready(Event &event);
+	double get_ready_time(const Address &address);
+	void translate_address(Address &address, uint unit);
 	ssd::ulong get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
 	double get_last_erase_time(const Address &address) const;
@@ -1070,6 +1799,9 @@ private:
 	Block *get_block_pointer(const Address & address);
 	Ssd &ssd;
 	FtlParent *ftl;
+
+	/* events only change the state of the flash, see Ssd::set_functional */
+	bool functional;
 };
 
 /* The SSD is the single main object that will be created to simulate a real
@@ -1092,8 +1824,14 @@ public:
 
 	void print_ftl_statistics();
 	double ready_at(void);
+	void save_snapshot(const char *filename, double time = 0.0);
+	double load_snapshot(const char *filename);
+	void set_functional(bool functional);
+	bool is_functional(void) const;
 private:
+	void snapshot(Snapshot &snapshot, double &time);
 	enum status read(Event &event);
+	void read_out(const Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
 	enum status merge(Event &event);
@@ -1111,21 +1849,151 @@ private:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	double get_ready_time(const Address &address) const;
+	double get_ready_time(const Event &event) const;
 
+	/* configuration the Ssd was created with, first so it is initialized
+	 * before everything that reads the configuration */
+	Config config;
 	uint size;
+	Event_pool event_pool;
 	Controller controller;
 	Ram ram;
 	Bus bus;
+	Flash_state flash_state;
 	Package * const data;
 	ulong erases_remaining;
 	ulong least_worn;
 	double last_erase_time;
+
+	/* finish times of host requests still in flight, earliest on top */
+	std::priority_queue<double, std::vector<double>, std::greater<double> > completions;
+};
+
+/* Bounded lock-free queue for exactly one producer thread and one consumer
+ * thread.  The size is rounded up to a power of two.  push and pop return
+ * false instead of blocking when the ring is full or empty, pop_batch returns
+ * 0 when it is empty. */
+template <class T>
+class Spsc_ring
+{
+public:
+	Spsc_ring(uint size = 64):
+		mask(round_up(size) - 1),
+		slots(new T[mask + 1]),
+		head(0),
+		tail(0)
+	{}
+
+	~Spsc_ring(void)
+	{
+		delete[] slots;
+	}
+
+	bool push(const T &item)
+	{
+		ulong cur = tail.load(std::memory_order_relaxed);
+		if (cur - head.load(std::memory_order_acquire) > mask)
+			return false;
+		slots[cur & mask] = item;
+		tail.store(cur + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &item)
+	{
+		ulong cur = head.load(std::memory_order_relaxed);
+		if (cur == tail.load(std::memory_order_acquire))
+			return false;
+		item = slots[cur & mask];
+		head.store(cur + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* pop up to max items at once, returns how many were popped */
+	uint pop_batch(T *items, uint max)
+	{
+		ulong cur = head.load(std::memory_order_relaxed);
+		ulong avail = tail.load(std::memory_order_acquire) - cur;
+		uint n = avail < max ? avail : max;
+		for (uint i = 0; i < n; i++)
+			items[i] = slots[(cur + i) & mask];
+		head.store(cur + n, std::memory_order_release);
+		return n;
+	}
+
+	bool empty(void) const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+private:
+	static ulong round_up(uint size)
+	{
+		ulong n = 1;
+		while (n < size)
+			n <<= 1;
+		return n;
+	}
+
+	const ulong mask;
+	T * const slots;
+
+	/* head is written by the consumer and tail by the producer, keep them on
+	 * separate cache lines (padded, operator new ignores alignas before C++17) */
+	char pad_head[64];
+	std::atomic<ulong> head;
+	char pad_tail[64 - sizeof(std::atomic<ulong>)];
+	std::atomic<ulong> tail;
+	char pad_end[64 - sizeof(std::atomic<ulong>)];
+};
+
+/* Request passed from a RaidSsd to one of its member Ssds */
+struct Raid_request
+{
+	enum event_type type;
+	ulong logical_address;
+	uint size;
+	double start_time;
+	void *buffer;
 };
 
+/* Worker thread that runs the requests of one member Ssd of a RaidSsd.
+ * Requests go in and times taken come back through Spsc_rings, so the
+ * RaidSsd and its workers never take a lock while requests flow.  Waiting
+ * spins for a short while and then yields the processor; a worker that runs
+ * out of requests sleeps on a condition variable until the next submit. */
+class Raid_worker
+{
+public:
+	Raid_worker(Ssd &ssd, uint ring_size = 64);
+	~Raid_worker(void);
+	void submit(const Raid_request &request);
+	double complete(void);
+private:
+	void run(void);
+	Ssd &ssd;
+	Spsc_ring<Raid_request> requests;
+	Spsc_ring<double> results;
+	std::atomic<bool> stopping;
+	std::atomic<bool> sleeping;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::thread thread;
+};
+
+/* RAID front end over RAID_NUMBER_OF_PHYSICAL_SSDS member Ssds
+ * In striping mode (PARALLELISM_MODE 1) every request goes to all members
+ * and completes when the slowest member does; in address splitting mode
+ * (PARALLELISM_MODE 2) it goes to one member.  With parallel set each member
+ * of a striped array runs in its own Raid_worker thread, otherwise the
+ * members run one after the other on the calling thread.  Address splitting
+ * always runs on the calling thread, as a request has only one member to
+ * wait for. */
 class RaidSsd
 {
 public:
-	RaidSsd (uint ssd_size = SSD_SIZE);
+	RaidSsd (uint ssd_size = SSD_SIZE, bool parallel = true);
 	~RaidSsd(void);
 	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time);
 	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
@@ -1139,11 +2007,118 @@ public:
 
 	void print_ftl_statistics();
 private:
+	double run(uint member, const Raid_request &request);
+
+	Config config;
 	uint size;
 
 	Ssd *Ssds;
+	std::vector<Raid_worker *> workers;
 
+	/* Ssd that served the last request, it holds the result buffer */
+	Ssd *last_ssd;
+
+	/* request counters */
+	ulong num_reads;
+	ulong num_writes;
+	ulong num_other;
+	ulong num_member_requests;
+	ulong num_timing_mismatches;
+};
+
+/* One request of a trace replayed by the run_* drivers.  Text traces hold one
+ * request per line as "pattern; type; address; query time; size; arrive time",
+ * binary traces hold the records themselves after a Trace_header, so a
+ * memory-mapped binary trace is read without copying or decoding. */
+struct Trace_record
+{
+	double arrive_time;
+	ulong address;
+	uint query_time;
+	int size;
+	char pattern; /* (S)equential or (R)andom */
+	char type; /* (R)ead or (W)rite */
+	char unused[6];
+};
+
+/* Header of a binary trace, records are in host byte order */
+struct Trace_header
+{
+	char magic[8];
+	uint version;
+	uint record_size;
+	ulong num_records;
+	ulong unused;
 };
+
+/* Reads the records of a text or binary trace, telling them apart by the
+ * binary trace magic.  Binary traces are mapped into memory and begin/end give
+ * the records in place; next copies out the next record of either format. */
+class Trace_reader
+{
+public:
+	Trace_reader(const char *filename);
+	~Trace_reader(void);
+	bool next(Trace_record &record);
+	bool is_binary(void) const;
+	const Trace_record *begin(void) const;
+	const Trace_record *end(void) const;
+	static bool parse_line(const char *line, Trace_record &record);
+	static ulong convert(const char *text_filename, const char *binary_filename);
+private:
+	FILE *text;
+	void *map;
+	ulong map_size;
+	const Trace_record *records;
+	const Trace_record *records_end;
+	const Trace_record *cur;
+};
+
+/* Number of records a Trace_pipeline hands to the simulation at once */
+#define TRACE_BATCH_SIZE 256
+
+/* Reads a trace through a Trace_reader in a producer thread and hands the
+ * decoded records to the simulation thread through a bounded Spsc_ring, so
+ * file I/O and text decoding overlap the simulation.  The producer waits
+ * while the ring is full and ends the stream with a marker record.  Without
+ * threaded the records are read in the calling thread instead; drivers use
+ * the same next() loop either way. */
+class Trace_pipeline
+{
+public:
+	Trace_pipeline(const char *filename, bool threaded = true, uint ring_size = 16384);
+	~Trace_pipeline(void);
+	bool next(Trace_record &record);
+	uint next_batch(Trace_record *records, uint max);
+private:
+	void run(void);
+	Trace_reader reader;
+	Spsc_ring<Trace_record> ring;
+	std::atomic<bool> stopping;
+	bool ended;
+
+	/* records popped from the ring that next has not handed out yet */
+	Trace_record batch[TRACE_BATCH_SIZE];
+	uint batch_pos;
+	uint batch_size;
+
+	std::thread thread;
+};
+
+/* Benchmark support from ssd_bench.cpp
+ *
+ * next_random steps the 64-bit linear congruential generator in seed and
+ * returns its upper 31 bits, so the same seed gives the same numbers on every
+ * platform, unlike random().  wall_clock is the wall-clock time in seconds.
+ * bench_fill writes the first range pages of ssd once in functional mode (see
+ * Ssd::set_functional), switches it to timed mode and starts its statistics
+ * over.  bench_sweep sets a configuration variable to 0, 1, ... values - 1 in
+ * turn, e.g. &Config::CACHE_DFTL_POLICY, and calls run with each value; the
+ * configuration of the calling thread is restored afterwards. */
+ulong next_random(ulong &seed);
+double wall_clock(void);
+void bench_fill(Ssd &ssd, uint range);
+void bench_sweep(uint Config::*variable, uint values, const std::function<void (uint)> &run);
 } /* end namespace ssd */
 
 #endif
@@ -26,12 +26,14 @@
  * physical address in the Event class.
  */
 
+#include <assert.h>
 #include <stdio.h>
 #include "ssd.h"
 
 using namespace ssd;
 
 Address::Address(void):
+	real_address(0),
 	package(0),
 	die(0),
 	plane(0),
@@ -167,6 +169,58 @@ void Address::set_linear_address(ulong address, enum address_valid valid)
 	this->valid = valid;
 }
 
+/* bit fields of the packed address, lowest bits first */
+#define PACKED_VALID_BITS 3
+#define PACKED_PAGE_BITS 16
+#define PACKED_BLOCK_BITS 24
+#define PACKED_PLANE_BITS 8
+#define PACKED_DIE_BITS 6
+#define PACKED_PACKAGE_BITS 7
+
+#define PACKED_FIELD(value, shift, bits) (((ulong) (value) & ((1UL << (bits)) - 1)) << (shift))
+#define UNPACKED_FIELD(packed, shift, bits) ((uint) (((packed) >> (shift)) & ((1UL << (bits)) - 1)))
+
+#define PACKED_PAGE_SHIFT PACKED_VALID_BITS
+#define PACKED_BLOCK_SHIFT (PACKED_PAGE_SHIFT + PACKED_PAGE_BITS)
+#define PACKED_PLANE_SHIFT (PACKED_BLOCK_SHIFT + PACKED_BLOCK_BITS)
+#define PACKED_DIE_SHIFT (PACKED_PLANE_SHIFT + PACKED_PLANE_BITS)
+#define PACKED_PACKAGE_SHIFT (PACKED_DIE_SHIFT + PACKED_DIE_BITS)
+
+/* pack the address into 64 bits: the valid status and each hardware field in
+ * its own bit field, so unpacking needs shifts and masks and not the
+ * divisions set_linear_address does
+ * fits 128 packages of 64 dies of 256 planes of 16M blocks of 64K pages */
+ulong Address::get_packed(void) const
+{
+	return PACKED_FIELD(valid, 0, PACKED_VALID_BITS)
+		| PACKED_FIELD(page, PACKED_PAGE_SHIFT, PACKED_PAGE_BITS)
+		| PACKED_FIELD(block, PACKED_BLOCK_SHIFT, PACKED_BLOCK_BITS)
+		| PACKED_FIELD(plane, PACKED_PLANE_SHIFT, PACKED_PLANE_BITS)
+		| PACKED_FIELD(die, PACKED_DIE_SHIFT, PACKED_DIE_BITS)
+		| PACKED_FIELD(package, PACKED_PACKAGE_SHIFT, PACKED_PACKAGE_BITS);
+}
+
+void Address::set_packed(ulong packed)
+{
+	valid = (enum address_valid) UNPACKED_FIELD(packed, 0, PACKED_VALID_BITS);
+	page = UNPACKED_FIELD(packed, PACKED_PAGE_SHIFT, PACKED_PAGE_BITS);
+	block = UNPACKED_FIELD(packed, PACKED_BLOCK_SHIFT, PACKED_BLOCK_BITS);
+	plane = UNPACKED_FIELD(packed, PACKED_PLANE_SHIFT, PACKED_PLANE_BITS);
+	die = UNPACKED_FIELD(packed, PACKED_DIE_SHIFT, PACKED_DIE_BITS);
+	package = UNPACKED_FIELD(packed, PACKED_PACKAGE_SHIFT, PACKED_PACKAGE_BITS);
+	real_address = (((((ulong) package * PACKAGE_SIZE + die) * DIE_SIZE + plane) * PLANE_SIZE + block) * BLOCK_SIZE) + page;
+}
+
+/* the largest geometry get_packed can represent */
+bool Address::packable(uint ssd_size, uint package_size, uint die_size, uint plane_size, uint block_size)
+{
+	return ssd_size <= (1U << PACKED_PACKAGE_BITS)
+		&& package_size <= (1U << PACKED_DIE_BITS)
+		&& die_size <= (1U << PACKED_PLANE_BITS)
+		&& plane_size <= (1U << PACKED_BLOCK_BITS)
+		&& block_size <= (1U << PACKED_PAGE_BITS);
+}
+
 unsigned long Address::get_linear_address() const
 {
 	return real_address;
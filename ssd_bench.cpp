@@ -0,0 +1,69 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_bench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Benchmark support
+ *
+ * The random numbers, wall clock, preconditioning and configuration sweep
+ * the benchmark programs share.  The randomized GC victim policies draw
+ * from the same generator.
+ */
+
+#include <sys/time.h>
+#include "ssd.h"
+
+namespace ssd {
+
+/* 64-bit linear congruential generator (Knuth's MMIX constants), the upper
+ * bits are the random ones */
+ulong next_random(ulong &seed)
+{
+	seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+	return seed >> 33;
+}
+
+double wall_clock(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void bench_fill(Ssd &ssd, uint range)
+{
+	ssd.set_functional(true);
+	for (uint i = 0; i < range; i++)
+		ssd.event_arrive(WRITE, i, 1, 0.0);
+	ssd.set_functional(false);
+	ssd.reset_statistics();
+	return;
+}
+
+void bench_sweep(uint Config::*variable, uint values, const std::function<void (uint)> &run)
+{
+	for (uint value = 0; value < values; value++)
+	{
+		Config config;
+		config.*variable = value;
+		Config_scope scope(config);
+		run(value);
+	}
+	return;
+}
+
+}
@@ -21,102 +21,75 @@
  * Brendan Tauras 2009-10-26
  *
  * The block is the data storage hardware unit where erases are implemented.
- * Blocks maintain wear statistics for the FTL. */
+ * Blocks maintain wear statistics for the FTL.  A block is a view of its entry
+ * in the Flash_state store, which holds the page states and statistics. */
 
 #include <new>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include "ssd.h"
 
 using namespace ssd;
 
-Block::Block(const Plane &parent, uint block_size, ulong erases_remaining, double erase_delay, long physical_address):
-	pages_invalid(0),
+Block::Block(const Plane &parent, Flash_state &store, Block_manager &manager, long physical_address):
 	physical_address(physical_address),
-	size(block_size),
-
-	/* use a const pointer (Page * const data) to use as an array
-	 * but like a reference, we cannot reseat the pointer */
-	data((Page *) malloc(block_size * sizeof(Page))),
 	parent(parent),
-	pages_valid(0),
-
-	state(FREE),
-
-	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
-	 * in Plane class
-	 * this is the cheap implementation but can change to pass through classes */
-	erases_remaining(erases_remaining),
-
-	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0),
-	erase_delay(erase_delay),
-
-	modification_time(-1)
-
+	store(store),
+	manager(manager),
+	index(physical_address / store.get_block_size())
 {
-	uint i;
-
-	if(erase_delay < 0.0)
-	{
-		fprintf(stderr, "Block warning: %s: constructor received negative erase delay value\n\tsetting erase delay to 0.0\n", __func__);
-		erase_delay = 0.0;
-	}
-
-	/* new cannot initialize an array with constructor args so
-	 * 	malloc the array
-	 * 	then use placement new to call the constructor for each element
-	 * chose an array over container class so we don't have to rely on anything
-	 * 	i.e. STL's std::vector */
-	/* array allocated in initializer list:
-	 * data = (Page *) malloc(size * sizeof(Page)); */
-	if(data == NULL){
-		fprintf(stderr, "Block error: %s: constructor unable to allocate Page data\n", __func__);
-		exit(MEM_ERR);
-	}
-
-	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Page(*this, PAGE_READ_DELAY, PAGE_WRITE_DELAY);
+	assert(index < store.get_num_blocks());
 
 	// Creates the active cost structure in the block manager.
 	// It assumes that it is created lineary.
-	Block_manager::instance()->cost_insert(this);
+	manager.cost_insert(this);
 
 	return;
 }
 
 Block::~Block(void)
 {
-	assert(data != NULL);
-	uint i;
-	/* call destructor for each Page array element
-	 * since we used malloc and placement new */
-	for(i = 0; i < size; i++)
-		data[i].~Page();
-	free(data);
 	return;
 }
 
 enum status Block::read(Event &event)
 {
-	assert(data != NULL);
-	return data[event.get_address().page]._read(event);
+	assert(PAGE_READ_DELAY >= 0.0 && event.get_address().page < get_size());
+
+	event.incr_time_taken(PAGE_READ_DELAY);
+
+	if (!event.get_noop() && PAGE_ENABLE_DATA)
+		store.set_result_buffer(store.get_page_data(event.get_address().get_linear_address()));
+
+	return SUCCESS;
 }
 
 enum status Block::write(Event &event)
 {
-	assert(data != NULL);
-	enum status ret = data[event.get_address().page]._write(event);
+	uint page = event.get_address().page;
+	assert(PAGE_WRITE_DELAY >= 0.0 && page < get_size());
+
+	event.incr_time_taken(PAGE_WRITE_DELAY);
+
+	if (PAGE_ENABLE_DATA && event.get_payload() != NULL && event.get_noop() == false)
+	{
+		void *data = store.get_page_data(event.get_address().get_linear_address());
+		memcpy (data, event.get_payload(), PAGE_SIZE);
+	}
 
 	if(event.get_noop() == false)
 	{
-		pages_valid++;
-		state = ACTIVE;
-		modification_time = event.get_start_time();
+		assert(store.get_page_state(index, page) == EMPTY);
+		store.set_page_state(index, page, VALID);
+
+		store.pages_valid[index]++;
+		store.block_state[index] = ACTIVE;
+		store.modification_time[index] = event.get_start_time();
 
-		Block_manager::instance()->update_block(this);
+		manager.update_block(this);
 	}
-	return ret;
+	return SUCCESS;
 }
 
 enum status Block::replace(Event &event)
@@ -126,37 +99,31 @@ enum status Block::replace(Event &event)
 }
 
 /* updates Event time_taken
- * sets Page statuses to EMPTY
+ * sets page states to EMPTY
  * updates last_erase_time and erases_remaining
  * returns 1 for success, 0 for failure */
 enum status Block::_erase(Event &event)
 {
-	assert(data != NULL && erase_delay >= 0.0);
-	uint i;
+	assert(BLOCK_ERASE_DELAY >= 0.0);
 
 	if (!event.get_noop())
 	{
-		if(erases_remaining < 1)
+		if(store.erases_remaining[index] < 1)
 		{
 			fprintf(stderr, "Block error: %s: No erases remaining when attempting to erase\n", __func__);
 			return FAILURE;
 		}
 
-		for(i = 0; i < size; i++)
-		{
-			//assert(data[i].get_state() == INVALID);
-			data[i].set_state(EMPTY);
-		}
-
+		store.erase_pages(index);
 
-		event.incr_time_taken(erase_delay);
-		last_erase_time = event.get_start_time() + event.get_time_taken();
-		erases_remaining--;
-		pages_valid = 0;
-		pages_invalid = 0;
-		state = FREE;
+		event.incr_time_taken(BLOCK_ERASE_DELAY);
+		store.last_erase_time[index] = event.get_start_time() + event.get_time_taken();
+		store.erases_remaining[index]--;
+		store.pages_valid[index] = 0;
+		store.pages_invalid[index] = 0;
+		store.block_state[index] = FREE;
 
-		Block_manager::instance()->update_block(this);
+		manager.update_block(this);
 	}
 
 	return SUCCESS;
@@ -169,90 +136,88 @@ const Plane &Block::get_parent(void) const
 
 ssd::uint Block::get_pages_valid(void) const
 {
-	return pages_valid;
+	return store.pages_valid[index];
 }
 
 ssd::uint Block::get_pages_invalid(void) const
 {
-	return pages_invalid;
+	return store.pages_invalid[index];
 }
 
 
 enum block_state Block::get_state(void) const
 {
-	return state;
+	return (enum block_state) store.block_state[index];
 }
 
 enum page_state Block::get_state(uint page) const
 {
-	assert(data != NULL && page < size);
-	return data[page].get_state();
+	assert(page < get_size());
+	return store.get_page_state(index, page);
 }
 
 enum page_state Block::get_state(const Address &address) const
 {
-   assert(data != NULL && address.page < size && address.valid >= BLOCK);
-   return data[address.page].get_state();
+   assert(address.page < get_size() && address.valid >= BLOCK);
+   return store.get_page_state(index, address.page);
 }
 
 double Block::get_last_erase_time(void) const
 {
-	return last_erase_time;
+	return store.last_erase_time[index];
 }
 
 ssd::ulong Block::get_erases_remaining(void) const
 {
-	return erases_remaining;
+	return store.erases_remaining[index];
 }
 
 ssd::uint Block::get_size(void) const
 {
-	return size;
+	return store.get_block_size();
 }
 
 void Block::invalidate_page(uint page)
 {
-	assert(page < size);
-	if (data[page].get_state() == INVALID )
+	assert(page < get_size());
+	if (store.get_page_state(index, page) == INVALID )
 		return;
 
-	//assert(data[page].get_state() == VALID);
+	//assert(store.get_page_state(index, page) == VALID);
 
-	data[page].set_state(INVALID);
+	store.set_page_state(index, page, INVALID);
 
-	pages_invalid++;
+	uint pages_invalid = ++store.pages_invalid[index];
+	uint pages_valid = store.pages_valid[index];
 
-	Block_manager::instance()->update_block(this);
+	manager.update_block(this);
 
 	/* update block state */
-	if(pages_invalid >= size)
-		state = INACTIVE;
+	if(pages_invalid >= get_size())
+		store.block_state[index] = INACTIVE;
 	else if(pages_valid > 0 || pages_invalid > 0)
-		state = ACTIVE;
+		store.block_state[index] = ACTIVE;
 	else
-		state = FREE;
+		store.block_state[index] = FREE;
 
 	return;
 }
 
 double Block::get_modification_time(void) const
 {
-	return modification_time;
+	return store.modification_time[index];
 }
 
 /* method to find the next usable (empty) page in this block
  * method is called by write and erase methods and in Plane::get_next_page() */
 enum status Block::get_next_page(Address &address) const
 {
-	uint i;
+	uint page;
 
-	for(i = 0; i < size; i++)
+	if(store.find_empty_page(index, page) == SUCCESS)
 	{
-		if(data[i].get_state() == EMPTY)
-		{
-			address.set_linear_address(i + physical_address - physical_address % BLOCK_SIZE, PAGE);
-			return SUCCESS;
-		}
+		address.set_linear_address(page + physical_address - physical_address % BLOCK_SIZE, PAGE);
+		return SUCCESS;
 	}
 	return FAILURE;
 }
@@ -269,10 +234,10 @@ Block *Block::get_pointer(void)
 
 block_type Block::get_block_type(void) const
 {
-	return this->btype;
+	return (block_type) store.block_type[index];
 }
 
 void Block::set_block_type(block_type value)
 {
-	this->btype = value;
+	store.block_type[index] = value;
 }
@@ -18,7 +18,7 @@
 using namespace ssd;
 
 
-Block_manager::Block_manager(FtlParent *ftl) : ftl(ftl)
+Block_manager::Block_manager(FtlParent *ftl) : ftl(ftl), gc_policy(Gc_policy::create(active_cost))
 {
 	/*
 	 * Configuration of blocks.
@@ -44,60 +44,231 @@ Block_manager::Block_manager(FtlParent *ftl) : ftl(ftl)
 	current_writing_block = -2;
 
 	out_of_blocks = false;
+	collecting = false;
 
-	simpleCurrentFree = 0;
-	active_cost.reserve(NUMBER_OF_ADDRESSABLE_BLOCKS);
+	/*
+	 * A pool per die spans the blocks of its planes, which are consecutive
+	 * in the linear address.
+	 */
+	if (BLOCK_ALLOCATION > 2)
+	{
+		fprintf(stderr, "Block_manager error: %s: unknown BLOCK_ALLOCATION %u\n", __func__, BLOCK_ALLOCATION);
+		exit(FILE_ERR);
+	}
+	pool_span = max_blocks;
+	if (BLOCK_ALLOCATION != 0)
+		pool_span = DIE_SIZE * PLANE_SIZE;
+	num_pools = (max_blocks + pool_span - 1) / pool_span;
+
+	for (uint i = 0; i < num_pools; i++)
+		pool_unused.push_back(i * pool_span);
+	free_pools.resize(num_pools);
+	write_points.resize(num_pools);
+	write_members.assign(num_pools, 0);
+	last_pool = num_pools - 1;
+
+	num_unused = max_blocks;
+	num_erased = 0;
 }
 
 Block_manager::~Block_manager(void)
 {
+	delete gc_policy;
 	return;
 }
 
+/*
+ * Only the blocks the FTL addresses are collected, the other stripe units of
+ * a superblock follow them (see Controller::translate_address).
+ */
 void Block_manager::cost_insert(Block *b)
 {
-	active_cost.push_back(b);
+	if ((ulong) b->get_physical_address() < max_blocks * BLOCK_SIZE)
+		active_cost.insert(b);
 }
 
-void Block_manager::instance_initialize(FtlParent *ftl)
+uint Block_manager::get_pool(const Block *block) const
 {
-	Block_manager::inst = new Block_manager(ftl);
+	return block->get_physical_address() / BLOCK_SIZE / pool_span;
 }
 
-Block_manager *Block_manager::instance()
+/*
+ * Block of the index-th unused block of the pool order. Multi-plane sets take
+ * the blocks of a die at the same offset in each plane, so the planes
+ * alternate in this order, block offset by block offset.
+ */
+ulong Block_manager::unused_block(ulong index) const
+{
+	ulong die_blocks = DIE_SIZE * PLANE_SIZE;
+	ulong die = index / die_blocks;
+	if (MULTI_PLANE <= 1 || (die + 1) * die_blocks > max_blocks)
+		return index;
+	ulong offset = index % die_blocks;
+	return die * die_blocks + offset % DIE_SIZE * PLANE_SIZE + offset / DIE_SIZE;
+}
+
+bool Block_manager::pool_is_empty(uint pool) const
 {
-	return Block_manager::inst;
+	ulong end = std::min((pool + 1) * pool_span, max_blocks);
+	return pool_unused[pool] == end && free_pools[pool].empty();
 }
 
 /*
- * Retrieves a page using either simple approach (when not all
- * pages have been written or the complex that retrieves
- * it from a free page list.
+ * Pool of the next block or host write. Round-robin takes the dies in turn,
+ * least busy the die that can start a command first, as late as its channel
+ * or the die itself is ready. Dies that are ready before the event are
+ * equally idle and taken in turn.
  */
-void Block_manager::get_page_block(Address &address, Event &event)
+uint Block_manager::next_pool(Event &event)
 {
-	// We need separate queues for each plane? communication channel? communication channel is at the per die level at the moment. i.e. each LUN is a die.
+	if (num_pools == 1)
+		return 0;
 
-	if (simpleCurrentFree < max_blocks*BLOCK_SIZE)
+	uint pool = (last_pool + 1) % num_pools;
+	if (BLOCK_ALLOCATION == 2)
 	{
-		address.set_linear_address(simpleCurrentFree, BLOCK);
-		current_writing_block = simpleCurrentFree;
-		simpleCurrentFree += BLOCK_SIZE;
-	}
-	else
-	{
-		if (free_list.size() <= 1 && !out_of_blocks)
+		double now = event.get_start_time() + event.get_time_taken();
+		double best = 0.0;
+		for (uint i = 0; i < num_pools; i++)
 		{
-			out_of_blocks = true;
-			insert_events(event);
+			uint candidate = (last_pool + 1 + i) % num_pools;
+			Address die = Address(candidate * pool_span * BLOCK_SIZE, DIE);
+			double ready = std::max(ftl->controller.get_ready_time(die), now);
+			if (i == 0 || ready < best)
+			{
+				pool = candidate;
+				best = ready;
+			}
 		}
+	}
+	last_pool = pool;
+	return pool;
+}
+
+/*
+ * Retrieves a block from a pool, the next pool that has one when it ran out.
+ * Garbage is collected when only the last erased block is left.
+ */
+void Block_manager::get_page_block(Address &address, Event &event, uint pool)
+{
+	if (num_unused == 0 && num_erased <= 1 && !out_of_blocks)
+	{
+		out_of_blocks = true;
+		insert_events(event);
+	}
+
+	for (uint i = 0; i < num_pools && pool_is_empty(pool); i++)
+		pool = (pool + 1) % num_pools;
+	if (pool_is_empty(pool))
+	{
+		fprintf(stderr, "Block_manager error: %s: out of free blocks, garbage collection cannot keep up\n", __func__);
+		exit(MEM_ERR);
+	}
 
-		assert(free_list.size() != 0);
-		address.set_linear_address(free_list.front()->get_physical_address(), BLOCK);
-		current_writing_block = free_list.front()->get_physical_address();
-		free_list.erase(free_list.begin());
+	Block *block;
+	if (pool_unused[pool] < std::min((pool + 1) * pool_span, max_blocks))
+	{
+		block = active_cost.get_block(unused_block(pool_unused[pool]++));
+		num_unused--;
+	}
+	else
+	{
+		block = free_pools[pool].front();
+		free_pools[pool].pop_front();
+		num_erased--;
 		out_of_blocks = false;
 	}
+
+	address.set_linear_address(block->get_physical_address(), BLOCK);
+	current_writing_block = block->get_physical_address();
+	gc_policy->allocated(block);
+}
+
+void Block_manager::release(Block *block)
+{
+	free_pools[get_pool(block)].push_back(block);
+	num_erased++;
+}
+
+/*
+ * Takes the block at the offset of address in another plane of its die if it
+ * is free, the next unused block of its pool or an erased one. Like the
+ * trigger in insert_events, it leaves GC_BLOCKS free blocks for garbage
+ * collection to copy into.
+ */
+bool Block_manager::get_plane_block(Address &address, uint plane)
+{
+	ulong index = address.get_linear_address() / BLOCK_SIZE - address.plane * PLANE_SIZE + plane * PLANE_SIZE;
+	if (index >= max_blocks || get_num_free_blocks() <= (int)GC_BLOCKS)
+		return false;
+
+	uint pool = index / pool_span;
+	Block *block = active_cost.get_block(index);
+	std::deque<Block*> &erased = free_pools[pool];
+	if (pool_unused[pool] < std::min((pool + 1) * pool_span, max_blocks) && unused_block(pool_unused[pool]) == index)
+	{
+		pool_unused[pool]++;
+		num_unused--;
+	}
+	else
+	{
+		std::deque<Block*>::iterator it = std::find(erased.begin(), erased.end(), block);
+		if (it == erased.end())
+			return false;
+		erased.erase(it);
+		num_erased--;
+	}
+
+	address.set_linear_address(block->get_physical_address(), BLOCK);
+	current_writing_block = block->get_physical_address();
+	gc_policy->allocated(block);
+	return true;
+}
+
+/*
+ * Opens the blocks of a pool for host writes, one block or with MULTI_PLANE
+ * a set of blocks at the same offset in up to MULTI_PLANE planes of a die,
+ * as many as are free. Opening blocks first lets garbage be collected.
+ */
+void Block_manager::open_write_blocks(Event &event, uint pool)
+{
+	insert_events(event);
+
+	std::vector<long> &points = write_points[pool];
+	points.clear();
+	Address address;
+	get_page_block(address, event, pool);
+	points.push_back(address.get_linear_address());
+
+	for (uint plane = 0; plane < DIE_SIZE && points.size() < MULTI_PLANE; plane++)
+	{
+		Address sibling = address;
+		if (plane != address.plane && get_plane_block(sibling, plane))
+			points.push_back(sibling.get_linear_address());
+	}
+
+	for (uint i = 0; i < points.size(); i++)
+	{
+		ftl->controller.get_block_pointer(Address(points[i], BLOCK))->set_block_type(DATA);
+		data_active++;
+	}
+}
+
+/*
+ * Next page of the open blocks of a pool for a host write. A multi-plane set
+ * is written a page offset at a time across its planes, so consecutive
+ * writes to the die can run as multi-plane operations (see Die::multi_plane).
+ */
+long Block_manager::get_free_page(Event &event)
+{
+	uint pool = next_pool(event);
+	std::vector<long> &points = write_points[pool];
+	uint &member = write_members[pool];
+	if (member == 0 && (points.empty() || points[0] % BLOCK_SIZE == 0))
+		open_write_blocks(event, pool);
+	long page = points[member]++;
+	member = (member + 1) % points.size();
+	return page;
 }
 
 
@@ -139,9 +310,10 @@ void Block_manager::print_statistics()
 	printf("-----------------\n");
 	printf("Log blocks:  %lu\n", log_active);
 	printf("Data blocks: %lu\n", data_active);
-	printf("Free blocks: %lu\n", (max_blocks - (simpleCurrentFree/BLOCK_SIZE)) + free_list.size());
+	printf("Free blocks: %lu\n", num_unused + num_erased);
 	printf("Invalid blocks: %lu\n", invalid_list.size());
-	printf("Free2 blocks: %lu\n", (unsigned long int)invalid_list.size() + (unsigned long int)log_active + (unsigned long int)data_active - (unsigned long int)free_list.size());
+	printf("Free2 blocks: %lu\n", (unsigned long int)invalid_list.size() + (unsigned long int)log_active + (unsigned long int)data_active - num_erased);
+	printf("GC policy: %s\n", gc_policy->name());
 	printf("-----------------\n");
 
 
@@ -164,24 +336,66 @@ void Block_manager::invalidate(Address address, block_type type)
 	}
 }
 
+/*
+ * Let the FTL move the valid pages of a victim and erase it.
+ */
+void Block_manager::collect(Event &event, Block *victim)
+{
+	Stats &stats = ftl->controller.stats;
+	uint copies = BLOCK_SIZE - victim->get_pages_invalid();
+
+	// Let the FTL handle cleanup of the block.
+	ftl->cleanup_block(event, victim);
+
+	// Create erase event and attach to current event queue.
+	Event erase_event = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
+	erase_event.set_address(Address(victim->get_physical_address(), BLOCK));
+
+	// Execute erase
+	if (ftl->controller.issue(erase_event) == FAILURE) { assert(false);	}
+	release(victim);
+	gc_policy->erased(victim);
+
+	event.join(erase_event);
+
+	stats.numFTLErase++;
+	stats.numGCRead += copies;
+	stats.numGCWrite += copies;
+	stats.numGCErase++;
+}
+
 /*
  * Insert erase events into the event stream.
  * The strategy is to clean up all invalid pages instantly.
  */
 void Block_manager::insert_events(Event &event)
 {
+	// The blocks the copies of a collection take must not start another
+	// one, it could pick the victim being cleaned.
+	if (collecting)
+		return;
+
 	// Calculate if GC should be activated.
 
-	float used = (int)invalid_list.size() + (int)log_active + (int)data_active - (int)free_list.size();
+	float used = (int)invalid_list.size() + (int)log_active + (int)data_active - (int)num_erased;
 	float total = NUMBER_OF_ADDRESSABLE_BLOCKS;
 	float ratio = used/total;
+
+	// The page FTL and DFTL take the blocks for the copies of a collection
+	// from the free pools, so they also collect once the free blocks are down
+	// to GC_BLOCKS. Below GC_BLOCKS / (1 - GC_THRESHOLD) blocks the threshold
+	// would leave fewer free blocks than a run may need.
+	bool reserve = FTL_IMPLEMENTATION == IMPL_PAGE || FTL_IMPLEMENTATION == IMPL_DFTL;
 	
-	// printf("data: %d free: %d total: %d ratio: %f\n", invalid_list.size(), log_active, data_active, free_list.size(), NUMBER_OF_ADDRESSABLE_BLOCKS, ratio);
-	if (ratio < 0.90) // Magic number
+	// printf("data: %d free: %d total: %d ratio: %f\n", invalid_list.size(), log_active, data_active, num_erased, NUMBER_OF_ADDRESSABLE_BLOCKS, ratio);
+	if (ratio < GC_THRESHOLD && (!reserve || get_num_free_blocks() > (int)GC_BLOCKS))
 		return;
 
 	//print_statistics();
-	uint num_to_erase = 5; // More Magic!
+	uint num_to_erase = GC_BLOCKS;
+	double time_taken = event.get_time_taken();
+	ftl->controller.stats.numGCRuns++;
+	collecting = true;
 
 	//printf("%i %i %i\n", invalid_list.size(), log_active, data_active);
 
@@ -191,9 +405,9 @@ void Block_manager::insert_events(Event &event)
 		Event erase_event = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
 		erase_event.set_address(Address(invalid_list.back()->get_physical_address(), BLOCK));
 		if (ftl->controller.issue(erase_event) == FAILURE) {	assert(false);}
-		event.incr_time_taken(erase_event.get_time_taken());
+		event.join(erase_event);
 
-		free_list.push_back(invalid_list.back());
+		release(invalid_list.back());
 		invalid_list.pop_back();
 		//printf("erase success\n");
 		num_to_erase--;
@@ -202,59 +416,43 @@ void Block_manager::insert_events(Event &event)
 	
 	num_insert_events++;
 
-	if (FTL_IMPLEMENTATION == IMPL_DFTL || FTL_IMPLEMENTATION == IMPL_BIMODAL || FTL_IMPLEMENTATION == IMPL_AMT)
+	if (FTL_IMPLEMENTATION == IMPL_PAGE || FTL_IMPLEMENTATION == IMPL_DFTL || FTL_IMPLEMENTATION == IMPL_BIMODAL || FTL_IMPLEMENTATION == IMPL_AMT)
 	{
-		ActiveByCost::iterator it = active_cost.get<1>().end();
-		--it;
-		while (num_to_erase != 0 && (*it)->get_pages_invalid() > 0 && (*it)->get_pages_valid() == BLOCK_SIZE)
+		// The copies of a victim fill at most one new block before it is
+		// erased, a reserving run stops when none is left for them.
+		Block *victim;
+		while (num_to_erase != 0 && (!reserve || get_num_free_blocks() != 0) && (victim = gc_policy->victim(current_writing_block, event.get_start_time())) != NULL)
 		{
-			if (current_writing_block != (*it)->physical_address)
-			{
-				//printf("erase p: %p phy: %li ratio: %i num: %i\n", (*it), (*it)->physical_address, (*it)->get_pages_invalid(), num_to_erase);
-				Block *blockErase = (*it);
-				// Let the FTL handle cleanup of the block.
-				//printf("copy page: %d\n", BLOCK_SIZE - (*it)->get_pages_invalid());
-				ftl->cleanup_block(event, blockErase);
-				data_active--;
-				// Create erase event and attach to current event queue.
-				Event erase_event = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
-				erase_event.set_address(Address(blockErase->get_physical_address(), BLOCK));
-
-				// Execute erase
-				if (ftl->controller.issue(erase_event) == FAILURE) { assert(false);	}
-				free_list.push_back(blockErase);
-
-				event.incr_time_taken(erase_event.get_time_taken());
-
-				ftl->controller.stats.numFTLErase++;
-				
-			}
-
-			it = active_cost.get<1>().end();
-			--it;
-
-			if (current_writing_block == (*it)->physical_address)
-			 --it;
-
+			collect(event, victim);
+			data_active--;
 			num_to_erase--;
 		}
 	}
+
+	collecting = false;
+	ftl->controller.stats.sumGCLatency += event.get_time_taken() - time_taken;
 	//print_statistics();
 	return;
 }
 
 void Block_manager::insert_events_AMT(Event &event, int freePage)
 {
+	if (collecting)
+		return;
+
 	// Calculate if GC should be activated.
 	float total = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
 	float used = total - freePage;
 	float ratio = used/total;
 	
-	if (ratio < 0.90) // Magic number
+	if (ratio < GC_THRESHOLD)
 		return;
 
 	//print_statistics();
-	uint num_to_erase = 5; // More Magic!
+	uint num_to_erase = GC_BLOCKS;
+	double time_taken = event.get_time_taken();
+	ftl->controller.stats.numGCRuns++;
+	collecting = true;
 
 	//printf("%i %i %i\n", invalid_list.size(), log_active, data_active);
 
@@ -263,41 +461,27 @@ void Block_manager::insert_events_AMT(Event &event, int freePage)
 	num_insert_events++;
 	for(uint i = 0; i <= BLOCK_SIZE; i++) {
 		if(num_to_erase) {
-			ActiveByCost::iterator it = active_cost.get<1>().end();
-			--it;
-			while (num_to_erase != 0 && BLOCK_SIZE - (*it)->get_pages_invalid() == i && (*it)->get_pages_valid() == BLOCK_SIZE)
+			Block *it = active_cost.last();
+			while (num_to_erase != 0 && it != NULL && BLOCK_SIZE - it->get_pages_invalid() == i && it->get_pages_valid() == BLOCK_SIZE)
 			{
-				if (current_writing_block != (*it)->physical_address)
+				if (current_writing_block != it->physical_address)
 				{
-					// printf("erase p: %p phy: %li ratio: %i num: %i\n", (*it), (*it)->physical_address, (*it)->get_pages_invalid(), num_to_erase);
-					Block *blockErase = (*it);
-					// Let the FTL handle cleanup of the block.
-					// printf("copy page: %d\n", BLOCK_SIZE - (*it)->get_pages_invalid());
-					ftl->cleanup_block(event, blockErase);
-					// Create erase event and attach to current event queue.
-					Event erase_event = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
-					erase_event.set_address(Address(blockErase->get_physical_address(), BLOCK));
-
-					// Execute erase
-					if (ftl->controller.issue(erase_event) == FAILURE) { assert(false);	}
-					free_list.push_back(blockErase);
-
-					event.incr_time_taken(erase_event.get_time_taken());
-
-					ftl->controller.stats.numFTLErase++;
-					
+					// printf("erase p: %p phy: %li ratio: %i num: %i\n", it, it->physical_address, it->get_pages_invalid(), num_to_erase);
+					// printf("copy page: %d\n", BLOCK_SIZE - it->get_pages_invalid());
+					collect(event, it);
 				}
 
-				it = active_cost.get<1>().end();
-				--it;
+				it = active_cost.last();
 
-				if (current_writing_block == (*it)->physical_address)
-				--it;
+				if (current_writing_block == it->physical_address)
+					it = active_cost.previous(it);
 
 				num_to_erase--;
 			}
 		}
 	}
+	collecting = false;
+	ftl->controller.stats.sumGCLatency += event.get_time_taken() - time_taken;
 	//print_statistics();
 	return;
 }
@@ -305,7 +489,7 @@ void Block_manager::insert_events_AMT(Event &event, int freePage)
 Address Block_manager::get_free_block(block_type type, Event &event)
 {
 	Address address;
-	get_page_block(address, event);
+	get_page_block(address, event, next_pool(event));
 	switch (type)
 	{
 	case DATA:
@@ -329,23 +513,22 @@ Address Block_manager::get_free_block(block_type type, Event &event)
 void Block_manager::print_cost_status()
 {
 
-	ActiveByCost::iterator it = active_cost.get<1>().begin();
+	Block *it = active_cost.first();
 
-	for (uint i=0;i<10;i++) //SSD_SIZE*PACKAGE_SIZE*DIE_SIZE*PLANE_SIZE
+	for (uint i=0;i<10 && it != NULL;i++) //SSD_SIZE*PACKAGE_SIZE*DIE_SIZE*PLANE_SIZE
 	{
-		printf("%li %i %i\n", (*it)->physical_address, (*it)->get_pages_valid(), (*it)->get_pages_invalid());
-		++it;
+		printf("%li %i %i\n", it->physical_address, it->get_pages_valid(), it->get_pages_invalid());
+		it = active_cost.next(it);
 	}
 
 	printf("end:::\n");
 
-	it = active_cost.get<1>().end();
-	--it;
+	it = active_cost.last();
 
-	for (uint i=0;i<10;i++) //SSD_SIZE*PACKAGE_SIZE*DIE_SIZE*PLANE_SIZE
+	for (uint i=0;i<10 && it != NULL;i++) //SSD_SIZE*PACKAGE_SIZE*DIE_SIZE*PLANE_SIZE
 	{
-		printf("%li %i %i\n", (*it)->physical_address, (*it)->get_pages_valid(), (*it)->get_pages_invalid());
-		--it;
+		printf("%li %i %i\n", it->physical_address, it->get_pages_valid(), it->get_pages_invalid());
+		it = active_cost.previous(it);
 	}
 }
 
@@ -356,7 +539,7 @@ void Block_manager::erase_and_invalidate(Event &event, Address &address, block_t
 
 	if (ftl->controller.issue(erase_event) == FAILURE) { assert(false);}
 
-	free_list.push_back(ftl->get_block_pointer(address));
+	release(ftl->get_block_pointer(address));
 
 	switch (btype)
 	{
@@ -370,20 +553,49 @@ void Block_manager::erase_and_invalidate(Event &event, Address &address, block_t
 		break;
 	}
 
-	event.incr_time_taken(erase_event.get_time_taken());
+	event.join(erase_event);
 	ftl->controller.stats.numFTLErase++;
 }
 
 int Block_manager::get_num_free_blocks()
 {
-	if (simpleCurrentFree < max_blocks*BLOCK_SIZE)
-		return (simpleCurrentFree / BLOCK_SIZE) + free_list.size();
-	else
-		return free_list.size();
+	return num_unused + num_erased;
 }
 
 void Block_manager::update_block(Block * b)
 {
-	std::size_t pos = (b->physical_address / BLOCK_SIZE);
-	active_cost.replace(active_cost.begin()+pos, b);
+	if ((ulong) b->get_physical_address() < max_blocks * BLOCK_SIZE)
+		active_cost.update(b);
+}
+
+/* the limits are derived from the configuration and are not saved */
+void Block_manager::snapshot(Snapshot &snapshot)
+{
+	snapshot.section("blocks");
+	snapshot.io(data_active);
+	snapshot.io(log_active);
+	snapshot.io(logseq_active);
+	snapshot.io(directoryCurrentPage);
+	snapshot.io(directoryCachedPage);
+	snapshot.io(num_insert_events);
+	snapshot.io(current_writing_block);
+	snapshot.io(inited);
+	snapshot.io(out_of_blocks);
+	snapshot.io_blocks(active_list, *ftl);
+	snapshot.io_vector(pool_unused);
+	for (uint i = 0; i < num_pools; i++)
+		snapshot.io_vector(write_points[i]);
+	snapshot.io_vector(write_members);
+	snapshot.io(last_pool);
+	snapshot.io(num_unused);
+	snapshot.io(num_erased);
+	for (uint i = 0; i < num_pools; i++)
+	{
+		std::vector<Block*> blocks(free_pools[i].begin(), free_pools[i].end());
+		snapshot.io_blocks(blocks, *ftl);
+		free_pools[i].assign(blocks.begin(), blocks.end());
+	}
+	snapshot.io_blocks(invalid_list, *ftl);
+	active_cost.snapshot(snapshot);
+	gc_policy->snapshot(snapshot);
 }
@@ -132,3 +132,11 @@ double Bus::ready_time(uint channel)
 	assert(channels != NULL && channel < num_channels);
 	return channels[channel].ready_time();
 }
+
+void Bus::snapshot(Snapshot &snapshot)
+{
+	snapshot.section("bus");
+	for(uint i = 0; i < num_channels; i++)
+		channels[i].snapshot(snapshot);
+	return;
+}
@@ -36,6 +36,7 @@
 #include <stdio.h>
 #include <algorithm>
 #include <stdexcept>
+#include <limits>
 #include "ssd.h"
 
 using namespace ssd;
@@ -50,8 +51,12 @@ using namespace ssd;
 Channel::Channel(double ctrl_delay, double data_delay, uint table_size, uint max_connections):
 	//table_size(table_size),
 
-	/* use a const pointer (double * const) for the scheduling table arrays
-	 * like a reference, we cannot reseat the pointer */
+	/* empty schedule table */
+	root(-1),
+
+	/* any non-zero seed works for the xorshift treap priorities */
+	seed(2463534242u),
+
 	table_entries(0),
 	selected_entry(0),
 	num_connected(0),
@@ -69,6 +74,7 @@ Channel::Channel(double ctrl_delay, double data_delay, uint table_size, uint max
 	}
 
 	timings.reserve(4096);
+	free_slots.reserve(4096);
 
 	ready_at = -1;
 }
@@ -128,88 +134,207 @@ enum status Channel::lock(double start_time, double duration, Event &event)
 	assert(start_time >= 0.0);
 	assert(duration >= 0.0);
 
-	/* free up any table slots and sort existing ones */
+	/* free up any table slots */
 	unlock(start_time);
 
-	double sched_time = BUS_CHANNEL_FREE_FLAG;
+	double sched_time = first_fit(start_time, duration);
+
+	/* write scheduling info in a free table entry, keeping lock_time order */
+	int left;
+	int right;
+	split_lock(root, sched_time, left, right);
+	root = merge_entries(merge_entries(left, new_entry(sched_time, sched_time + duration)), right);
 
+	if (sched_time + duration > ready_at)
+		ready_at = sched_time + duration;
+
+	/* update event times for bus wait and time taken */
+	event.incr_bus_wait_time(sched_time - start_time);
+	event.incr_time_taken(sched_time - start_time + duration);
+
+	return SUCCESS;
+}
+
+/* remove all expired entries (finish time is not after provided time)
+ * entries never overlap, so the expired entries are the ones at the front of
+ * 	the table and one split removes them all */
+void Channel::unlock(double start_time)
+{
+	int expired;
+	split_expired(root, start_time, expired, root);
+	free_entries(expired);
+}
+
+/* find the time a lock of the given duration can start
+ * 	before the first entry in the table if the gap up to it is long enough
+ * 	else at the end of the first entry that is followed by a long enough gap
+ * 	else after all entries in the table
+ * this is the order a scan of the sorted table would try the gaps in, the
+ * 	gap augmentation only lets us skip subtrees that have no fitting gap */
+double Channel::first_fit(double start_time, double duration) const
+{
 	/* just schedule if table is empty */
-	if(timings.size() == 0)
-		sched_time = start_time;
+	if(root == -1)
+		return start_time;
 
-	/* check if can schedule before or in between before just scheduling
-	 * after all other events */
-	else
-	{
-		/* skip over empty table entries
-		 * empty table entries will be first from sorting (in unlock method)
-		 * because the flag is a negative value */
-		std::vector<lock_times>::iterator it = timings.begin();
+	const lock_times *cur = &timings[root];
+
+	/* schedule before first event in table */
+	if(cur -> first_lock > start_time && cur -> first_lock - start_time >= duration)
+		return start_time;
 
-		/* schedule before first event in table */
-		if((*it).lock_time > start_time && (*it).lock_time - start_time >= duration)
-			sched_time = start_time;
+	/* schedule after all events in table */
+	if(cur -> max_gap < duration)
+		return cur -> last_unlock;
 
-		/* schedule in between other events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
+	/* schedule in between other events in table */
+	for(;;)
+	{
+		const lock_times *left = cur -> left == -1 ? NULL : &timings[cur -> left];
+		const lock_times *right = cur -> right == -1 ? NULL : &timings[cur -> right];
+
+		if(left != NULL && left -> max_gap >= duration)
+			cur = left;
+		else if(left != NULL && cur -> lock_time - left -> last_unlock >= duration)
+			return left -> last_unlock;
+		else if(right != NULL && right -> first_lock - cur -> unlock_time >= duration)
+			return cur -> unlock_time;
+		else
 		{
-			for(; it < timings.end(); it++)
-			{
-				if (it + 1 != timings.end())
-				{
-					/* enough time to schedule in between next two events */
-					if((*it).unlock_time >= start_time  && (*(it+1)).lock_time - (*it).unlock_time >= duration)
-					{
-						sched_time = (*it).unlock_time;
-						break;
-					}
-				}
-
-			}
+			assert(right != NULL && right -> max_gap >= duration);
+			cur = right;
 		}
+	}
+}
 
-		/* schedule after all events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
-			sched_time = timings.back().unlock_time;
+/* take a table entry from the free slots or grow the table */
+int Channel::new_entry(double lock_time, double unlock_time)
+{
+	int entry;
+	if(free_slots.size() > 0)
+	{
+		entry = free_slots.back();
+		free_slots.pop_back();
+	}
+	else
+	{
+		entry = timings.size();
+		timings.push_back(lock_times());
 	}
 
-	/* write scheduling info in free table slot */
-	lock_times lt;
-	lt.lock_time = sched_time;
-	lt.unlock_time = sched_time + duration;
-	timings.push_back(lt);
+	/* xorshift32 */
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	lock_times &lt = timings[entry];
+	lt.lock_time = lock_time;
+	lt.unlock_time = unlock_time;
+	lt.priority = seed;
+	lt.left = -1;
+	lt.right = -1;
+	update_entry(entry);
+	table_entries++;
+	return entry;
+}
 
-	if (lt.unlock_time > ready_at)
-		ready_at = lt.unlock_time;
+/* recompute the subtree summary of an entry from its children */
+void Channel::update_entry(int entry)
+{
+	lock_times &lt = timings[entry];
+	lt.first_lock = lt.lock_time;
+	lt.last_unlock = lt.unlock_time;
+	lt.max_gap = -std::numeric_limits<double>::infinity();
+	if(lt.left != -1)
+	{
+		const lock_times &left = timings[lt.left];
+		lt.first_lock = left.first_lock;
+		lt.max_gap = std::max(left.max_gap, lt.lock_time - left.last_unlock);
+	}
+	if(lt.right != -1)
+	{
+		const lock_times &right = timings[lt.right];
+		lt.last_unlock = right.last_unlock;
+		lt.max_gap = std::max(lt.max_gap, std::max(right.max_gap, right.first_lock - lt.unlock_time));
+	}
+}
 
-	/* update event times for bus wait and time taken */
-	event.incr_bus_wait_time(sched_time - start_time);
-	event.incr_time_taken(sched_time - start_time + duration);
+/* split into entries locking before lock_time and the rest */
+void Channel::split_lock(int entry, double lock_time, int &left, int &right)
+{
+	if(entry == -1)
+	{
+		left = right = -1;
+		return;
+	}
+	if(timings[entry].lock_time < lock_time)
+	{
+		split_lock(timings[entry].right, lock_time, timings[entry].right, right);
+		left = entry;
+	}
+	else
+	{
+		split_lock(timings[entry].left, lock_time, left, timings[entry].left);
+		right = entry;
+	}
+	update_entry(entry);
+}
 
-	return SUCCESS;
+/* split into entries that unlock by current_time and the rest */
+void Channel::split_expired(int entry, double current_time, int &left, int &right)
+{
+	if(entry == -1)
+	{
+		left = right = -1;
+		return;
+	}
+	if(timings[entry].unlock_time <= current_time)
+	{
+		split_expired(timings[entry].right, current_time, timings[entry].right, right);
+		left = entry;
+	}
+	else
+	{
+		split_expired(timings[entry].left, current_time, left, timings[entry].left);
+		right = entry;
+	}
+	update_entry(entry);
 }
 
-/* remove all expired entries (finish time is less than provided time)
- * update current number of table entries used
- * sort table by finish times (2nd row) */
-void Channel::unlock(double start_time)
+/* every entry of left must lock before every entry of right */
+int Channel::merge_entries(int left, int right)
 {
-	/* remove expired channel lock entries */
-	std::vector<lock_times>::iterator it;
-	for ( it = timings.begin(); it < timings.end();)
+	if(left == -1)
+		return right;
+	if(right == -1)
+		return left;
+	if(timings[left].priority > timings[right].priority)
 	{
-		if((*it).unlock_time <= start_time)
-			timings.erase(it);
-		else
-		{
-			it++;
-		}
+		int merged = merge_entries(timings[left].right, right);
+		timings[left].right = merged;
+		update_entry(left);
+		return left;
 	}
-	std::sort(timings.begin(), timings.end(), &timings_sorter);
+	int merged = merge_entries(left, timings[right].left);
+	timings[right].left = merged;
+	update_entry(right);
+	return right;
 }
 
-bool Channel::timings_sorter(lock_times const& lhs, lock_times const& rhs) {
-    return lhs.lock_time < rhs.lock_time;
+/* return a subtree to the free slots */
+void Channel::free_entries(int entry)
+{
+	if(entry == -1)
+		return;
+	free_entries(timings[entry].left);
+	free_entries(timings[entry].right);
+	free_slots.push_back(entry);
+	table_entries--;
+}
+
+uint Channel::get_table_entries(void) const
+{
+	return table_entries;
 }
 
 double Channel::ready_time(void)
@@ -217,3 +342,16 @@ double Channel::ready_time(void)
 	return ready_at;
 }
 
+
+/* the schedule table is copied as is, entries link to each other by index */
+void Channel::snapshot(Snapshot &snapshot)
+{
+	snapshot.io_vector(timings);
+	snapshot.io_vector(free_slots);
+	snapshot.io(root);
+	snapshot.io(seed);
+	snapshot.io(table_entries);
+	snapshot.io(selected_entry);
+	snapshot.io(ready_at);
+	return;
+}
@@ -33,22 +33,12 @@
 #include <stdio.h>
 #include <string.h>
 
-/* using namespace ssd; */
-namespace ssd {
-
-/* Define typedefs and error macros from ssd.h here instead of including
- * header file because we want to declare the global configuration variables
- * and set them in this file.  ssd.h declares the global configuration
- * variables as extern const, which would conflict this file's definitions.
- * This is not the best solution, but it is easy and it works. */
-
-/* some obvious typedefs for laziness */
-typedef unsigned int uint;
-typedef unsigned long ulong;
+/* ssd.h declares the configuration variables as "extern const" for everyone
+ * else, this file defines them and sets them */
+#define SSD_CONFIG_DEFINITIONS
+#include "ssd.h"
 
-/* define exit codes for errors */
-#define MEM_ERR -1
-#define FILE_ERR -2
+namespace ssd {
 
 /* Simulator configuration
  * All configuration variables are set by reading ssd.conf and referenced with
@@ -57,12 +47,14 @@ typedef unsigned long ulong;
  * 	in case of config file error.  The values defined below are overwritten
  * 	when defined in the config file.
  * We do not want a class here because we want to use the configuration
- * 	variables in the same was as macros. */
+ * 	variables in the same was as macros.
+ * Every thread has its own copy of the variables, see the Config class for
+ * 	keeping a configuration with an Ssd. */
 
 /* Ram class:
  * 	delay to read from and write to the RAM for 1 page of data */
-double RAM_READ_DELAY = 0.00000001;
-double RAM_WRITE_DELAY = 0.00000001;
+thread_local double RAM_READ_DELAY = 0.00000001;
+thread_local double RAM_WRITE_DELAY = 0.00000001;
 
 /* Bus class:
  * 	delay to communicate over bus
@@ -71,87 +63,157 @@ double RAM_WRITE_DELAY = 0.00000001;
  * 	value used as a flag to indicate channel is free
  * 		(use a value not used as a delay value - e.g. -1.0)
  * 	number of simultaneous communication channels - defined by SSD_SIZE */
-double BUS_CTRL_DELAY = 0.000000005;
-double BUS_DATA_DELAY = 0.00000001;
-uint BUS_MAX_CONNECT = 8;
-uint BUS_TABLE_SIZE = 64;
-double BUS_CHANNEL_FREE_FLAG = -1.0;
+thread_local double BUS_CTRL_DELAY = 0.000000005;
+thread_local double BUS_DATA_DELAY = 0.00000001;
+thread_local uint BUS_MAX_CONNECT = 8;
+thread_local uint BUS_TABLE_SIZE = 64;
+thread_local double BUS_CHANNEL_FREE_FLAG = -1.0;
 /* uint BUS_CHANNELS = 4; same as # of Packages, defined by SSD_SIZE */
 
 /* Ssd class:
  * 	number of Packages per Ssd (size) */
-uint SSD_SIZE = 4;
+thread_local uint SSD_SIZE = 4;
 
 /* Package class:
  * 	number of Dies per Package (size) */
-uint PACKAGE_SIZE = 8;
+thread_local uint PACKAGE_SIZE = 8;
 
 /* Die class:
- * 	number of Planes per Die (size) */
-uint DIE_SIZE = 2;
+ * 	number of Planes per Die (size)
+ * 	most Planes a multi-plane command spans, 1 for none: reads, writes and
+ * 		erases to the same block and page offset in different Planes run
+ * 		their array operations together (see Die::multi_plane) and the
+ * 		host write points of the block manager open a block at the same
+ * 		offset in that many Planes of the Die */
+thread_local uint DIE_SIZE = 2;
+thread_local uint MULTI_PLANE = 1;
 
 /* Plane class:
  * 	number of Blocks per Plane (size)
  * 	delay for reading from plane register
  * 	delay for writing to plane register
  * 	delay for merging is based on read, write, reg_read, reg_write 
- * 		and does not need to be explicitly defined */
-uint PLANE_SIZE = 64;
-double PLANE_REG_READ_DELAY = 0.0000000001;
-double PLANE_REG_WRITE_DELAY = 0.0000000001;
+ * 		and does not need to be explicitly defined
+ * 	cache read: a read copies the page from the data register to the cache
+ * 		register (delay for reading from plane register), so the next
+ * 		read of the Plane runs while the page goes out on the bus
+ * 	cache program: a write copies the page from the cache register to the
+ * 		data register (delay for writing to plane register), so the next
+ * 		write to the Plane goes over the bus while the page is programmed */
+thread_local uint PLANE_SIZE = 64;
+thread_local double PLANE_REG_READ_DELAY = 0.0000000001;
+thread_local double PLANE_REG_WRITE_DELAY = 0.0000000001;
+thread_local bool PLANE_CACHE_READ = false;
+thread_local bool PLANE_CACHE_PROGRAM = false;
 
 /* Block class:
  * 	number of Pages per Block (size)
  * 	number of erases in lifetime of block
  * 	delay for erasing block */
-uint BLOCK_SIZE = 16;
-uint BLOCK_ERASES = 1048675;
-double BLOCK_ERASE_DELAY = 0.001;
+thread_local uint BLOCK_SIZE = 16;
+thread_local uint BLOCK_ERASES = 1048675;
+thread_local double BLOCK_ERASE_DELAY = 0.001;
 
 /* Page class:
  * 	delay for Page reads
  * 	delay for Page writes */
-double PAGE_READ_DELAY = 0.000001;
-double PAGE_WRITE_DELAY = 0.00001;
+thread_local double PAGE_READ_DELAY = 0.000001;
+thread_local double PAGE_WRITE_DELAY = 0.00001;
 
 /* Page data memory allocation
  *
  */
-uint PAGE_SIZE = 4096;
-bool PAGE_ENABLE_DATA = true;
-
-/*
- * Memory area to support pages with data.
- */
-void *page_data;
+thread_local uint PAGE_SIZE = 4096;
+thread_local bool PAGE_ENABLE_DATA = true;
 
 /*
  * Number of blocks to reserve for mappings. e.g. map directory in BAST.
  */
-uint MAP_DIRECTORY_SIZE = 0;
+thread_local uint MAP_DIRECTORY_SIZE = 0;
 
 /*
  * Implementation to use (0 -> Page, 1 -> BAST, 2 -> FAST, 3 -> DFTL, 4 -> BiModal, 5 -> AMT-FTL
  */
-uint FTL_IMPLEMENTATION = 0;
+thread_local uint FTL_IMPLEMENTATION = 0;
 
 /*
  * Limit of LOG pages (for use in BAST)
  */
-uint BAST_LOG_BLOCK_LIMIT = 100;
+thread_local uint BAST_LOG_BLOCK_LIMIT = 100;
+
+/*
+ * Log block BAST merges when it needs a new one and all are in use.
+ * 0 -> Random
+ * 1 -> FIFO, the oldest log block
+ * 2 -> LRU, the least recently written log block
+ */
+thread_local uint BAST_LOG_VICTIM = 0;
 
 
 /*
  * Limit of LOG pages (for use in FAST)
  */
-uint FAST_LOG_BLOCK_LIMIT = 4;
+thread_local uint FAST_LOG_BLOCK_LIMIT = 4;
 
 /*
  * Number of pages allowed to be in DFTL Cached Mapping Table.
  * (Size equals CACHE_BLOCK_LIMIT * block size * page size)
  *
  */
-uint CACHE_DFTL_LIMIT = 8;
+thread_local uint CACHE_DFTL_LIMIT = 8;
+
+/*
+ * Replacement policy of the DFTL Cached Mapping Table.
+ * 0 -> LRU
+ * 1 -> CLOCK
+ * 2 -> 2Q
+ * 3 -> ARC
+ * 4 -> S3-FIFO
+ * 5 -> TPFTL (grouped by translation page)
+ */
+thread_local uint CACHE_DFTL_POLICY = 0;
+
+/*
+ * Mappings past a sequential read miss that the DFTL family loads into the
+ * Cached Mapping Table from the translation page it reads anyway.
+ * 0 -> no prefetch
+ */
+thread_local uint CACHE_DFTL_PREFETCH = 0;
+
+/*
+ * Victim choice of the garbage collection of the block manager (page FTL,
+ * DFTL and BiModal) among the full blocks with invalid pages.
+ * 0 -> Greedy, the most invalid pages
+ * 1 -> Cost-benefit, the highest age * invalid / valid
+ * 2 -> CAT, the highest age * invalid / (valid * erases)
+ * 3 -> d-choices, the most invalid pages of GC_CHOICES random blocks
+ * 4 -> Windowed greedy, the most invalid pages of the GC_WINDOW oldest blocks
+ */
+thread_local uint GC_POLICY = 0;
+
+/*
+ * Fraction of the blocks in use from which the block manager collects
+ * garbage, and the number of blocks it collects each time.
+ */
+thread_local double GC_THRESHOLD = 0.90;
+thread_local uint GC_BLOCKS = 5;
+
+/*
+ * Blocks sampled by the d-choices policy and blocks in the window of the
+ * windowed greedy policy.
+ */
+thread_local uint GC_CHOICES = 8;
+thread_local uint GC_WINDOW = 64;
+
+/*
+ * Die the block manager takes the next free block from, and the open block
+ * the next host write of the page FTL goes to.
+ * 0 -> Linear, the blocks in address order and a single open block
+ * 1 -> Round-robin, an open block per die, the dies in turn
+ * 2 -> Least busy, an open block per die, the die whose channel and die are
+ *      ready first (ties in turn)
+ */
+thread_local uint BLOCK_ALLOCATION = 0;
 
 /*
  * Parallelism mode.
@@ -159,18 +221,24 @@ uint CACHE_DFTL_LIMIT = 8;
  * 1 -> Striping
  * 2 -> Logical Address Space Parallelism (LASP)
  */
-uint PARALLELISM_MODE = 0;
+thread_local uint PARALLELISM_MODE = 0;
 
 /* Virtual block size (as a multiple of the physical block size) */
-uint VIRTUAL_BLOCK_SIZE = 1;
+thread_local uint VIRTUAL_BLOCK_SIZE = 1;
 
-/* Virtual page size (as a multiple of the physical page size) */
-uint VIRTUAL_PAGE_SIZE = 1;
+/*
+ * Virtual page size (as a multiple of the physical page size). In striping
+ * mode each page the FTL addresses is a superpage of this many physical
+ * pages on different packages or dies, read and written in parallel, and
+ * each block a superblock erased as a unit. It must divide the number of
+ * dies, SSD_SIZE * PACKAGE_SIZE.
+ */
+thread_local uint VIRTUAL_PAGE_SIZE = 1;
 
-uint NUMBER_OF_ADDRESSABLE_BLOCKS = 0;
+thread_local uint NUMBER_OF_ADDRESSABLE_BLOCKS = 0;
 
 /* RAISSDs: Number of physical SSDs */
-uint RAID_NUMBER_OF_PHYSICAL_SSDS = 0;
+thread_local uint RAID_NUMBER_OF_PHYSICAL_SSDS = 0;
 
 void load_entry(char *name, double value, uint line_number) {
 	/* cheap implementation - go through all possibilities and match entry */
@@ -192,12 +260,18 @@ void load_entry(char *name, double value, uint line_number) {
 		PACKAGE_SIZE = (uint) value;
 	else if (!strcmp(name, "DIE_SIZE"))
 		DIE_SIZE = (uint) value;
+	else if (!strcmp(name, "MULTI_PLANE"))
+		MULTI_PLANE = (uint) value;
 	else if (!strcmp(name, "PLANE_SIZE"))
 		PLANE_SIZE = (uint) value;
 	else if (!strcmp(name, "PLANE_REG_READ_DELAY"))
 		PLANE_REG_READ_DELAY = value;
 	else if (!strcmp(name, "PLANE_REG_WRITE_DELAY"))
 		PLANE_REG_WRITE_DELAY = value;
+	else if (!strcmp(name, "PLANE_CACHE_READ"))
+		PLANE_CACHE_READ = (value == 1);
+	else if (!strcmp(name, "PLANE_CACHE_PROGRAM"))
+		PLANE_CACHE_PROGRAM = (value == 1);
 	else if (!strcmp(name, "BLOCK_SIZE"))
 		BLOCK_SIZE = (uint) value;
 	else if (!strcmp(name, "BLOCK_ERASES"))
@@ -220,10 +294,28 @@ void load_entry(char *name, double value, uint line_number) {
 		FTL_IMPLEMENTATION = value;
 	else if (!strcmp(name, "BAST_LOG_BLOCK_LIMIT"))
 		BAST_LOG_BLOCK_LIMIT = value;
+	else if (!strcmp(name, "BAST_LOG_VICTIM"))
+		BAST_LOG_VICTIM = value;
 	else if (!strcmp(name, "FAST_LOG_BLOCK_LIMIT"))
 		FAST_LOG_BLOCK_LIMIT = value;
 	else if (!strcmp(name, "CACHE_DFTL_LIMIT"))
 		CACHE_DFTL_LIMIT = value;
+	else if (!strcmp(name, "CACHE_DFTL_POLICY"))
+		CACHE_DFTL_POLICY = value;
+	else if (!strcmp(name, "CACHE_DFTL_PREFETCH"))
+		CACHE_DFTL_PREFETCH = value;
+	else if (!strcmp(name, "GC_POLICY"))
+		GC_POLICY = value;
+	else if (!strcmp(name, "GC_THRESHOLD"))
+		GC_THRESHOLD = value;
+	else if (!strcmp(name, "GC_BLOCKS"))
+		GC_BLOCKS = value;
+	else if (!strcmp(name, "GC_CHOICES"))
+		GC_CHOICES = value;
+	else if (!strcmp(name, "GC_WINDOW"))
+		GC_WINDOW = value;
+	else if (!strcmp(name, "BLOCK_ALLOCATION"))
+		BLOCK_ALLOCATION = value;
 	else if (!strcmp(name, "PARALLELISM_MODE"))
 		PARALLELISM_MODE = value;
 	else if (!strcmp(name, "VIRTUAL_BLOCK_SIZE"))
@@ -237,8 +329,7 @@ void load_entry(char *name, double value, uint line_number) {
 	return;
 }
 
-void load_config(void) {
-	const char * const config_name = "ssd.conf";
+void load_config(const char *config_name) {
 	FILE *config_file = NULL;
 
 	/* update sscanf line below with max name length (%s) if changing sizes */
@@ -271,6 +362,13 @@ void load_config(void) {
 	}
 	fclose(config_file);
 
+	/* the stripe units of a superpage must each take whole dies */
+	if (PARALLELISM_MODE == 1 && (VIRTUAL_PAGE_SIZE == 0 || (SSD_SIZE * PACKAGE_SIZE) % VIRTUAL_PAGE_SIZE != 0)) {
+		fprintf(stderr, "Config file %s: VIRTUAL_PAGE_SIZE %u does not divide the %u dies of the drive.  Exiting.\n",
+				config_name, VIRTUAL_PAGE_SIZE, SSD_SIZE * PACKAGE_SIZE);
+		exit(FILE_ERR);
+	}
+
 	NUMBER_OF_ADDRESSABLE_BLOCKS = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE) / VIRTUAL_PAGE_SIZE;
 
 	return;
@@ -288,9 +386,12 @@ void print_config(FILE *stream) {
 	fprintf(stream, "SSD_SIZE: %u\n", SSD_SIZE);
 	fprintf(stream, "PACKAGE_SIZE: %u\n", PACKAGE_SIZE);
 	fprintf(stream, "DIE_SIZE: %u\n", DIE_SIZE);
+	fprintf(stream, "MULTI_PLANE: %u\n", MULTI_PLANE);
 	fprintf(stream, "PLANE_SIZE: %u\n", PLANE_SIZE);
 	fprintf(stream, "PLANE_REG_READ_DELAY: %.16lf\n", PLANE_REG_READ_DELAY);
 	fprintf(stream, "PLANE_REG_WRITE_DELAY: %.16lf\n", PLANE_REG_WRITE_DELAY);
+	fprintf(stream, "PLANE_CACHE_READ: %i\n", PLANE_CACHE_READ);
+	fprintf(stream, "PLANE_CACHE_PROGRAM: %i\n", PLANE_CACHE_PROGRAM);
 	fprintf(stream, "BLOCK_SIZE: %u\n", BLOCK_SIZE);
 	fprintf(stream, "BLOCK_ERASES: %u\n", BLOCK_ERASES);
 	fprintf(stream, "BLOCK_ERASE_DELAY: %.16lf\n", BLOCK_ERASE_DELAY);
@@ -300,10 +401,126 @@ void print_config(FILE *stream) {
 	fprintf(stream, "PAGE_ENABLE_DATA: %i\n", PAGE_ENABLE_DATA);
 	fprintf(stream, "MAP_DIRECTORY_SIZE: %i\n", MAP_DIRECTORY_SIZE);
 	fprintf(stream, "FTL_IMPLEMENTATION: %i\n", FTL_IMPLEMENTATION);
+	fprintf(stream, "BAST_LOG_VICTIM: %i\n", BAST_LOG_VICTIM);
+	fprintf(stream, "CACHE_DFTL_POLICY: %i\n", CACHE_DFTL_POLICY);
+	fprintf(stream, "CACHE_DFTL_PREFETCH: %i\n", CACHE_DFTL_PREFETCH);
+	fprintf(stream, "GC_POLICY: %i\n", GC_POLICY);
+	fprintf(stream, "GC_THRESHOLD: %.16lf\n", GC_THRESHOLD);
+	fprintf(stream, "GC_BLOCKS: %u\n", GC_BLOCKS);
+	fprintf(stream, "GC_CHOICES: %u\n", GC_CHOICES);
+	fprintf(stream, "GC_WINDOW: %u\n", GC_WINDOW);
+	fprintf(stream, "BLOCK_ALLOCATION: %u\n", BLOCK_ALLOCATION);
 	fprintf(stream, "PARALLELISM_MODE: %i\n", PARALLELISM_MODE);
 	fprintf(stream, "RAID_NUMBER_OF_PHYSICAL_SSDS: %i\n", RAID_NUMBER_OF_PHYSICAL_SSDS);
 
 	return;
 }
 
+Config::Config(void):
+	RAM_READ_DELAY(ssd::RAM_READ_DELAY),
+	RAM_WRITE_DELAY(ssd::RAM_WRITE_DELAY),
+	BUS_CTRL_DELAY(ssd::BUS_CTRL_DELAY),
+	BUS_DATA_DELAY(ssd::BUS_DATA_DELAY),
+	BUS_MAX_CONNECT(ssd::BUS_MAX_CONNECT),
+	BUS_CHANNEL_FREE_FLAG(ssd::BUS_CHANNEL_FREE_FLAG),
+	BUS_TABLE_SIZE(ssd::BUS_TABLE_SIZE),
+	SSD_SIZE(ssd::SSD_SIZE),
+	PACKAGE_SIZE(ssd::PACKAGE_SIZE),
+	DIE_SIZE(ssd::DIE_SIZE),
+	MULTI_PLANE(ssd::MULTI_PLANE),
+	PLANE_SIZE(ssd::PLANE_SIZE),
+	PLANE_REG_READ_DELAY(ssd::PLANE_REG_READ_DELAY),
+	PLANE_REG_WRITE_DELAY(ssd::PLANE_REG_WRITE_DELAY),
+	PLANE_CACHE_READ(ssd::PLANE_CACHE_READ),
+	PLANE_CACHE_PROGRAM(ssd::PLANE_CACHE_PROGRAM),
+	BLOCK_SIZE(ssd::BLOCK_SIZE),
+	BLOCK_ERASES(ssd::BLOCK_ERASES),
+	BLOCK_ERASE_DELAY(ssd::BLOCK_ERASE_DELAY),
+	PAGE_READ_DELAY(ssd::PAGE_READ_DELAY),
+	PAGE_WRITE_DELAY(ssd::PAGE_WRITE_DELAY),
+	PAGE_SIZE(ssd::PAGE_SIZE),
+	PAGE_ENABLE_DATA(ssd::PAGE_ENABLE_DATA),
+	MAP_DIRECTORY_SIZE(ssd::MAP_DIRECTORY_SIZE),
+	FTL_IMPLEMENTATION(ssd::FTL_IMPLEMENTATION),
+	BAST_LOG_BLOCK_LIMIT(ssd::BAST_LOG_BLOCK_LIMIT),
+	BAST_LOG_VICTIM(ssd::BAST_LOG_VICTIM),
+	FAST_LOG_BLOCK_LIMIT(ssd::FAST_LOG_BLOCK_LIMIT),
+	CACHE_DFTL_LIMIT(ssd::CACHE_DFTL_LIMIT),
+	CACHE_DFTL_POLICY(ssd::CACHE_DFTL_POLICY),
+	CACHE_DFTL_PREFETCH(ssd::CACHE_DFTL_PREFETCH),
+	GC_POLICY(ssd::GC_POLICY),
+	GC_THRESHOLD(ssd::GC_THRESHOLD),
+	GC_BLOCKS(ssd::GC_BLOCKS),
+	GC_CHOICES(ssd::GC_CHOICES),
+	GC_WINDOW(ssd::GC_WINDOW),
+	BLOCK_ALLOCATION(ssd::BLOCK_ALLOCATION),
+	PARALLELISM_MODE(ssd::PARALLELISM_MODE),
+	VIRTUAL_BLOCK_SIZE(ssd::VIRTUAL_BLOCK_SIZE),
+	VIRTUAL_PAGE_SIZE(ssd::VIRTUAL_PAGE_SIZE),
+	NUMBER_OF_ADDRESSABLE_BLOCKS(ssd::NUMBER_OF_ADDRESSABLE_BLOCKS),
+	RAID_NUMBER_OF_PHYSICAL_SSDS(ssd::RAID_NUMBER_OF_PHYSICAL_SSDS)
+{
+	return;
+}
+
+void Config::apply(void) const
+{
+	ssd::RAM_READ_DELAY = RAM_READ_DELAY;
+	ssd::RAM_WRITE_DELAY = RAM_WRITE_DELAY;
+	ssd::BUS_CTRL_DELAY = BUS_CTRL_DELAY;
+	ssd::BUS_DATA_DELAY = BUS_DATA_DELAY;
+	ssd::BUS_MAX_CONNECT = BUS_MAX_CONNECT;
+	ssd::BUS_CHANNEL_FREE_FLAG = BUS_CHANNEL_FREE_FLAG;
+	ssd::BUS_TABLE_SIZE = BUS_TABLE_SIZE;
+	ssd::SSD_SIZE = SSD_SIZE;
+	ssd::PACKAGE_SIZE = PACKAGE_SIZE;
+	ssd::DIE_SIZE = DIE_SIZE;
+	ssd::MULTI_PLANE = MULTI_PLANE;
+	ssd::PLANE_SIZE = PLANE_SIZE;
+	ssd::PLANE_REG_READ_DELAY = PLANE_REG_READ_DELAY;
+	ssd::PLANE_REG_WRITE_DELAY = PLANE_REG_WRITE_DELAY;
+	ssd::PLANE_CACHE_READ = PLANE_CACHE_READ;
+	ssd::PLANE_CACHE_PROGRAM = PLANE_CACHE_PROGRAM;
+	ssd::BLOCK_SIZE = BLOCK_SIZE;
+	ssd::BLOCK_ERASES = BLOCK_ERASES;
+	ssd::BLOCK_ERASE_DELAY = BLOCK_ERASE_DELAY;
+	ssd::PAGE_READ_DELAY = PAGE_READ_DELAY;
+	ssd::PAGE_WRITE_DELAY = PAGE_WRITE_DELAY;
+	ssd::PAGE_SIZE = PAGE_SIZE;
+	ssd::PAGE_ENABLE_DATA = PAGE_ENABLE_DATA;
+	ssd::MAP_DIRECTORY_SIZE = MAP_DIRECTORY_SIZE;
+	ssd::FTL_IMPLEMENTATION = FTL_IMPLEMENTATION;
+	ssd::BAST_LOG_BLOCK_LIMIT = BAST_LOG_BLOCK_LIMIT;
+	ssd::BAST_LOG_VICTIM = BAST_LOG_VICTIM;
+	ssd::FAST_LOG_BLOCK_LIMIT = FAST_LOG_BLOCK_LIMIT;
+	ssd::CACHE_DFTL_LIMIT = CACHE_DFTL_LIMIT;
+	ssd::CACHE_DFTL_POLICY = CACHE_DFTL_POLICY;
+	ssd::CACHE_DFTL_PREFETCH = CACHE_DFTL_PREFETCH;
+	ssd::GC_POLICY = GC_POLICY;
+	ssd::GC_THRESHOLD = GC_THRESHOLD;
+	ssd::GC_BLOCKS = GC_BLOCKS;
+	ssd::GC_CHOICES = GC_CHOICES;
+	ssd::GC_WINDOW = GC_WINDOW;
+	ssd::BLOCK_ALLOCATION = BLOCK_ALLOCATION;
+	ssd::PARALLELISM_MODE = PARALLELISM_MODE;
+	ssd::VIRTUAL_BLOCK_SIZE = VIRTUAL_BLOCK_SIZE;
+	ssd::VIRTUAL_PAGE_SIZE = VIRTUAL_PAGE_SIZE;
+	ssd::NUMBER_OF_ADDRESSABLE_BLOCKS = NUMBER_OF_ADDRESSABLE_BLOCKS;
+	ssd::RAID_NUMBER_OF_PHYSICAL_SSDS = RAID_NUMBER_OF_PHYSICAL_SSDS;
+	return;
+}
+
+/* saved copies the configuration of the calling thread before it is replaced */
+Config_scope::Config_scope(const Config &config)
+{
+	config.apply();
+	return;
+}
+
+Config_scope::~Config_scope(void)
+{
+	saved.apply();
+	return;
+}
+
 }
@@ -34,12 +34,15 @@
 #include <new>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include "ssd.h"
 
 using namespace ssd;
 
 Controller::Controller(Ssd &parent):
-	ssd(parent)
+	ssd(parent),
+	functional(false)
 {
 	switch (FTL_IMPLEMENTATION)
 	{
@@ -73,6 +76,9 @@ Controller::~Controller(void)
 
 enum status Controller::event_arrive(Event &event)
 {
+	if(event.get_size() > 1)
+		return event_arrive_pages(event);
+
 	if(event.get_event_type() == READ)
 		return ftl->read(event);
 	else if(event.get_event_type() == WRITE)
@@ -84,7 +90,120 @@ enum status Controller::event_arrive(Event &event)
 	return FAILURE;
 }
 
+/* a host request of several pages is split into a request per page, all
+ * 	arriving with it, which the FTL maps one by one and which run
+ * 	concurrently on the dies and channels their pages map to
+ * the request completes with the last of its pages, and the page data of
+ * 	a write follow each other in the payload
+ * a read with a payload copies each page it reads into its place in the
+ * 	payload, which then becomes the result buffer; pages that were never
+ * 	written leave their place untouched */
+enum status Controller::event_arrive_pages(Event &event)
+{
+	std::vector<Event> pages;
+	pages.reserve(event.get_size());
+	Flash_state &state = ssd.flash_state;
+	char *payload = (char *) event.get_payload();
+	bool read_out = event.get_event_type() == READ && payload != NULL;
+	bool read_any = false;
+
+	for(uint i = 0; i < event.get_size(); i++)
+	{
+		pages.push_back(Event(event.get_event_type(), event.get_logical_address() + i, 1, event.get_start_time()));
+		if(payload != NULL)
+			pages.back().set_payload(payload + (ulong) i * PAGE_SIZE);
+		if(read_out)
+			state.set_result_buffer(NULL);
+		if(event_arrive(pages.back()) == FAILURE)
+			return FAILURE;
+		if(read_out && state.get_result_buffer() != NULL)
+		{
+			memcpy(payload + (ulong) i * PAGE_SIZE, state.get_result_buffer(), PAGE_SIZE);
+			read_any = true;
+		}
+	}
+	if(read_out)
+		state.set_result_buffer(read_any ? payload : NULL);
+	for(uint i = 0; i + 1 < pages.size(); i++)
+		pages[i].set_next(pages[i + 1]);
+	event.consolidate_metaevent(pages[0]);
+	return SUCCESS;
+}
+
+/* each event is posted on the timelines of the hardware it uses: it waits
+ * 	for its die to finish the previous array operation, locks its bus channel
+ * 	and then occupies the die until the array operation completes
+ * events to different dies therefore overlap and only the bus channel and
+ * 	the die itself serialize them
+ * time_taken of each event ends at its completion, FTLs join on sub-events
+ * 	they issue with Event::join instead of summing their durations */
 enum status Controller::issue(Event &event_list)
+{
+	if(PARALLELISM_MODE == 1 && VIRTUAL_PAGE_SIZE > 1)
+		return issue_superpages(event_list);
+	if(functional)
+		return issue_functional(event_list);
+	return issue_pages(event_list);
+}
+
+/* striping mode: each event of the FTL addresses a superpage (or the
+ * 	superblock of an erase) and is issued as one event per stripe unit (see
+ * 	translate_address), which run in parallel on their own packages or dies
+ * the event takes as long as the slowest of its units
+ * the units are issued from the last to the first so a read leaves the data
+ * 	of the first unit, which holds the payload, in the result buffer */
+enum status Controller::issue_superpages(Event &event_list)
+{
+	Event *cur;
+	std::vector<Event> units;
+	units.reserve(VIRTUAL_PAGE_SIZE);
+
+	for(cur = &event_list; cur != NULL; cur = cur -> get_next()){
+		if(cur -> get_size() != 1){
+			fprintf(stderr, "Controller: %s: Received non-single-page-sized event from FTL.\n", __func__);
+			return FAILURE;
+		}
+		if(cur -> get_event_type() == TRIM)
+			return SUCCESS;
+
+		units.clear();
+		for(uint unit = VIRTUAL_PAGE_SIZE; unit-- > 0; )
+		{
+			units.push_back(Event(cur -> get_event_type(), cur -> get_logical_address(), 1, cur -> get_start_time()));
+			Event &event = units.back();
+			(void) event.incr_time_taken(cur -> get_time_taken());
+			event.set_noop(cur -> get_noop());
+			if(unit == 0)
+				event.set_payload(cur -> get_payload());
+
+			Address address = cur -> get_address();
+			translate_address(address, unit);
+			event.set_address(address);
+			if(cur -> has_replace_address())
+			{
+				address = cur -> get_replace_address();
+				translate_address(address, unit);
+				event.set_replace_address(address);
+			}
+			if(cur -> get_event_type() == MERGE)
+			{
+				address = cur -> get_merge_address();
+				translate_address(address, unit);
+				event.set_merge_address(address);
+			}
+		}
+		for(uint i = 0; i + 1 < units.size(); i++)
+			units[i].set_next(units[i + 1]);
+
+		if((functional ? issue_functional(units[0]) : issue_pages(units[0])) == FAILURE)
+			return FAILURE;
+		cur -> consolidate_metaevent(units[0]);
+	}
+	return SUCCESS;
+}
+
+/* each event addresses a single physical page or block */
+enum status Controller::issue_pages(Event &event_list)
 {
 	Event *cur;
 
@@ -99,10 +218,14 @@ enum status Controller::issue(Event &event_list)
 		else if(cur -> get_event_type() == READ)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY, *cur) == FAILURE
+			wait_ready(*cur);
+			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY, *cur) == FAILURE
 				|| ssd.read(*cur) == FAILURE
-				|| ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE
-				|| ssd.ram.write(*cur) == FAILURE
+				|| ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE)
+				return FAILURE;
+			/* the page register of the die holds the data until now */
+			ssd.read_out(*cur);
+			if(ssd.ram.write(*cur) == FAILURE
 				|| ssd.ram.read(*cur) == FAILURE
 				|| ssd.replace(*cur) == FAILURE)
 				return FAILURE;
@@ -110,7 +233,10 @@ enum status Controller::issue(Event &event_list)
 		else if(cur -> get_event_type() == WRITE)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE
+			/* the data is shifted into the die's register, so the transfer
+			 * cannot start before the die finished its previous operation */
+			wait_ready(*cur);
+			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE
 				|| ssd.ram.write(*cur) == FAILURE
 				|| ssd.ram.read(*cur) == FAILURE
 				|| ssd.write(*cur) == FAILURE
@@ -120,7 +246,8 @@ enum status Controller::issue(Event &event_list)
 		else if(cur -> get_event_type() == ERASE)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY, *cur) == FAILURE
+			wait_ready(*cur);
+			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY, *cur) == FAILURE
 				|| ssd.erase(*cur) == FAILURE)
 				return FAILURE;
 		}
@@ -128,7 +255,8 @@ enum status Controller::issue(Event &event_list)
 		{
 			assert(cur -> get_address().valid > NONE);
 			assert(cur -> get_merge_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY, *cur) == FAILURE
+			wait_ready(*cur);
+			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY, *cur) == FAILURE
 				|| ssd.merge(*cur) == FAILURE)
 				return FAILURE;
 		}
@@ -145,10 +273,84 @@ enum status Controller::issue(Event &event_list)
 	return SUCCESS;
 }
 
-void Controller::translate_address(Address &address)
+/* functional mode: pass the events straight to the flash so they make the
+ * 	same state changes as issue without waiting on the die, bus or RAM
+ * the flash still adds its own delays to time_taken but nothing reads them */
+enum status Controller::issue_functional(Event &event_list)
+{
+	Event *cur;
+
+	for(cur = &event_list; cur != NULL; cur = cur -> get_next()){
+		if(cur -> get_size() != 1){
+			fprintf(stderr, "Controller: %s: Received non-single-page-sized event from FTL.\n", __func__);
+			return FAILURE;
+		}
+		else if(cur -> get_event_type() == READ)
+		{
+			assert(cur -> get_address().valid > NONE);
+			if(ssd.read(*cur) == FAILURE || ssd.replace(*cur) == FAILURE)
+				return FAILURE;
+		}
+		else if(cur -> get_event_type() == WRITE)
+		{
+			assert(cur -> get_address().valid > NONE);
+			if(ssd.write(*cur) == FAILURE || ssd.replace(*cur) == FAILURE)
+				return FAILURE;
+		}
+		else if(cur -> get_event_type() == ERASE)
+		{
+			assert(cur -> get_address().valid > NONE);
+			if(ssd.erase(*cur) == FAILURE)
+				return FAILURE;
+		}
+		else if(cur -> get_event_type() == MERGE)
+		{
+			assert(cur -> get_address().valid > NONE);
+			assert(cur -> get_merge_address().valid > NONE);
+			if(ssd.merge(*cur) == FAILURE)
+				return FAILURE;
+		}
+		else if(cur -> get_event_type() == TRIM)
+		{
+			return SUCCESS;
+		}
+		else
+		{
+			fprintf(stderr, "Controller: %s: Invalid event type\n", __func__);
+			return FAILURE;
+		}
+	}
+	return SUCCESS;
+}
+
+/* hold the event back until the die it addresses is ready for a new command
+ * 	or can add it to its multi-plane operation */
+void Controller::wait_ready(Event &event)
 {
-	if (PARALLELISM_MODE != 1)
+	double now = event.get_start_time() + event.get_time_taken();
+	(void) event.incr_time_taken(ssd.get_ready_time(event) - now);
+	return;
+}
+
+/* when a command to the die of the address could start, as late as the die
+ * and the channel of its package are ready */
+double Controller::get_ready_time(const Address &address)
+{
+	return std::max(ssd.get_ready_time(address), ssd.bus.ready_time(address.package));
+}
+
+/* striping mode splits the flash into VIRTUAL_PAGE_SIZE stripe units of
+ * 	NUMBER_OF_ADDRESSABLE_BLOCKS blocks each, the FTL addresses the first
+ * 	and a superpage is the page at the same offset in every unit
+ * the units are consecutive in the linear address, whose outermost parts are
+ * 	the package and the die, and load_config requires VIRTUAL_PAGE_SIZE to
+ * 	divide the number of dies, so they lie on different packages or dies */
+void Controller::translate_address(Address &address, uint unit)
+{
+	if(address.valid < BLOCK || unit == 0)
 		return;
+	address.set_linear_address(address.get_linear_address() + (ulong) unit * NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE, address.valid);
+	return;
 }
 
 ssd::ulong Controller::get_erases_remaining(const Address &address) const
@@ -216,7 +418,35 @@ const FtlParent &Controller::get_ftl(void) const
 	return (*ftl);
 }
 
+Block_manager &Controller::get_block_manager(void)
+{
+	return ftl->get_block_manager();
+}
+
+void *Controller::get_page_data(ulong page) const
+{
+	return ssd.flash_state.get_page_data(page);
+}
+
 void Controller::print_ftl_statistics()
 {
 	ftl->print_ftl_statistics();
 }
+
+void Controller::snapshot(Snapshot &snapshot)
+{
+	stats.snapshot(snapshot);
+	ftl -> snapshot(snapshot);
+	return;
+}
+
+void Controller::set_functional(bool value)
+{
+	functional = value;
+	return;
+}
+
+bool Controller::is_functional(void) const
+{
+	return functional;
+}
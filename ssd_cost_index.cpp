@@ -0,0 +1,164 @@
+/* Copyright 2011 Matias Bjørling */
+
+/* Block cost index
+ *
+ * Files every block under its number of invalid pages for the greedy
+ * garbage collection of the Block_manager. The order of the blocks with the
+ * same count decides which victim goes first, it follows the sorted sequence
+ * the index replaced: a block is only moved when its new count passes that
+ * of a neighbour, and then goes after the blocks with the same count.
+ */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Block_cost_index::Block_cost_index(void):
+	head(BLOCK_SIZE + 1, -1),
+	tail(BLOCK_SIZE + 1, -1),
+	top(0)
+{
+	blocks.reserve(NUMBER_OF_ADDRESSABLE_BLOCKS);
+	prev_block.reserve(NUMBER_OF_ADDRESSABLE_BLOCKS);
+	next_block.reserve(NUMBER_OF_ADDRESSABLE_BLOCKS);
+	count.reserve(NUMBER_OF_ADDRESSABLE_BLOCKS);
+}
+
+void Block_cost_index::link(int index, uint c, bool front)
+{
+	count[index] = c;
+	if (front)
+	{
+		prev_block[index] = -1;
+		next_block[index] = head[c];
+		if (head[c] != -1)
+			prev_block[head[c]] = index;
+		head[c] = index;
+		if (tail[c] == -1)
+			tail[c] = index;
+	} else {
+		next_block[index] = -1;
+		prev_block[index] = tail[c];
+		if (tail[c] != -1)
+			next_block[tail[c]] = index;
+		tail[c] = index;
+		if (head[c] == -1)
+			head[c] = index;
+	}
+	if (c > top)
+		top = c;
+}
+
+void Block_cost_index::unlink(int index)
+{
+	uint c = count[index];
+	if (prev_block[index] != -1)
+		next_block[prev_block[index]] = next_block[index];
+	else
+		head[c] = next_block[index];
+	if (next_block[index] != -1)
+		prev_block[next_block[index]] = prev_block[index];
+	else
+		tail[c] = prev_block[index];
+
+	while (top > 0 && head[top] == -1)
+		top--;
+}
+
+// Blocks are inserted in the order of their physical address
+void Block_cost_index::insert(Block *block)
+{
+	int index = blocks.size();
+	assert((ulong) block->get_physical_address() == (ulong) index * BLOCK_SIZE);
+	blocks.push_back(block);
+	prev_block.push_back(-1);
+	next_block.push_back(-1);
+	count.push_back(0);
+	link(index, block->get_pages_invalid(), false);
+}
+
+void Block_cost_index::update(Block *block)
+{
+	int index = block->get_physical_address() / BLOCK_SIZE;
+	uint from = count[index];
+	uint to = block->get_pages_invalid();
+	if (from == to)
+		return;
+
+	// A block that grows stays in place when it is last of its count and no
+	// block lies between the two counts, it then precedes the blocks of to
+	bool front = false;
+	if (to > from && tail[from] == index)
+	{
+		front = true;
+		for (uint c = from + 1; c < to && front; c++)
+			front = head[c] == -1;
+	}
+
+	unlink(index);
+	link(index, to, front);
+}
+
+// The block with the fewest invalid pages that goes first, NULL when empty
+Block *Block_cost_index::first(void) const
+{
+	for (uint c = 0; c <= BLOCK_SIZE; c++)
+		if (head[c] != -1)
+			return blocks[head[c]];
+	return NULL;
+}
+
+// The block with the most invalid pages that goes last, NULL when empty
+Block *Block_cost_index::last(void) const
+{
+	return tail[top] == -1 ? NULL : blocks[tail[top]];
+}
+
+// The block after block, NULL after the last
+Block *Block_cost_index::next(Block *block) const
+{
+	int index = block->get_physical_address() / BLOCK_SIZE;
+	if (next_block[index] != -1)
+		return blocks[next_block[index]];
+	for (uint c = count[index] + 1; c <= top; c++)
+		if (head[c] != -1)
+			return blocks[head[c]];
+	return NULL;
+}
+
+// The block before block, NULL before the first
+Block *Block_cost_index::previous(Block *block) const
+{
+	int index = block->get_physical_address() / BLOCK_SIZE;
+	if (prev_block[index] != -1)
+		return blocks[prev_block[index]];
+	for (uint c = count[index]; c-- > 0; )
+		if (tail[c] != -1)
+			return blocks[tail[c]];
+	return NULL;
+}
+
+uint Block_cost_index::size(void) const
+{
+	return blocks.size();
+}
+
+// Blocks are numbered by their physical address
+Block *Block_cost_index::get_block(uint index) const
+{
+	return blocks[index];
+}
+
+// The blocks are created before the image is loaded and keep their place
+void Block_cost_index::snapshot(Snapshot &snapshot)
+{
+	snapshot.io_vector(prev_block);
+	snapshot.io_vector(next_block);
+	snapshot.io_vector(count);
+	snapshot.io_vector(head);
+	snapshot.io_vector(tail);
+	snapshot.io(top);
+}
@@ -30,7 +30,7 @@
 
 using namespace ssd;
 
-Die::Die(const Package &parent, Channel &channel, uint die_size, long physical_address):
+Die::Die(const Package &parent, Channel &channel, Flash_state &store, Block_manager &manager, uint die_size, long physical_address):
 	size(die_size),
 
 	/* use a const pointer (Plane * const data) to use as an array
@@ -48,7 +48,22 @@ Die::Die(const Package &parent, Channel &channel, uint die_size, long physical_a
 	erases_remaining(BLOCK_ERASES),
 
 	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0)
+	last_erase_time(0.0),
+
+	/* assume hardware created at time 0 and is idle */
+	ready_at(0.0),
+
+	/* no array operation to join yet */
+	multi_type(READ),
+	multi_block(0),
+	multi_page(0),
+	multi_planes(0),
+	multi_start(0.0),
+
+	/* registers empty */
+	cache_plane(0),
+	cache_ready(0.0),
+	output_at(0.0)
 {
 	uint i;
 
@@ -70,7 +85,7 @@ Die::Die(const Package &parent, Channel &channel, uint die_size, long physical_a
 
 
 	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Plane(*this, PLANE_SIZE, PLANE_REG_READ_DELAY, PLANE_REG_WRITE_DELAY, physical_address+(PLANE_SIZE*BLOCK_SIZE*i));
+		(void) new (&data[i]) Plane(*this, store, manager, PLANE_SIZE, PLANE_REG_READ_DELAY, PLANE_REG_WRITE_DELAY, physical_address+(PLANE_SIZE*BLOCK_SIZE*i));
 
 	return;
 }
@@ -88,18 +103,102 @@ Die::~Die(void)
 	return;
 }
 
+/* a read, write or erase to another plane at the block and page offset of
+ * 	the last array operation of the die joins it as one multi-plane
+ * 	operation while the operation runs, as long as it spans fewer than
+ * 	MULTI_PLANE planes
+ * the first command of the operation opens it and commands that join it
+ * 	follow right behind on the channel (see get_ready_time), so the die is
+ * 	charged a single array time for all of its planes instead of one each
+ * any other command waits for the die to finish and opens a new operation,
+ * 	a cache read or cache program only for the array (see can_cache)
+ * in functional mode nothing waits or joins
+ * returns whether the event joined the running operation */
+bool Die::multi_plane(Event &event)
+{
+	if(is_functional())
+		return false;
+	double now = event.get_start_time() + event.get_time_taken();
+	if(can_join(event) && now >= multi_start && now < ready_at)
+	{
+		multi_planes++;
+		cache_plane = event.get_address().plane;
+		cache_ready = now;
+		return true;
+	}
+	double ready = can_cache(event) || output_at < ready_at ? ready_at : output_at;
+	if(MULTI_PLANE > 1 || PLANE_CACHE_READ || PLANE_CACHE_PROGRAM)
+		(void) event.incr_time_taken(ready - now);
+	multi_type = event.get_event_type();
+	multi_block = event.get_address().block;
+	multi_page = event.get_address().page;
+	multi_planes = 1;
+	multi_start = event.get_start_time() + event.get_time_taken();
+	cache_plane = event.get_address().plane;
+	cache_ready = multi_start;
+	return false;
+}
+
+/* cache read and cache program pipeline the commands to the plane the die
+ * 	last worked on through its two registers
+ * a cache read starts once the last read copied its page to the cache
+ * 	register, while that page goes out on the channel, and copies its own
+ * 	page once the cache register is free
+ * a cache program goes over the channel to the cache register while the
+ * 	page of the last write is programmed and is programmed once the array
+ * 	is free
+ * so the die reads or writes as fast as the slower of the channel and the
+ * 	array instead of the sum of both */
+bool Die::can_cache(const Event &event) const
+{
+	enum event_type type = event.get_event_type();
+	return ((type == READ && PLANE_CACHE_READ) || (type == WRITE && PLANE_CACHE_PROGRAM))
+		&& multi_planes > 0 && type == multi_type && event.get_address().plane == cache_plane;
+}
+
+/* whether the event fits the running operation, its time aside */
+bool Die::can_join(const Event &event) const
+{
+	const Address &address = event.get_address();
+	return multi_planes > 0 && multi_planes < MULTI_PLANE && event.get_event_type() == multi_type
+		&& address.block == multi_block && (multi_type == ERASE || address.page == multi_page)
+		&& data[address.plane].get_ready_time() <= multi_start;
+}
+
 enum status Die::read(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
-	return data[event.get_address().plane].read(event);
+	bool joined = multi_plane(event);
+	enum status status = data[event.get_address().plane].read(event);
+	if(is_functional())
+		return status;
+	if(PLANE_CACHE_READ)
+		(void) event.incr_time_taken(output_at - event.get_start_time() - event.get_time_taken());
+	if(!joined || event.get_start_time() + event.get_time_taken() > ready_at)
+		ready_at = event.get_start_time() + event.get_time_taken();
+	return status;
+}
+
+/* the registers of the die are free once the data of a read is out */
+void Die::read_out(const Event &event)
+{
+	if(event.get_start_time() + event.get_time_taken() > output_at)
+		output_at = event.get_start_time() + event.get_time_taken();
+	return;
 }
 
 enum status Die::write(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
-	return data[event.get_address().plane].write(event);
+	bool joined = multi_plane(event);
+	enum status status = data[event.get_address().plane].write(event);
+	if(is_functional())
+		return status;
+	if(!joined || event.get_start_time() + event.get_time_taken() > ready_at)
+		ready_at = event.get_start_time() + event.get_time_taken();
+	return status;
 }
 
 enum status Die::replace(Event &event)
@@ -117,11 +216,16 @@ enum status Die::erase(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
+	bool joined = multi_plane(event);
 	enum status status = data[event.get_address().plane].erase(event);
 
 	/* update values if no errors */
 	if(status == SUCCESS)
 		update_wear_stats(event.get_address());
+	if(is_functional())
+		return status;
+	if(!joined || event.get_start_time() + event.get_time_taken() > ready_at)
+		ready_at = event.get_start_time() + event.get_time_taken();
 	return status;
 }
 
@@ -131,9 +235,16 @@ enum status Die::merge(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE && event.get_merge_address().plane < size && event.get_merge_address().valid > DIE);
+	enum status status;
 	if(event.get_address().plane != event.get_merge_address().plane)
-		return _merge(event);
-	else return data[event.get_address().plane]._merge(event);
+		status = _merge(event);
+	else
+		status = data[event.get_address().plane]._merge(event);
+	if(is_functional())
+		return status;
+	ready_at = event.get_start_time() + event.get_time_taken();
+	multi_planes = 0;
+	return status;
 }
 
 /* TODO: update stub as per Die::merge() comment above
@@ -151,6 +262,13 @@ const Package &Die::get_parent(void) const
 	return parent;
 }
 
+/* functional mode (see Ssd::set_functional) keeps the die and its planes off
+ * 	the timelines: no waits, register delays or ready times */
+bool Die::is_functional(void) const
+{
+	return parent.get_parent().is_functional();
+}
+
 /* if given a valid Block address, call the Block's method
  * else return local value */
 double Die::get_last_erase_time(const Address &address) const
@@ -238,8 +356,55 @@ ssd::uint Die::get_num_invalid(const Address & address) const
 	return data[address.plane].get_num_invalid(address);
 }
 
+/* time when the die can accept the next command for the given address
+ * a die runs one array operation at a time, so commands to the same die queue
+ * 	up behind each other while commands to other dies proceed in parallel
+ * the page of a read stays in the registers until it went out on the channel */
+double Die::get_ready_time(const Address &address) const
+{
+	assert(data != NULL);
+	double ready = output_at > ready_at ? output_at : ready_at;
+	if(address.valid > DIE && address.plane < size && data[address.plane].get_ready_time() > ready)
+		return data[address.plane].get_ready_time();
+	return ready;
+}
+
+/* a command that can join the running multi-plane operation may go on the
+ * 	channel as soon as the operation started, behind the commands of the
+ * 	planes that joined before it
+ * a cache read or cache program may go on the channel as soon as the array
+ * 	operation before it started and waits in the die for the array */
+double Die::get_ready_time(const Event &event) const
+{
+	assert(data != NULL);
+	if(can_join(event))
+		return multi_start;
+	if(can_cache(event))
+		return cache_ready;
+	return get_ready_time(event.get_address());
+}
+
 Block *Die::get_block_pointer(const Address & address)
 {
 	assert(address.valid >= PLANE);
 	return data[address.plane].get_block_pointer(address);
 }
+
+void Die::snapshot(Snapshot &snapshot)
+{
+	snapshot.io(least_worn);
+	snapshot.io(erases_remaining);
+	snapshot.io(last_erase_time);
+	snapshot.io(ready_at);
+	snapshot.io(multi_type);
+	snapshot.io(multi_block);
+	snapshot.io(multi_page);
+	snapshot.io(multi_planes);
+	snapshot.io(multi_start);
+	snapshot.io(cache_plane);
+	snapshot.io(cache_ready);
+	snapshot.io(output_at);
+	for(uint i = 0; i < size; i++)
+		data[i].snapshot(snapshot);
+	return;
+}
@@ -36,11 +36,17 @@ Event::Event(enum event_type type, ulong logical_address, uint size, double star
 	start_time(start_time),
 	time_taken(0.0),
 	bus_wait_time(0.0),
-	type(type),
 	logical_address(logical_address),
-	size(size),
+
+	/* packed form of a default Address (valid status NONE) */
+	merge_address(0),
+	log_address(0),
+	replace_address(0),
+
 	payload(NULL),
 	next(NULL),
+	type(type),
+	size(size),
 	noop(false)
 {
 	assert(start_time >= 0.0);
@@ -83,6 +89,19 @@ void Event::consolidate_metaevent(Event &list)
 	return;
 }
 
+/* wait for an event that was issued on behalf of this event
+ * this event cannot finish before the given event does, so time_taken is
+ * 	raised to cover the given event's finish time
+ * unlike incr_time_taken, events issued in parallel (e.g. garbage collection
+ * 	copies to different dies) overlap instead of adding up */
+double Event::join(const Event &event)
+{
+	double finish = event.start_time + event.time_taken - start_time;
+	if(finish > time_taken)
+		time_taken = finish;
+	return time_taken;
+}
+
 ssd::ulong Event::get_logical_address(void) const
 {
 	return logical_address;
@@ -93,24 +112,35 @@ const Address &Event::get_address(void) const
 	return address;
 }
 
-const Address &Event::get_merge_address(void) const
+Address Event::get_merge_address(void) const
+{
+	Address address;
+	address.set_packed(merge_address);
+	return address;
+}
+
+Address Event::get_log_address(void) const
 {
-	return merge_address;
+	Address address;
+	address.set_packed(log_address);
+	return address;
 }
 
-const Address &Event::get_log_address(void) const
+Address Event::get_replace_address(void) const
 {
-	return log_address;
+	Address address;
+	address.set_packed(replace_address);
+	return address;
 }
 
-const Address &Event::get_replace_address(void) const
+bool Event::has_replace_address(void) const
 {
-	return replace_address;
+	return get_replace_address().valid != NONE;
 }
 
 void Event::set_log_address(const Address &address)
 {
-	log_address = address;
+	log_address = address.get_packed();
 }
 
 ssd::uint Event::get_size(void) const
@@ -175,13 +205,13 @@ void Event::set_address(const Address &address)
 
 void Event::set_merge_address(const Address &address)
 {
-	merge_address = address;
+	merge_address = address.get_packed();
 	return;
 }
 
 void Event::set_replace_address(const Address &address)
 {
-	replace_address = address;
+	replace_address = address.get_packed();
 }
 
 void Event::set_noop(bool value)
@@ -223,7 +253,7 @@ void Event::print(FILE *stream)
 		fprintf(stream, "Unknown event type: ");
 	address.print(stream);
 	if(type == MERGE)
-		merge_address.print(stream);
+		get_merge_address().print(stream);
 	fprintf(stream, " Time[%f, %f) Bus_wait: %f\n", start_time, start_time + time_taken, bus_wait_time);
 	return;
 }
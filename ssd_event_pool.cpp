@@ -0,0 +1,105 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_event_pool.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Event_pool class
+ *
+ * Recycles the Event objects the Ssd creates for each request it receives.
+ * Slabs are only returned to the system when the pool is destroyed, so the
+ * pool grows to the largest number of events that were alive at once.
+ */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Event_pool::Event_pool(uint slab_size):
+	free_list(NULL),
+	slab_size(slab_size),
+	num_allocated(0)
+{
+	if(slab_size == 0)
+	{
+		fprintf(stderr, "Event_pool error: %s: constructor received a slab size of 0\n", __func__);
+		exit(MEM_ERR);
+	}
+	return;
+}
+
+/* events still allocated from the pool are not destroyed, their memory goes
+ * away with the slabs */
+Event_pool::~Event_pool(void)
+{
+	for(uint i = 0; i < slabs.size(); i++)
+		::free(slabs[i]);
+	return;
+}
+
+/* use placement new to construct the event in a free slot */
+Event *Event_pool::alloc(enum event_type type, ulong logical_address, uint size, double start_time)
+{
+	if(free_list == NULL)
+		grow();
+	slot *cur = free_list;
+	free_list = cur -> next_free;
+	num_allocated++;
+	return new (cur -> event) Event(type, logical_address, size, start_time);
+}
+
+void Event_pool::free(Event *event)
+{
+	assert(event != NULL && num_allocated > 0);
+	event -> ~Event();
+	slot *cur = (slot *) event;
+	cur -> next_free = free_list;
+	free_list = cur;
+	num_allocated--;
+	return;
+}
+
+ulong Event_pool::get_num_allocated(void) const
+{
+	return num_allocated;
+}
+
+ulong Event_pool::get_num_slabs(void) const
+{
+	return slabs.size();
+}
+
+/* allocate another slab and thread its slots onto the free list */
+void Event_pool::grow(void)
+{
+	slot *slab = (slot *) malloc(slab_size * sizeof(slot));
+	if(slab == NULL)
+	{
+		fprintf(stderr, "Event_pool error: %s: unable to allocate Event slab\n", __func__);
+		exit(MEM_ERR);
+	}
+	slabs.push_back(slab);
+	for(uint i = 0; i < slab_size; i++)
+	{
+		slab[i].next_free = free_list;
+		free_list = &slab[i];
+	}
+	return;
+}
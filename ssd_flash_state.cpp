@@ -0,0 +1,233 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_flash_state.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Flash_state class
+ *
+ * Flat store for the page states and block metadata of the whole SSD.  A page
+ * state takes 2 bits, so a word of the bitmap holds the states of 32 pages and
+ * a block of 64 pages costs 16 bytes of page state plus its metadata.  EMPTY
+ * is 0, so a zeroed bitmap is an erased block.  With PAGE_ENABLE_DATA the
+ * store also maps the memory holding the contents of the pages.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+#define PAGE_STATE_BITS 2
+#define PAGE_STATE_MASK 3UL
+#define PAGES_PER_WORD (sizeof(ulong) * 8 / PAGE_STATE_BITS)
+
+/* low bit of every page state in a word */
+#define PAGE_STATE_LOW_BITS 0x5555555555555555UL
+
+Flash_state::Flash_state(ulong num_blocks, uint block_size, uint erases_remaining, uint page_size, bool enable_data):
+	pages_valid((uint *) calloc(num_blocks, sizeof(uint))),
+	pages_invalid((uint *) calloc(num_blocks, sizeof(uint))),
+	erases_remaining((uint *) malloc(num_blocks * sizeof(uint))),
+	last_erase_time((double *) malloc(num_blocks * sizeof(double))),
+	modification_time((double *) malloc(num_blocks * sizeof(double))),
+
+	/* every block starts FREE and as a LOG block, which are both 0 */
+	block_state((unsigned char *) calloc(num_blocks, sizeof(unsigned char))),
+	block_type((unsigned char *) calloc(num_blocks, sizeof(unsigned char))),
+
+	num_blocks(num_blocks),
+	block_size(block_size),
+	words_per_block((block_size + PAGES_PER_WORD - 1) / PAGES_PER_WORD),
+
+	/* all pages start EMPTY */
+	page_states((ulong *) calloc(num_blocks * words_per_block, sizeof(ulong))),
+
+	page_size(page_size),
+	page_data(NULL),
+	result_buffer(NULL)
+{
+	ulong i;
+
+	if(pages_valid == NULL || pages_invalid == NULL || this -> erases_remaining == NULL || last_erase_time == NULL || modification_time == NULL || block_state == NULL || block_type == NULL || page_states == NULL)
+	{
+		fprintf(stderr, "Flash_state error: %s: constructor unable to allocate state for %lu blocks\n", __func__, num_blocks);
+		exit(MEM_ERR);
+	}
+
+	for(i = 0; i < num_blocks; i++)
+	{
+		this -> erases_remaining[i] = erases_remaining;
+
+		/* assume hardware created at time 0 and had an implied free erasure */
+		last_erase_time[i] = 0.0;
+		modification_time[i] = -1;
+	}
+
+	// Check for 32bit machine. We do not allow page data on 32bit machines.
+	if (enable_data && sizeof(void*) == 4)
+	{
+		fprintf(stderr, "Flash_state error: %s: The simulator requires a 64bit kernel when using data pages.\n", __func__);
+		exit(MEM_ERR);
+	}
+
+	if (enable_data)
+	{
+		/* Allocate memory for data pages */
+#ifdef __APPLE__
+		page_data = mmap(NULL, get_data_size(), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+#else
+		page_data = mmap64(NULL, get_data_size(), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1 ,0);
+#endif
+
+		if (page_data == MAP_FAILED)
+		{
+			fprintf(stderr, "Flash_state error: %s: constructor unable to allocate page data: %s\n", __func__, strerror(errno));
+			exit(MEM_ERR);
+		}
+	}
+	return;
+}
+
+Flash_state::~Flash_state(void)
+{
+	free(pages_valid);
+	free(pages_invalid);
+	free(erases_remaining);
+	free(last_erase_time);
+	free(modification_time);
+	free(block_state);
+	free(block_type);
+	free(page_states);
+	if (page_data != NULL)
+		munmap(page_data, get_data_size());
+	return;
+}
+
+enum page_state Flash_state::get_page_state(ulong block, uint page) const
+{
+	assert(block < num_blocks && page < block_size);
+	ulong word = page_states[block * words_per_block + page / PAGES_PER_WORD];
+	return (enum page_state) ((word >> (page % PAGES_PER_WORD * PAGE_STATE_BITS)) & PAGE_STATE_MASK);
+}
+
+void Flash_state::set_page_state(ulong block, uint page, enum page_state state)
+{
+	assert(block < num_blocks && page < block_size);
+	ulong &word = page_states[block * words_per_block + page / PAGES_PER_WORD];
+	uint shift = page % PAGES_PER_WORD * PAGE_STATE_BITS;
+	word = (word & ~(PAGE_STATE_MASK << shift)) | ((ulong) state << shift);
+	return;
+}
+
+/* set the states of all pages in the block to EMPTY */
+void Flash_state::erase_pages(ulong block)
+{
+	assert(block < num_blocks);
+	memset(&page_states[block * words_per_block], 0, words_per_block * sizeof(ulong));
+	return;
+}
+
+/* find the first EMPTY page in the block a word (32 pages) at a time
+ * a page is EMPTY when both of its state bits are clear */
+enum status Flash_state::find_empty_page(ulong block, uint &page) const
+{
+	assert(block < num_blocks);
+	const ulong *words = &page_states[block * words_per_block];
+	uint i;
+
+	for(i = 0; i < words_per_block; i++)
+	{
+		ulong empty = ~(words[i] | (words[i] >> 1)) & PAGE_STATE_LOW_BITS;
+		if(empty != 0)
+		{
+			/* bits past the end of the block are always clear */
+			page = i * PAGES_PER_WORD + __builtin_ctzl(empty) / PAGE_STATE_BITS;
+			return page < block_size ? SUCCESS : FAILURE;
+		}
+	}
+	return FAILURE;
+}
+
+ssd::ulong Flash_state::get_num_blocks(void) const
+{
+	return num_blocks;
+}
+
+ssd::uint Flash_state::get_block_size(void) const
+{
+	return block_size;
+}
+
+/* bytes used for page states and block metadata */
+ssd::ulong Flash_state::get_memory_size(void) const
+{
+	return num_blocks * (words_per_block * sizeof(ulong) + 3 * sizeof(uint) + 2 * sizeof(double) + 2 * sizeof(unsigned char));
+}
+
+/* returns the data of the page at the physical page address or NULL when
+ * pages do not hold data */
+void *Flash_state::get_page_data(ulong page) const
+{
+	if (page_data == NULL)
+		return NULL;
+	assert(page < num_blocks * block_size);
+	return (char *) page_data + page * page_size;
+}
+
+void *Flash_state::get_result_buffer(void) const
+{
+	return result_buffer;
+}
+
+void Flash_state::set_result_buffer(void *buffer)
+{
+	result_buffer = buffer;
+}
+
+ssd::ulong Flash_state::get_data_size(void) const
+{
+	return num_blocks * block_size * (ulong) page_size;
+}
+
+/* only the data of valid pages is kept, the rest of the page data is
+ * whatever was last written there and is never read back */
+void Flash_state::snapshot(Snapshot &snapshot)
+{
+	snapshot.section("flash");
+	snapshot.io_array(pages_valid, num_blocks);
+	snapshot.io_array(pages_invalid, num_blocks);
+	snapshot.io_array(erases_remaining, num_blocks);
+	snapshot.io_array(last_erase_time, num_blocks);
+	snapshot.io_array(modification_time, num_blocks);
+	snapshot.io_array(block_state, num_blocks);
+	snapshot.io_array(block_type, num_blocks);
+	snapshot.io_array(page_states, num_blocks * words_per_block);
+
+	if(page_data == NULL)
+		return;
+	snapshot.section("data");
+	for(ulong block = 0; block < num_blocks; block++)
+		for(uint page = 0; page < block_size; page++)
+			if(get_page_state(block, page) == VALID)
+				snapshot.io(get_page_data(block * block_size + page), page_size);
+	return;
+}
@@ -21,17 +21,14 @@
  * Implements parent interface for all FTL implementations to use.
  */
 
+#include <assert.h>
 #include "ssd.h"
 
 using namespace ssd;
 
-// Initialization of the block layer.
-Block_manager *Block_manager::inst = NULL;
-
-FtlParent::FtlParent(Controller &controller) : controller(controller)
+// Each FTL has the block manager of its own Ssd.
+FtlParent::FtlParent(Controller &controller) : controller(controller), manager(this)
 {
-	Block_manager::instance_initialize(this);
-
 	printf("Number of addressable blocks: %u\n", NUMBER_OF_ADDRESSABLE_BLOCKS);
 
 }
@@ -73,3 +70,15 @@ void FtlParent::print_ftl_statistics()
 {
 	return;
 }
+
+Block_manager &FtlParent::get_block_manager(void)
+{
+	return manager;
+}
+
+void FtlParent::snapshot(Snapshot &snapshot)
+{
+	snapshot.section("ftl");
+	snapshot.io(copycnt);
+	manager.snapshot(snapshot);
+}
@@ -0,0 +1,270 @@
+/* Copyright 2011 Matias Bjørling */
+
+/* Garbage collection victim policies
+ *
+ * Pick the blocks the Block_manager collects (GC_POLICY). Greedy takes the
+ * block with the most invalid pages from the Block_cost_index in constant
+ * time. Cost-benefit and CAT weigh the invalid pages against the age of the
+ * data and scan all blocks, as their scores change with time. d-choices and
+ * windowed greedy look at a few blocks only.
+ */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Gc_policy *Gc_policy::create(const Block_cost_index &index)
+{
+	switch (GC_POLICY)
+	{
+	case 0:
+		return new Gc_policy_Greedy(index);
+	case 1:
+		return new Gc_policy_CostBenefit(index);
+	case 2:
+		return new Gc_policy_Cat(index);
+	case 3:
+		return new Gc_policy_DChoices(index);
+	case 4:
+		return new Gc_policy_Window(index);
+	}
+	fprintf(stderr, "Gc_policy error: %s: unknown GC_POLICY %u\n", __func__, GC_POLICY);
+	exit(FILE_ERR);
+}
+
+Gc_policy::Gc_policy(const Block_cost_index &index):
+	index(index)
+{
+}
+
+Gc_policy::~Gc_policy(void)
+{
+}
+
+void Gc_policy::allocated(Block *block)
+{
+}
+
+void Gc_policy::erased(Block *block)
+{
+}
+
+// State of the policy beyond the blocks
+void Gc_policy::snapshot(Snapshot &snapshot)
+{
+}
+
+bool Gc_policy::is_candidate(const Block *block, long writing_block) const
+{
+	return block->get_pages_valid() == BLOCK_SIZE && block->get_pages_invalid() > 0
+		&& (long) block->get_physical_address() != writing_block;
+}
+
+// The last block of the cost index, or the one before it when that is being
+// written
+Block *Gc_policy::greedy(long writing_block) const
+{
+	Block *block = index.last();
+	if (block != NULL && (long) block->get_physical_address() == writing_block)
+		block = index.previous(block);
+	if (block == NULL || !is_candidate(block, writing_block))
+		return NULL;
+	return block;
+}
+
+Gc_policy_Greedy::Gc_policy_Greedy(const Block_cost_index &index):
+	Gc_policy(index)
+{
+}
+
+Block *Gc_policy_Greedy::victim(long writing_block, double time)
+{
+	return greedy(writing_block);
+}
+
+const char *Gc_policy_Greedy::name(void) const
+{
+	return "greedy";
+}
+
+Gc_policy_CostBenefit::Gc_policy_CostBenefit(const Block_cost_index &index):
+	Gc_policy(index)
+{
+}
+
+// A block without valid pages costs nothing to collect and is taken first
+Block *Gc_policy_CostBenefit::victim(long writing_block, double time)
+{
+	Block *best = NULL;
+	double best_score = -1.0;
+	for (uint i = 0; i < index.size(); i++)
+	{
+		Block *block = index.get_block(i);
+		if (!is_candidate(block, writing_block))
+			continue;
+
+		uint invalid = block->get_pages_invalid();
+		if (invalid == BLOCK_SIZE)
+			return block;
+
+		double age = time - block->get_modification_time();
+		double score = age * invalid / (BLOCK_SIZE - invalid);
+		if (score > best_score)
+		{
+			best = block;
+			best_score = score;
+		}
+	}
+	return best;
+}
+
+const char *Gc_policy_CostBenefit::name(void) const
+{
+	return "cost-benefit";
+}
+
+Gc_policy_Cat::Gc_policy_Cat(const Block_cost_index &index):
+	Gc_policy(index)
+{
+}
+
+Block *Gc_policy_Cat::victim(long writing_block, double time)
+{
+	Block *best = NULL;
+	double best_score = -1.0;
+	for (uint i = 0; i < index.size(); i++)
+	{
+		Block *block = index.get_block(i);
+		if (!is_candidate(block, writing_block))
+			continue;
+
+		uint invalid = block->get_pages_invalid();
+		if (invalid == BLOCK_SIZE)
+			return block;
+
+		double age = time - block->get_modification_time();
+		double erases = BLOCK_ERASES - block->get_erases_remaining() + 1;
+		double score = age * invalid / ((BLOCK_SIZE - invalid) * erases);
+		if (score > best_score)
+		{
+			best = block;
+			best_score = score;
+		}
+	}
+	return best;
+}
+
+const char *Gc_policy_Cat::name(void) const
+{
+	return "CAT";
+}
+
+Gc_policy_DChoices::Gc_policy_DChoices(const Block_cost_index &index):
+	Gc_policy(index),
+	seed(42)
+{
+}
+
+Block *Gc_policy_DChoices::victim(long writing_block, double time)
+{
+	Block *best = NULL;
+	for (uint i = 0; i < GC_CHOICES; i++)
+	{
+		Block *block = index.get_block(next_random(seed) % index.size());
+		if (is_candidate(block, writing_block) && (best == NULL || block->get_pages_invalid() > best->get_pages_invalid()))
+			best = block;
+	}
+	return best != NULL ? best : greedy(writing_block);
+}
+
+const char *Gc_policy_DChoices::name(void) const
+{
+	return "d-choices";
+}
+
+void Gc_policy_DChoices::snapshot(Snapshot &snapshot)
+{
+	snapshot.io(seed);
+}
+
+Gc_policy_Window::Gc_policy_Window(const Block_cost_index &index):
+	Gc_policy(index)
+{
+}
+
+void Gc_policy_Window::allocated(Block *block)
+{
+	uint i = block->get_physical_address() / BLOCK_SIZE;
+	if (allocations.size() <= i)
+		allocations.resize(index.size());
+	allocations[i]++;
+	order.push_back(std::make_pair(i, allocations[i]));
+
+	// Entries of blocks erased behind the front pile up, drop them
+	if (order.size() > 2 * allocations.size())
+	{
+		std::deque<std::pair<uint, ulong> > live;
+		for (uint j = 0; j < order.size(); j++)
+			if (allocations[order[j].first] == order[j].second)
+				live.push_back(order[j]);
+		order.swap(live);
+	}
+}
+
+// Makes the entry of block stale
+void Gc_policy_Window::erased(Block *block)
+{
+	uint i = block->get_physical_address() / BLOCK_SIZE;
+	if (i < allocations.size())
+		allocations[i]++;
+}
+
+Block *Gc_policy_Window::victim(long writing_block, double time)
+{
+	while (!order.empty() && allocations[order.front().first] != order.front().second)
+		order.pop_front();
+
+	Block *best = NULL;
+	uint window = 0;
+	for (uint j = 0; j < order.size() && window < GC_WINDOW; j++)
+	{
+		if (allocations[order[j].first] != order[j].second)
+			continue;
+		Block *block = index.get_block(order[j].first);
+		if (block->get_pages_valid() != BLOCK_SIZE)
+			continue;
+		window++;
+		if (is_candidate(block, writing_block) && (best == NULL || block->get_pages_invalid() > best->get_pages_invalid()))
+			best = block;
+	}
+	return best != NULL ? best : greedy(writing_block);
+}
+
+const char *Gc_policy_Window::name(void) const
+{
+	return "windowed greedy";
+}
+
+void Gc_policy_Window::snapshot(Snapshot &snapshot)
+{
+	std::vector<uint> blocks;
+	std::vector<ulong> counts;
+	for (uint j = 0; j < order.size(); j++)
+	{
+		blocks.push_back(order[j].first);
+		counts.push_back(order[j].second);
+	}
+	snapshot.io_vector(blocks);
+	snapshot.io_vector(counts);
+	snapshot.io_vector(allocations);
+	if (snapshot.is_saving())
+		return;
+
+	order.clear();
+	for (uint j = 0; j < blocks.size(); j++)
+		order.push_back(std::make_pair(blocks[j], counts[j]));
+}
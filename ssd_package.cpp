@@ -32,7 +32,7 @@
 
 using namespace ssd;
 
-Package::Package(const ssd::Ssd &parent, Channel &channel, uint package_size, long physical_address):
+Package::Package(const ssd::Ssd &parent, Channel &channel, Flash_state &store, Block_manager &manager, uint package_size, long physical_address):
 	size(package_size),
 
 	/* use a const pointer (Die * const data) to use as an array
@@ -66,7 +66,7 @@ Package::Package(const ssd::Ssd &parent, Channel &channel, uint package_size, lo
 	}
 
 	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Die(*this, channel, DIE_SIZE, physical_address+(DIE_SIZE*PLANE_SIZE*BLOCK_SIZE*i));
+		(void) new (&data[i]) Die(*this, channel, store, manager, DIE_SIZE, physical_address+(DIE_SIZE*PLANE_SIZE*BLOCK_SIZE*i));
 
 	return;
 }
@@ -89,6 +89,13 @@ enum status Package::read(Event &event)
 	return data[event.get_address().die].read(event);
 }
 
+void Package::read_out(const Event &event)
+{
+	assert(data != NULL && event.get_address().die < size && event.get_address().valid > PACKAGE);
+	data[event.get_address().die].read_out(event);
+	return;
+}
+
 enum status Package::write(Event &event)
 {
 	assert(data != NULL && event.get_address().die < size && event.get_address().valid > PACKAGE);
@@ -204,8 +211,31 @@ ssd::uint Package::get_num_valid(const Address &address) const
 	return data[address.die].get_num_valid(address);
 }
 
+double Package::get_ready_time(const Address &address) const
+{
+	assert(data != NULL && address.die < size && address.valid >= DIE);
+	return data[address.die].get_ready_time(address);
+}
+
+double Package::get_ready_time(const Event &event) const
+{
+	assert(data != NULL && event.get_address().die < size && event.get_address().valid >= DIE);
+	return data[event.get_address().die].get_ready_time(event);
+}
+
 Block *Package::get_block_pointer(const Address & address)
 {
 	assert(address.valid >= DIE);
 	return data[address.die].get_block_pointer(address);
 }
+
+void Package::snapshot(Snapshot &snapshot)
+{
+	snapshot.section("package");
+	snapshot.io(least_worn);
+	snapshot.io(erases_remaining);
+	snapshot.io(last_erase_time);
+	for(uint i = 0; i < size; i++)
+		data[i].snapshot(snapshot);
+	return;
+}
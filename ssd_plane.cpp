@@ -31,7 +31,7 @@
 
 using namespace ssd;
 
-Plane::Plane(const Die &parent, uint plane_size, double reg_read_delay, double reg_write_delay, long physical_address):
+Plane::Plane(const Die &parent, Flash_state &store, Block_manager &manager, uint plane_size, double reg_read_delay, double reg_write_delay, long physical_address):
 	size(plane_size),
 
 	/* use a const pointer (Block * const data) to use as an array
@@ -49,7 +49,10 @@ Plane::Plane(const Die &parent, uint plane_size, double reg_read_delay, double r
 	/* assume hardware created at time 0 and had an implied free erasure */
 	last_erase_time(0.0),
 
-	free_blocks(size)
+	free_blocks(size),
+
+	/* assume hardware created at time 0 and is idle */
+	ready_at(0.0)
 {
 	uint i;
 
@@ -91,7 +94,7 @@ Plane::Plane(const Die &parent, uint plane_size, double reg_read_delay, double r
 
 	for(i = 0; i < size; i++)
 	{
-		(void) new (&data[i]) Block(*this, BLOCK_SIZE, BLOCK_ERASES, BLOCK_ERASE_DELAY,physical_address+(i*BLOCK_SIZE));
+		(void) new (&data[i]) Block(*this, store, manager, physical_address+(i*BLOCK_SIZE));
 	}
 
 
@@ -110,16 +113,31 @@ Plane::~Plane(void)
 	return;
 }
 
+/* in cache read mode the page is copied on to the cache register, which
+ * 	frees the data register for the next read of the plane */
 enum status Plane::read(Event &event)
 {
 	assert(event.get_address().block < size && event.get_address().valid > PLANE);
-	return data[event.get_address().block].read(event);
+	enum status status = data[event.get_address().block].read(event);
+	if(parent.is_functional())
+		return status;
+	if(PLANE_CACHE_READ)
+		(void) event.incr_time_taken(reg_read_delay);
+	ready_at = event.get_start_time() + event.get_time_taken();
+	return status;
 }
 
+/* in cache program mode the page arrives in the cache register and is copied
+ * 	to the data register before it is programmed, which frees the cache
+ * 	register for the next write to the plane */
 enum status Plane::write(Event &event)
 {
 	assert(event.get_address().block < size && event.get_address().valid > PLANE && next_page.valid >= BLOCK);
 
+	bool functional = parent.is_functional();
+	if(PLANE_CACHE_PROGRAM && !functional)
+		(void) event.incr_time_taken(reg_write_delay);
+
 	enum block_state prev = data[event.get_address().block].get_state();
 
 	status s = data[event.get_address().block].write(event);
@@ -132,6 +150,8 @@ enum status Plane::write(Event &event)
 	if(prev == FREE && data[event.get_address().block].get_state() != FREE)
 		free_blocks--;
 
+	if(!functional)
+		ready_at = event.get_start_time() + event.get_time_taken();
 	return s;
 }
 
@@ -161,6 +181,8 @@ enum status Plane::erase(Event &event)
 		if(next_page.valid < PAGE)
 			(void) get_next_page();
 	}
+	if(!parent.is_functional())
+		ready_at = event.get_start_time() + event.get_time_taken();
 	return status;
 }
 
@@ -259,6 +281,8 @@ enum status Plane::_merge(Event &event)
 	}
 	total_delay += read_event.get_time_taken() + write_event.get_time_taken();
 	event.incr_time_taken(total_delay);
+	if(!parent.is_functional())
+		ready_at = event.get_start_time() + event.get_time_taken();
 
 	/* update next_page for the get_free_page method if we used the page */
 	if(next_page.valid < PAGE)
@@ -398,8 +422,27 @@ ssd::uint Plane::get_num_invalid(const Address & address) const
 	return data[address.block].get_pages_invalid();
 }
 
+/* time when the plane finishes its last array operation
+ * the die uses this together with its own timeline to hold back commands */
+double Plane::get_ready_time(void) const
+{
+	return ready_at;
+}
+
 Block *Plane::get_block_pointer(const Address & address)
 {
 	assert(address.valid >= PLANE);
 	return data[address.block].get_pointer();
 }
+
+/* the blocks are views on the flash state, which the Ssd saves as a whole */
+void Plane::snapshot(Snapshot &snapshot)
+{
+	snapshot.io(least_worn);
+	snapshot.io(erases_remaining);
+	snapshot.io(last_erase_time);
+	snapshot.io_address(next_page);
+	snapshot.io(free_blocks);
+	snapshot.io(ready_at);
+	return;
+}
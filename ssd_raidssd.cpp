@@ -19,6 +19,10 @@
  * Matias Bjørling 2012-01-09
  *
  * The Raid SSD is responsible for raiding multiple SSDs together using different mapping techniques.
+ *
+ * Each member Ssd can run in its own worker thread.  A striped request is
+ * submitted to all workers at once and completes when the slowest member
+ * does, so an array of N members takes about as long to simulate as one Ssd.
  */
 
 #include <cmath>
@@ -34,11 +38,104 @@
 
 using namespace ssd;
 
+/* spin this many times on an empty ring before yielding the processor
+ * spinning only helps when the other side runs on another processor */
+static const uint spin_limit = std::thread::hardware_concurrency() > 1 ? 1024 : 0;
+
+Raid_worker::Raid_worker(Ssd &ssd, uint ring_size):
+	ssd(ssd),
+	requests(ring_size),
+	results(ring_size),
+	stopping(false),
+	sleeping(false),
+
+	/* start the thread last, after everything it uses is initialized */
+	thread(&Raid_worker::run, this)
+{
+	return;
+}
+
+Raid_worker::~Raid_worker(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping.store(true, std::memory_order_release);
+	}
+	wake.notify_one();
+	thread.join();
+	return;
+}
+
+/* a sleeping worker is woken under the mutex, so the wake-up cannot fall
+ * between its last look at the ring and its wait */
+void Raid_worker::submit(const Raid_request &request)
+{
+	for (uint spins = 0; !requests.push(request); spins++)
+		if (spins >= spin_limit)
+			std::this_thread::yield();
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		wake.notify_one();
+	}
+	return;
+}
+
+/* wait for the oldest submitted request and return its time taken */
+double Raid_worker::complete(void)
+{
+	double time_taken;
+	for (uint spins = 0; !results.pop(time_taken); spins++)
+		if (spins >= spin_limit)
+			std::this_thread::yield();
+	return time_taken;
+}
+
+/* the Ssd applies its own configuration to this thread in event_arrive
+ * an idle worker spins for spin_limit tries and then sleeps until submit or
+ * the destructor wakes it */
+void Raid_worker::run(void)
+{
+	Raid_request request;
+	uint spins = 0;
+
+	while (true)
+	{
+		if (!requests.pop(request))
+		{
+			if (stopping.load(std::memory_order_acquire) && requests.empty())
+				return;
+			if (++spins < spin_limit)
+				continue;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			wake.wait(lock, [this] { return !requests.empty() || stopping.load(std::memory_order_acquire); });
+			sleeping.store(false, std::memory_order_relaxed);
+			spins = 0;
+			continue;
+		}
+		spins = 0;
+
+		double time_taken = ssd.event_arrive(request.type, request.logical_address, request.size, request.start_time, request.buffer);
+		while (!results.push(time_taken))
+			std::this_thread::yield();
+	}
+}
+
 /* use caution when editing the initialization list - initialization actually
  * occurs in the order of declaration in the class definition and not in the
  * order listed here */
-RaidSsd::RaidSsd(uint ssd_size):
-	size(ssd_size)
+RaidSsd::RaidSsd(uint ssd_size, bool parallel):
+	size(ssd_size),
+	last_ssd(NULL),
+	num_reads(0),
+	num_writes(0),
+	num_other(0),
+	num_member_requests(0),
+	num_timing_mismatches(0)
 {
 /*
  * Idea
@@ -53,11 +150,21 @@ RaidSsd::RaidSsd(uint ssd_size):
  */
 	Ssds = new Ssd[RAID_NUMBER_OF_PHYSICAL_SSDS];
 
+	if (parallel && PARALLELISM_MODE == 1)
+		for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+			workers.push_back(new Raid_worker(Ssds[i]));
+
 	return;
 }
 
 RaidSsd::~RaidSsd(void)
 {
+	Config_scope scope(config);
+
+	/* stop the workers before their Ssds go away */
+	for (uint i = 0; i < workers.size(); i++)
+		delete workers[i];
+	delete[] Ssds;
 	return;
 }
 
@@ -66,6 +173,12 @@ double RaidSsd::event_arrive(enum event_type type, ulong logical_address, uint s
 	return event_arrive(type, logical_address, size, start_time, NULL);
 }
 
+/* run a request on one member on the calling thread */
+double RaidSsd::run(uint member, const Raid_request &request)
+{
+	return Ssds[member].event_arrive(request.type, request.logical_address, request.size, request.start_time, request.buffer);
+}
+
 /* This is the function that will be called by DiskSim
  * Provide the event (request) type (see enum in ssd.h),
  * 	logical_address (page number), size of request in pages, and the start
@@ -74,49 +187,102 @@ double RaidSsd::event_arrive(enum event_type type, ulong logical_address, uint s
  * 	request.  Remember to use the same time units as in the config file. */
 double RaidSsd::event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer)
 {
+	Config_scope scope(config);
+
 	if (type == WRITE)
-		printf("Writing to logical address: %lu\n", logical_address);
+		num_writes++;
 	else if (type == READ)
-		printf("Read from logical address: %lu\n", logical_address);
+		num_reads++;
+	else
+		num_other++;
+
+	Raid_request request;
+	request.type = type;
+	request.logical_address = logical_address;
+	request.size = size;
+	request.start_time = start_time;
 
 	if (PARALLELISM_MODE == 1) // Striping
 	{
-		double timings[RAID_NUMBER_OF_PHYSICAL_SSDS];
-		for (int i=0;i<RAID_NUMBER_OF_PHYSICAL_SSDS;i++)
-		{
-			if (buffer == NULL)
-			{
-				printf("Executing stage: %i\n", i);
-				timings[i] = Ssds[i].event_arrive(type, logical_address, size, start_time, NULL);
-			}
+		uint members = RAID_NUMBER_OF_PHYSICAL_SSDS;
+		double timings[members];
 
+		/* fan out to all members first so they run at the same time */
+		for (uint i = 0; i < members; i++)
+		{
+			request.buffer = buffer == NULL ? NULL : (char*)buffer + (i*PAGE_SIZE);
+			if (workers.empty())
+				timings[i] = run(i, request);
 			else
-				timings[i] = Ssds[i].event_arrive(type, logical_address, size, start_time, (char*)buffer +(i*PAGE_SIZE));
-
+				workers[i]->submit(request);
 		}
+		if (!workers.empty())
+			for (uint i = 0; i < members; i++)
+				timings[i] = workers[i]->complete();
+		num_member_requests += members;
 
-		for (int i=0;i<RAID_NUMBER_OF_PHYSICAL_SSDS-1;i++)
+		/* the request completes with the slowest member */
+		double time_taken = timings[0];
+		for (uint i = 1; i < members; i++)
 		{
-			if (timings[i] != timings[i+1])
-				fprintf(stderr, "ERROR: Timings are not the same. %d %d\n", timings[i], timings[i+1]);
+			if (timings[i] != timings[0])
+				num_timing_mismatches++;
+			if (timings[i] > time_taken)
+				time_taken = timings[i];
 		}
 
-		return timings[0];
+		last_ssd = &Ssds[0];
+		return time_taken;
 	}
 	else if (PARALLELISM_MODE == 2) // Splitted address space
 	{
-		return Ssds[logical_address%RAID_NUMBER_OF_PHYSICAL_SSDS].event_arrive(type, logical_address, size, start_time, (char*)buffer);
+		uint member = logical_address%RAID_NUMBER_OF_PHYSICAL_SSDS;
+		request.buffer = buffer;
+		num_member_requests++;
+		last_ssd = &Ssds[member];
+		return run(member, request);
 	}
 
 	return 0;
 }
 
 /*
- * Returns a pointer to the global buffer of the Ssd.
+ * Returns a pointer to the data read by the last read request.
  * It is up to the user to not read out of bound and only
  * read the intended size. i.e. the page size.
  */
 void *RaidSsd::get_result_buffer()
 {
-	return global_buffer;
+	if (last_ssd == NULL)
+		return NULL;
+	return last_ssd->get_result_buffer();
+}
+
+void RaidSsd::print_statistics()
+{
+	Config_scope scope(config);
+	printf("RAID statistics:\n");
+	printf("-----------------\n");
+	printf("Members: %u (%s)\n", RAID_NUMBER_OF_PHYSICAL_SSDS, workers.empty() ? "serial" : "parallel");
+	printf("Reads: %lu Writes: %lu Other: %lu\n", num_reads, num_writes, num_other);
+	printf("Member requests: %lu\n", num_member_requests);
+	printf("Striped requests with differing member timings: %lu\n", num_timing_mismatches);
+	printf("-----------------\n");
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+	{
+		printf("Member %u:\n", i);
+		Ssds[i].print_statistics();
+	}
+}
+
+void RaidSsd::reset_statistics()
+{
+	Config_scope scope(config);
+	num_reads = 0;
+	num_writes = 0;
+	num_other = 0;
+	num_member_requests = 0;
+	num_timing_mismatches = 0;
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+		Ssds[i].reset_statistics();
 }
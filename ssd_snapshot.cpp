@@ -0,0 +1,247 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_snapshot.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Snapshot class
+ *
+ * Reads and writes the image behind Ssd::save_snapshot and load_snapshot.  The
+ * image is a header followed by the raw state of the components, each part
+ * preceded by a section tag so an image of a different layout fails with the
+ * name of the first part that does not match instead of loading garbage.
+ * Loading maps the image read-only and copies out of the mapping.  Values are
+ * in host byte order.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+#define SNAPSHOT_MAGIC "FSSNAP"
+#define SNAPSHOT_MAGIC_SIZE 8
+#define SNAPSHOT_VERSION 14
+#define SNAPSHOT_SECTION_SIZE 8
+
+/* configuration variables the state depends on */
+#define SNAPSHOT_CONFIG_SIZE 23
+
+static void snapshot_config(uint *config)
+{
+	uint values[SNAPSHOT_CONFIG_SIZE] = {SSD_SIZE, PACKAGE_SIZE, DIE_SIZE, MULTI_PLANE, PLANE_SIZE, BLOCK_SIZE, PAGE_SIZE, PAGE_ENABLE_DATA, MAP_DIRECTORY_SIZE, FTL_IMPLEMENTATION, BAST_LOG_BLOCK_LIMIT, BAST_LOG_VICTIM, FAST_LOG_BLOCK_LIMIT, CACHE_DFTL_LIMIT, CACHE_DFTL_POLICY, GC_POLICY, GC_CHOICES, GC_WINDOW, BLOCK_ALLOCATION, VIRTUAL_BLOCK_SIZE, VIRTUAL_PAGE_SIZE, NUMBER_OF_ADDRESSABLE_BLOCKS, PARALLELISM_MODE};
+	memcpy(config, values, sizeof(values));
+}
+
+static const char *snapshot_config_names[SNAPSHOT_CONFIG_SIZE] = {"SSD_SIZE", "PACKAGE_SIZE", "DIE_SIZE", "MULTI_PLANE", "PLANE_SIZE", "BLOCK_SIZE", "PAGE_SIZE", "PAGE_ENABLE_DATA", "MAP_DIRECTORY_SIZE", "FTL_IMPLEMENTATION", "BAST_LOG_BLOCK_LIMIT", "BAST_LOG_VICTIM", "FAST_LOG_BLOCK_LIMIT", "CACHE_DFTL_LIMIT", "CACHE_DFTL_POLICY", "GC_POLICY", "GC_CHOICES", "GC_WINDOW", "BLOCK_ALLOCATION", "VIRTUAL_BLOCK_SIZE", "VIRTUAL_PAGE_SIZE", "NUMBER_OF_ADDRESSABLE_BLOCKS", "PARALLELISM_MODE"};
+
+struct snapshot_header
+{
+	char magic[SNAPSHOT_MAGIC_SIZE];
+	uint version;
+	uint config[SNAPSHOT_CONFIG_SIZE];
+};
+
+/* the header is written or checked against the configuration of the calling
+ * thread */
+Snapshot::Snapshot(const char *filename, bool saving):
+	filename(strdup(filename)),
+	saving(saving),
+	file(NULL),
+	map(NULL),
+	map_size(0),
+	offset(0)
+{
+	snapshot_header header;
+	memset(&header, 0, sizeof(snapshot_header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = SNAPSHOT_VERSION;
+	snapshot_config(header.config);
+
+	if(saving)
+	{
+		if((file = fopen(filename, "wb")) == NULL)
+		{
+			fprintf(stderr, "Snapshot error: %s: unable to create \"%s\": %s\n", __func__, filename, strerror(errno));
+			exit(FILE_ERR);
+		}
+		io(header);
+		return;
+	}
+
+	int fd = open(filename, O_RDONLY);
+	struct stat st;
+	if(fd < 0 || fstat(fd, &st) != 0)
+	{
+		fprintf(stderr, "Snapshot error: %s: unable to open \"%s\": %s\n", __func__, filename, strerror(errno));
+		exit(FILE_ERR);
+	}
+	map_size = st.st_size;
+	if(map_size > 0)
+		map = (char *) mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED || map == NULL)
+	{
+		fprintf(stderr, "Snapshot error: %s: unable to map \"%s\": %s\n", __func__, filename, strerror(errno));
+		exit(MEM_ERR);
+	}
+	(void) madvise(map, map_size, MADV_SEQUENTIAL);
+
+	snapshot_header image;
+	if(map_size < sizeof(snapshot_header) || memcmp(map, header.magic, SNAPSHOT_MAGIC_SIZE) != 0)
+	{
+		fprintf(stderr, "Snapshot error: %s: \"%s\" is not a snapshot\n", __func__, filename);
+		exit(FILE_ERR);
+	}
+	io(image);
+	if(image.version != SNAPSHOT_VERSION)
+	{
+		fprintf(stderr, "Snapshot error: %s: \"%s\" is a version %u snapshot, expected version %d\n", __func__, filename, image.version, SNAPSHOT_VERSION);
+		exit(FILE_ERR);
+	}
+	for(uint i = 0; i < SNAPSHOT_CONFIG_SIZE; i++)
+		if(image.config[i] != header.config[i])
+		{
+			fprintf(stderr, "Snapshot error: %s: \"%s\" was taken with %s %u, the configuration has %u\n", __func__, filename, snapshot_config_names[i], image.config[i], header.config[i]);
+			exit(FILE_ERR);
+		}
+	return;
+}
+
+Snapshot::~Snapshot(void)
+{
+	if(file != NULL)
+		fclose(file);
+	if(map != NULL)
+		munmap(map, map_size);
+	free(filename);
+	return;
+}
+
+bool Snapshot::is_saving(void) const
+{
+	return saving;
+}
+
+void Snapshot::io(void *data, ulong size)
+{
+	if(size == 0)
+		return;
+	if(saving)
+	{
+		if(fwrite(data, size, 1, file) != 1)
+		{
+			fprintf(stderr, "Snapshot error: %s: unable to write \"%s\": %s\n", __func__, filename, strerror(errno));
+			exit(FILE_ERR);
+		}
+	}
+	else
+	{
+		if(size > map_size - offset)
+		{
+			fprintf(stderr, "Snapshot error: %s: \"%s\" is truncated\n", __func__, filename);
+			exit(FILE_ERR);
+		}
+		memcpy(data, map + offset, size);
+	}
+	offset += size;
+	return;
+}
+
+/* write or check the tag of the next part of the image */
+void Snapshot::section(const char *name)
+{
+	char tag[SNAPSHOT_SECTION_SIZE];
+	char expected[SNAPSHOT_SECTION_SIZE];
+	memset(expected, 0, SNAPSHOT_SECTION_SIZE);
+	strncpy(expected, name, SNAPSHOT_SECTION_SIZE);
+	memcpy(tag, expected, SNAPSHOT_SECTION_SIZE);
+	io(tag);
+	if(memcmp(tag, expected, SNAPSHOT_SECTION_SIZE) != 0)
+	{
+		fprintf(stderr, "Snapshot error: %s: \"%s\" does not hold the expected %s state at offset %lu\n", __func__, filename, name, offset - SNAPSHOT_SECTION_SIZE);
+		exit(FILE_ERR);
+	}
+	return;
+}
+
+/* blocks are stored as their physical address, -1 for NULL */
+void Snapshot::io_block(Block *&block, FtlParent &ftl)
+{
+	long physical_address = block == NULL ? -1 : block -> get_physical_address();
+	io(physical_address);
+	if(saving)
+		return;
+	if(physical_address < 0)
+		block = NULL;
+	else
+	{
+		Address address;
+		address.set_linear_address(physical_address, BLOCK);
+		block = ftl.get_block_pointer(address);
+	}
+	return;
+}
+
+void Snapshot::io_blocks(std::vector<Block *> &blocks, FtlParent &ftl)
+{
+	ulong count = blocks.size();
+	io(count);
+	if(!saving)
+		blocks.resize(count);
+	for(ulong i = 0; i < count; i++)
+		io_block(blocks[i], ftl);
+	return;
+}
+
+/* addresses are stored packed (see Address::get_packed) */
+void Snapshot::io_address(Address &address)
+{
+	ulong packed = address.get_packed();
+	io(packed);
+	address.set_packed(packed);
+	return;
+}
+
+/* flush the image when saving, check that all of it was read when loading */
+void Snapshot::finish(void)
+{
+	section("end");
+	if(saving)
+	{
+		int failed = fclose(file);
+		file = NULL;
+		if(failed != 0)
+		{
+			fprintf(stderr, "Snapshot error: %s: unable to write \"%s\": %s\n", __func__, filename, strerror(errno));
+			exit(FILE_ERR);
+		}
+	}
+	else if(offset != map_size)
+	{
+		fprintf(stderr, "Snapshot error: %s: \"%s\" has %lu bytes past the end of the state\n", __func__, filename, map_size - offset);
+		exit(FILE_ERR);
+	}
+	return;
+}
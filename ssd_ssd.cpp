@@ -47,6 +47,9 @@ Ssd::Ssd(uint ssd_size):
 	ram(RAM_READ_DELAY, RAM_WRITE_DELAY), 
 	bus(size, BUS_CTRL_DELAY, BUS_DATA_DELAY, BUS_TABLE_SIZE, BUS_MAX_CONNECT), 
 
+	/* page states and block statistics of the whole SSD */
+	flash_state((ulong) ssd_size * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE, BLOCK_SIZE, BLOCK_ERASES),
+
 	/* use a const pointer (Package * const data) to use as an array
 	 * but like a reference, we cannot reseat the pointer */
 	data((Package *) malloc(ssd_size * sizeof(Package))), 
@@ -75,41 +78,18 @@ Ssd::Ssd(uint ssd_size):
 		fprintf(stderr, "Ssd error: %s: constructor unable to allocate Package data\n", __func__);
 		exit(MEM_ERR);
 	}
-	for (i = 0; i < ssd_size; i++)
-	{
-		(void) new (&data[i]) Package(*this, bus.get_channel(i), PACKAGE_SIZE, PACKAGE_SIZE*DIE_SIZE*PLANE_SIZE*BLOCK_SIZE*i);
-	}
-	
-	// Check for 32bit machine. We do not allow page data on 32bit machines.
-	if (PAGE_ENABLE_DATA == 1 && sizeof(void*) == 4)
+
+	/* events store their merge, log and replace addresses packed */
+	if(!Address::packable(ssd_size))
 	{
-		fprintf(stderr, "Ssd error: %s: The simulator requires a 64bit kernel when using data pages. Disabling data pages.\n", __func__);
+		fprintf(stderr, "Ssd error: %s: geometry is too large for packed event addresses\n", __func__);
 		exit(MEM_ERR);
 	}
-
-	if (PAGE_ENABLE_DATA)
+	for (i = 0; i < ssd_size; i++)
 	{
-		/* Allocate memory for data pages */
-		ulong pageSize = ((ulong)(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE)) * (ulong)PAGE_SIZE;
-#ifdef __APPLE__
-		page_data = mmap(NULL, pageSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
-#else
-		page_data = mmap64(NULL, pageSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1 ,0);
-#endif
-
-		if (page_data == MAP_FAILED)
-		{
-			fprintf(stderr, "Ssd error: %s: constructor unable to allocate page data.\n", __func__);
-			switch (errno)
-			{
-			case EACCES:
-				break;
-			}
-			printf("%i\n",errno);
-			exit(MEM_ERR);
-		}
+		(void) new (&data[i]) Package(*this, bus.get_channel(i), flash_state, controller.get_block_manager(), PACKAGE_SIZE, PACKAGE_SIZE*DIE_SIZE*PLANE_SIZE*BLOCK_SIZE*i);
 	}
-
+	
 	assert(VIRTUAL_BLOCK_SIZE > 0);
 	assert(VIRTUAL_PAGE_SIZE > 0);
 
@@ -118,6 +98,7 @@ Ssd::Ssd(uint ssd_size):
 
 Ssd::~Ssd(void)
 {
+	Config_scope scope(config);
 	/* explicitly call destructors and use free
 	 * since we used malloc and placement new */
 	for (uint i = 0; i < size; i++)
@@ -125,8 +106,6 @@ Ssd::~Ssd(void)
 		data[i].~Package();
 	}
 	free(data);
-	ulong pageSize = ((ulong)(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE)) * (ulong)PAGE_SIZE;
-	munmap(page_data, pageSize);
 
 	return;
 }
@@ -141,47 +120,81 @@ double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size,
  * 	logical_address (page number), size of request in pages, and the start
  * 	time (arrive time) of the request
  * The SSD will process the request and return the time taken to process the
- * 	request.  Remember to use the same time units as in the config file. */
+ * 	request.  Remember to use the same time units as in the config file.
+ * A request of several pages covers consecutive logical pages, which are
+ * 	served concurrently (see Controller::event_arrive_pages); the buffer
+ * 	of a write holds their data one after the other and a read copies
+ * 	the pages it reads into it the same way. */
 double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer)
 {
-	assert(start_time >= 0.0);
+	Config_scope scope(config);
+	assert(start_time >= 0.0 && size > 0);
 	if (VIRTUAL_PAGE_SIZE == 1)
-		assert((long long int) logical_address <= (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
+		assert((long long int) (logical_address + size - 1) <= (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
 	else
-		assert((long long int) logical_address*VIRTUAL_PAGE_SIZE <= (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
-
-	/* allocate the event and address dynamically so that the allocator can
-	 * handle efficiency issues for us */
-	Event *event = NULL;
+		assert((long long int) (logical_address + size - 1)*VIRTUAL_PAGE_SIZE <= (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
 
-	if((event = new Event(type, logical_address , size, start_time)) == NULL)
-	{
-		fprintf(stderr, "Ssd error: %s: could not allocate Event\n", __func__);
-		exit(MEM_ERR);
-	}
+	/* take the event from the pool so a request does not cost a heap
+	 * allocation; the pool exits on allocation failure */
+	Event *event = event_pool.alloc(type, logical_address, size, start_time);
 	
 	event->set_payload(buffer);
 
+	/* a read that does not reach a written page has no result */
+	if (type == READ)
+		flash_state.set_result_buffer(NULL);
+
+	/* retire the requests that finished before this one arrived
+	 * what is left in the queue is still in flight at start_time */
+	while(!completions.empty() && completions.top() <= start_time)
+		completions.pop();
+
 	if(controller.event_arrive(*event) != SUCCESS)
 	{
 		fprintf(stderr, "Ssd error: %s: request failed:\n", __func__);
 		event -> print(stderr);
 	}
+	if(type == WRITE)
+		controller.stats.numHostWrite += size;
+
+	/* functional mode has no timing to report (see set_functional) */
+	if(controller.is_functional())
+	{
+		event_pool.free(event);
+		return 0.0;
+	}
+
+	/* the controller has posted every flash operation of the request on the
+	 * 	die and bus timelines, so the request completes at the end of its
+	 * 	last operation */
+	double finish_time = start_time + event -> get_time_taken();
+	completions.push(finish_time);
+
+	Stats &stats = controller.stats;
+	if(stats.numRequests == 0 || start_time < stats.firstArrival)
+		stats.firstArrival = start_time;
+	if(finish_time > stats.lastCompletion)
+		stats.lastCompletion = finish_time;
+	if((long) completions.size() > stats.numOutstandingMax)
+		stats.numOutstandingMax = completions.size();
+	stats.sumLatency += event -> get_time_taken();
+	stats.numRequests++;
 
 	/* use start_time as a temporary for returning time taken to service event */
 	start_time = event -> get_time_taken();
-	delete event;
+	event_pool.free(event);
 	return start_time;
 }
 
 /*
- * Returns a pointer to the global buffer of the Ssd.
+ * Returns a pointer to the data read by the last read request, NULL if it did
+ * not read a page.
  * It is up to the user to not read out of bound and only
  * read the intended size. i.e. the page size.
  */
 void *Ssd::get_result_buffer()
 {
-	return global_buffer;
+	return flash_state.get_result_buffer();
 }
 
 /* read write erase and merge should only pass on the event
@@ -195,6 +208,14 @@ enum status Ssd::read(Event &event)
 	return data[event.get_address().package].read(event);
 }
 
+/* the data of the read event has been transferred out of its die */
+void Ssd::read_out(const Event &event)
+{
+	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
+	data[event.get_address().package].read_out(event);
+	return;
+}
+
 enum status Ssd::write(Event &event)
 {
 	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
@@ -203,11 +224,12 @@ enum status Ssd::write(Event &event)
 
 enum status Ssd::replace(Event &event)
 {
-	if(event.get_replace_address().valid == NONE)
+	if(!event.has_replace_address())
 		return SUCCESS;
-	assert(data != NULL && event.get_replace_address().package < size);
-	if (event.get_replace_address().valid == PAGE)
-		return data[event.get_replace_address().package].replace(event);
+	Address replace_address = event.get_replace_address();
+	assert(data != NULL && replace_address.package < size);
+	if (replace_address.valid == PAGE)
+		return data[replace_address.package].replace(event);
 	else
 		return SUCCESS;
 }
@@ -320,26 +342,31 @@ ssd::uint Ssd::get_num_invalid(const Address &address) const
 
 void Ssd::print_statistics()
 {
+	Config_scope scope(config);
 	controller.stats.print_statistics();
 }
 
 void Ssd::reset_statistics()
 {
+	Config_scope scope(config);
 	controller.stats.reset_statistics();
 }
 
 void Ssd::write_statistics(FILE *stream)
 {
+	Config_scope scope(config);
 	controller.stats.write_statistics(stream);
 }
 
 void Ssd::print_ftl_statistics()
 {
+	Config_scope scope(config);
 	controller.print_ftl_statistics();
 }
 
 void Ssd::write_header(FILE *stream)
 {
+	Config_scope scope(config);
 	controller.stats.write_header(stream);
 }
 
@@ -349,6 +376,20 @@ Block *Ssd::get_block_pointer(const Address & address)
 	return data[address.package].get_block_pointer(address);
 }
 
+double Ssd::get_ready_time(const Address &address) const
+{
+	assert(data != NULL && address.package < size && address.valid >= DIE);
+	return data[address.package].get_ready_time(address);
+}
+
+/* as get_ready_time for the address of the event, earlier when the event can
+ * 	join the multi-plane operation its die is running (see Die::multi_plane) */
+double Ssd::get_ready_time(const Event &event) const
+{
+	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= DIE);
+	return data[event.get_address().package].get_ready_time(event);
+}
+
 const Controller &Ssd::get_controller(void) const
 {
 	return controller;
@@ -359,6 +400,7 @@ const Controller &Ssd::get_controller(void) const
  */
 double Ssd::ready_at(void)
 {
+	Config_scope scope(config);
 	double next_ready_time = std::numeric_limits<double>::max();
 
 	for (int i=0;i<size;i++)
@@ -374,3 +416,76 @@ double Ssd::ready_at(void)
 	else
 		return next_ready_time;
 }
+
+/* In functional mode requests only make the state changes they would make in
+ * 	timed mode: mapping, invalidation, garbage collection and erases all
+ * 	happen, but no request waits for a die, the bus or the RAM and none is
+ * 	counted in the timing statistics; event_arrive returns 0
+ * It is meant for preconditioning the drive before a measurement.  The FTLs
+ * 	make the same decisions in both modes, as none of them depend on time, so
+ * 	the drive ends up in the same state apart from erase and modification
+ * 	times.  Switch back to timed mode before measuring and issue the next
+ * 	requests no earlier than the last request issued in timed mode. */
+void Ssd::set_functional(bool functional)
+{
+	controller.set_functional(functional);
+	return;
+}
+
+bool Ssd::is_functional(void) const
+{
+	return controller.is_functional();
+}
+
+/* Save the state of the simulated drive to an image that load_snapshot can
+ * restore into a new Ssd with the same configuration, e.g. to run
+ * measurements from a preconditioned drive without repeating the writes that
+ * preconditioned it.  time is the simulated time of the caller, which
+ * load_snapshot returns so the caller can carry on from there.  The event pool
+ * and the result buffer are not saved, no request is in flight between calls
+ * to event_arrive. */
+void Ssd::save_snapshot(const char *filename, double time)
+{
+	Config_scope scope(config);
+	Snapshot snapshot(filename, true);
+	this -> snapshot(snapshot, time);
+	snapshot.finish();
+}
+
+double Ssd::load_snapshot(const char *filename)
+{
+	Config_scope scope(config);
+	Snapshot snapshot(filename, false);
+	double time;
+	this -> snapshot(snapshot, time);
+	snapshot.finish();
+	flash_state.set_result_buffer(NULL);
+	return time;
+}
+
+/* the flash state goes first: the block manager orders blocks by their
+ * invalid page count when it loads */
+void Ssd::snapshot(Snapshot &snapshot, double &time)
+{
+	flash_state.snapshot(snapshot);
+	for(uint i = 0; i < size; i++)
+		data[i].snapshot(snapshot);
+	bus.snapshot(snapshot);
+
+	snapshot.section("ssd");
+	snapshot.io(time);
+	snapshot.io(erases_remaining);
+	snapshot.io(least_worn);
+	snapshot.io(last_erase_time);
+
+	/* the queue is saved earliest first */
+	std::vector<double> finish_times;
+	for(; !completions.empty(); completions.pop())
+		finish_times.push_back(completions.top());
+	snapshot.io_vector(finish_times);
+	for(uint i = 0; i < finish_times.size(); i++)
+		completions.push(finish_times[i]);
+
+	controller.snapshot(snapshot);
+	return;
+}
@@ -46,6 +46,8 @@ void Stats::reset()
 	numGCRead = 0;
 	numGCWrite = 0;
 	numGCErase = 0;
+	numGCRuns = 0;
+	sumGCLatency = 0.0;
 
 	// WL
 	numWLRead = 0;
@@ -63,6 +65,10 @@ void Stats::reset()
 	// Cache based FTL's
 	numCacheHits = 0;
 	numCacheFaults = 0;
+	numCacheEvictions = 0;
+	numCacheDirtyEvictions = 0;
+	numCachePrefetches = 0;
+	numCachePrefetchHits = 0;
 
 	// Memory consumptions (Bytes)
 	numMemoryTranslation = 0;
@@ -70,6 +76,42 @@ void Stats::reset()
 
 	numMemoryRead = 0;
 	numMemoryWrite = 0;
+
+	// Request timing
+	numHostWrite = 0;
+	numRequests = 0;
+	numOutstandingMax = 0;
+	sumLatency = 0.0;
+	firstArrival = 0.0;
+	lastCompletion = 0.0;
+}
+
+/* mean time from arrival to completion of a host request */
+double Stats::average_latency() const
+{
+	if (numRequests == 0)
+		return 0.0;
+	return sumLatency / numRequests;
+}
+
+/* host requests completed per time unit between the first arrival and the
+ * last completion
+ * requests that overlap on different dies raise this number even when their
+ * individual latencies stay the same */
+double Stats::throughput() const
+{
+	if (numRequests == 0 || lastCompletion <= firstArrival)
+		return 0.0;
+	return numRequests / (lastCompletion - firstArrival);
+}
+
+/* pages written to flash per page written by the host, counting the pages
+ * garbage collection moves but not the mapping pages of an FTL */
+double Stats::write_amplification() const
+{
+	if (numHostWrite == 0)
+		return 0.0;
+	return (double) (numHostWrite + numGCWrite) / numHostWrite;
 }
 
 void Stats::reset_statistics()
@@ -79,21 +121,24 @@ void Stats::reset_statistics()
 
 void Stats::write_header(FILE *stream)
 {
-	fprintf(stream, "numFTLRead;numFTLWrite;numFTLErase;numFTLTrim;numGCRead;numGCWrite;numGCErase;numWLRead;numWLWrite;numWLErase;numLogMergeSwitch;numLogMergePartial;numLogMergeFull;numPageBlockToPageConversion;numCacheHits;numCacheFaults;numMemoryTranslation;numMemoryCache;numMemoryRead;numMemoryWrite\n");
+	fprintf(stream, "numFTLRead;numFTLWrite;numFTLErase;numFTLTrim;numGCRead;numGCWrite;numGCErase;numGCRuns;sumGCLatency;numWLRead;numWLWrite;numWLErase;numLogMergeSwitch;numLogMergePartial;numLogMergeFull;numPageBlockToPageConversion;numCacheHits;numCacheFaults;numCacheEvictions;numCacheDirtyEvictions;numCachePrefetches;numCachePrefetchHits;numMemoryTranslation;numMemoryCache;numMemoryRead;numMemoryWrite;numHostWrite;numRequests;numOutstandingMax;averageLatency;throughput;writeAmplification\n");
 }
 
 void Stats::write_statistics(FILE *stream)
 {
-	fprintf(stream, "%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;\n",
+	fprintf(stream, "%li;%li;%li;%li;%li;%li;%li;%li;%f;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%f;%f;%f;\n",
 			numFTLRead, numFTLWrite, numFTLErase, numFTLTrim,
-			numGCRead, numGCWrite, numGCErase,
+			numGCRead, numGCWrite, numGCErase, numGCRuns, sumGCLatency,
 			numWLRead, numWLWrite, numWLErase,
 			numLogMergeSwitch, numLogMergePartial, numLogMergeFull,
 			numPageBlockToPageConversion,
-			numCacheHits, numCacheFaults,
+			numCacheHits, numCacheFaults, numCacheEvictions, numCacheDirtyEvictions,
+			numCachePrefetches, numCachePrefetchHits,
 			numMemoryTranslation,
 			numMemoryCache,
-			numMemoryRead,numMemoryWrite);
+			numMemoryRead,numMemoryWrite,
+			numHostWrite, numRequests, numOutstandingMax,
+			average_latency(), throughput(), write_amplification());
 
 	//print_statistics();
 }
@@ -104,12 +149,24 @@ void Stats::print_statistics()
 	printf("-----------\n");
 	printf("FTL Reads: %li\t Writes: %li\t Erases: %li\t Trims: %li\n", numFTLRead, numFTLWrite, numFTLErase, numFTLTrim);
 	printf("GC  Reads: %li\t Writes: %li\t Erases: %li\n", numGCRead, numGCWrite, numGCErase);
+	printf("GC  Runs: %li Latency: %f Write amplification: %f\n", numGCRuns, sumGCLatency, write_amplification());
 	printf("WL  Reads: %li\t Writes: %li\t Erases: %li\n", numWLRead, numWLWrite, numWLErase);
 	printf("Log FTL Switch: %li Partial: %li Full: %li\n", numLogMergeSwitch, numLogMergePartial, numLogMergeFull);
 	printf("Page FTL Convertions: %li\n", numPageBlockToPageConversion);
 	printf("Cache Hits: %li Faults: %li Hit Ratio: %f\n", numCacheHits, numCacheFaults, (double)numCacheHits/(double)(numCacheHits+numCacheFaults));
+	printf("Cache Evictions: %li Dirty: %li\n", numCacheEvictions, numCacheDirtyEvictions);
+	if (numCachePrefetches > 0)
+		printf("Cache Prefetches: %li Used: %li Accuracy: %f\n", numCachePrefetches, numCachePrefetchHits, (double)numCachePrefetchHits/(double)numCachePrefetches);
 	printf("Memory Consumption:\n");
 	printf("Tranlation: %li Cache: %li\n", numMemoryTranslation, numMemoryCache);
 	printf("Reads: %li \tWrites: %li\n", numMemoryRead, numMemoryWrite);
+	printf("Requests: %li Max outstanding: %li\n", numRequests, numOutstandingMax);
+	printf("Average latency: %f Throughput: %f requests per time unit\n", average_latency(), throughput());
 	printf("-----------\n");
 }
+
+void Stats::snapshot(Snapshot &snapshot)
+{
+	snapshot.section("stats");
+	snapshot.io(*this);
+}
@@ -0,0 +1,294 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_trace.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Trace_reader class
+ *
+ * Reads the request traces replayed by the run_* drivers.  Text traces are
+ * parsed a line at a time with sscanf.  Binary traces are a Trace_header
+ * followed by fixed-width Trace_records; they are mapped read-only into memory
+ * and handed out in place, so replaying one costs no parsing at all.  convert
+ * writes the binary form of a text trace.
+ *
+ * Trace_pipeline runs a Trace_reader in its own thread ahead of the
+ * simulation.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <thread>
+#include "ssd.h"
+
+using namespace ssd;
+
+#define TRACE_MAGIC "FSTRACE"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_VERSION 1
+#define TRACE_LINE_SIZE 256
+
+/* type of the record that ends the stream of a Trace_pipeline */
+#define TRACE_END '\0'
+
+/* spin before yielding only when the other thread can run at the same time */
+static const uint spin_limit = std::thread::hardware_concurrency() > 1 ? 1024 : 0;
+
+static_assert(sizeof(Trace_record) == 32, "binary trace records are 32 bytes");
+static_assert(sizeof(Trace_header) % sizeof(double) == 0, "binary trace records must stay aligned");
+
+Trace_reader::Trace_reader(const char *filename):
+	text(NULL),
+	map(NULL),
+	map_size(0),
+	records(NULL),
+	records_end(NULL),
+	cur(NULL)
+{
+	int fd = open(filename, O_RDONLY);
+	if(fd < 0)
+	{
+		fprintf(stderr, "Trace_reader error: %s: unable to open trace \"%s\": %s\n", __func__, filename, strerror(errno));
+		exit(FILE_ERR);
+	}
+
+	char magic[TRACE_MAGIC_SIZE];
+	struct stat st;
+	if(fstat(fd, &st) == 0 && (ulong) st.st_size >= sizeof(Trace_header) && pread(fd, magic, TRACE_MAGIC_SIZE, 0) == TRACE_MAGIC_SIZE && memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) == 0)
+	{
+		map_size = st.st_size;
+		map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(map == MAP_FAILED)
+		{
+			fprintf(stderr, "Trace_reader error: %s: unable to map trace \"%s\": %s\n", __func__, filename, strerror(errno));
+			exit(MEM_ERR);
+		}
+		(void) madvise(map, map_size, MADV_SEQUENTIAL);
+
+		const Trace_header *header = (const Trace_header *) map;
+		if(header -> version != TRACE_VERSION || header -> record_size != sizeof(Trace_record) || header -> num_records != (map_size - sizeof(Trace_header)) / sizeof(Trace_record))
+		{
+			fprintf(stderr, "Trace_reader error: %s: \"%s\" is not a version %d trace with %lu byte records\n", __func__, filename, TRACE_VERSION, (ulong) sizeof(Trace_record));
+			exit(FILE_ERR);
+		}
+		records = (const Trace_record *) (header + 1);
+		records_end = records + header -> num_records;
+		cur = records;
+		return;
+	}
+
+	text = fdopen(fd, "r");
+	if(text == NULL)
+	{
+		fprintf(stderr, "Trace_reader error: %s: unable to read trace \"%s\": %s\n", __func__, filename, strerror(errno));
+		exit(FILE_ERR);
+	}
+	return;
+}
+
+Trace_reader::~Trace_reader(void)
+{
+	if(text != NULL)
+		fclose(text);
+	if(map != NULL)
+		munmap(map, map_size);
+	return;
+}
+
+/* copy the next record into record, skipping text lines that do not parse
+ * returns false at the end of the trace */
+bool Trace_reader::next(Trace_record &record)
+{
+	if(map != NULL)
+	{
+		if(cur == records_end)
+			return false;
+		record = *cur++;
+		return true;
+	}
+
+	char line[TRACE_LINE_SIZE];
+	while(fgets(line, TRACE_LINE_SIZE, text) != NULL)
+		if(parse_line(line, record))
+			return true;
+	return false;
+}
+
+bool Trace_reader::is_binary(void) const
+{
+	return map != NULL;
+}
+
+/* records of a binary trace in place, both NULL for a text trace */
+const Trace_record *Trace_reader::begin(void) const
+{
+	return records;
+}
+
+const Trace_record *Trace_reader::end(void) const
+{
+	return records_end;
+}
+
+/* parse a "%c; %c; %li; %u; %i; %lf" trace line */
+bool Trace_reader::parse_line(const char *line, Trace_record &record)
+{
+	long address;
+	memset(&record, 0, sizeof(Trace_record));
+	if(sscanf(line, "%c; %c; %li; %u; %i; %lf", &record.pattern, &record.type, &address, &record.query_time, &record.size, &record.arrive_time) != 6)
+		return false;
+	record.address = address;
+	return true;
+}
+
+/* write the binary form of a text trace
+ * returns the number of records written */
+ulong Trace_reader::convert(const char *text_filename, const char *binary_filename)
+{
+	Trace_reader reader(text_filename);
+	FILE *out = fopen(binary_filename, "wb");
+	if(out == NULL)
+	{
+		fprintf(stderr, "Trace_reader error: %s: unable to create \"%s\": %s\n", __func__, binary_filename, strerror(errno));
+		exit(FILE_ERR);
+	}
+
+	/* the record count is filled in once all records are written */
+	Trace_header header;
+	memset(&header, 0, sizeof(Trace_header));
+	memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(Trace_record);
+	bool failed = fwrite(&header, sizeof(Trace_header), 1, out) != 1;
+
+	Trace_record record;
+	while(!failed && reader.next(record))
+	{
+		failed = fwrite(&record, sizeof(Trace_record), 1, out) != 1;
+		header.num_records++;
+	}
+
+	failed = failed || fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(Trace_header), 1, out) != 1;
+	if(fclose(out) != 0 || failed)
+	{
+		fprintf(stderr, "Trace_reader error: %s: unable to write \"%s\": %s\n", __func__, binary_filename, strerror(errno));
+		exit(FILE_ERR);
+	}
+	return header.num_records;
+}
+
+Trace_pipeline::Trace_pipeline(const char *filename, bool threaded, uint ring_size):
+	reader(filename),
+	ring(ring_size),
+	stopping(false),
+	ended(false),
+	batch_pos(0),
+	batch_size(0)
+{
+	if(threaded)
+		thread = std::thread(&Trace_pipeline::run, this);
+	return;
+}
+
+/* the producer may still be waiting on a full ring if the consumer stopped
+ * before the end of the trace */
+Trace_pipeline::~Trace_pipeline(void)
+{
+	stopping = true;
+	if(thread.joinable())
+		thread.join();
+	return;
+}
+
+/* copy the next record into record
+ * returns false at the end of the trace */
+bool Trace_pipeline::next(Trace_record &record)
+{
+	if(batch_pos == batch_size)
+	{
+		batch_size = next_batch(batch, TRACE_BATCH_SIZE);
+		batch_pos = 0;
+		if(batch_size == 0)
+			return false;
+	}
+	record = batch[batch_pos++];
+	return true;
+}
+
+/* copy up to max records into records, waiting for the producer if the ring
+ * is empty
+ * returns the number of records copied, 0 at the end of the trace */
+uint Trace_pipeline::next_batch(Trace_record *records, uint max)
+{
+	uint n = 0;
+
+	if(!thread.joinable())
+	{
+		while(n < max && reader.next(records[n]))
+			n++;
+		return n;
+	}
+
+	/* the end marker is the last record the producer pushes, so it can only
+	 * be the last one of a batch */
+	for(uint spins = 0; !ended; spins++)
+	{
+		n = ring.pop_batch(records, max);
+		if(n > 0 && records[n - 1].type == TRACE_END)
+		{
+			ended = true;
+			n--;
+		}
+		if(n > 0)
+			return n;
+		if(spins >= spin_limit)
+			std::this_thread::yield();
+	}
+	return 0;
+}
+
+/* producer thread: decode records into the ring, waiting while it is full,
+ * then push the end marker */
+void Trace_pipeline::run(void)
+{
+	Trace_record record;
+	bool more = true;
+
+	while(more)
+	{
+		more = reader.next(record);
+		if(!more)
+		{
+			memset(&record, 0, sizeof(Trace_record));
+			record.type = TRACE_END;
+		}
+		for(uint spins = 0; !ring.push(record); spins++)
+		{
+			if(stopping)
+				return;
+			if(spins >= spin_limit)
+				std::this_thread::yield();
+		}
+	}
+}